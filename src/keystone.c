@@ -28,14 +28,41 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <math.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifndef _WIN32
+# include <sys/mman.h>
+#endif
+
+#if defined(__GNUC__) && ( defined(__i386__) || defined(__x86_64__) )
+/* All the x86 kernels are built, each with its instruction set enabled by
+ * an attribute, and the best one the CPU runs is picked at run time */
+# include <immintrin.h>
+# define X86_KERNELS 1
+# define X86_TARGET( isa ) __attribute__(( target( isa ) ))
+#endif
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON)
+# include <arm_neon.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_atomic.h>
+#include <vlc_charset.h>
+#include <vlc_cpu.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_fs.h>
 #include <vlc_mouse.h>
 #include <vlc_picture.h>
+#include <vlc_subpicture.h>
+#include <vlc_vout.h>
 #include "filter_picture.h"
 
 /*****************************************************************************
@@ -92,6 +119,112 @@ static int KeystoneCallback( vlc_object_t *, char const *,
 #define HANDLES_LONGTEXT N_( \
     "Display draggable corner handles on the video. " \
     "Default: enabled" )
+#define OUTLINE_TEXT N_("Show quad outline")
+#define OUTLINE_LONGTEXT N_( \
+    "Draw the edges of the warped picture over the video, to line it up " \
+    "with the screen. Like the handles, it is not part of the filtered " \
+    "pictures. Default: disabled" )
+#define MESH_TEXT N_("Mesh")
+#define MESH_LONGTEXT N_( \
+    "Warp through a grid of control points, given as columns x rows (for " \
+    "example 3x3, at most 16x16). Its corners are the corners above, the " \
+    "other points are dragged with the mouse like them, for curved or " \
+    "uneven screens. Default: none, corners only" )
+#define MESH_POINTS_TEXT N_("Mesh point offsets")
+#define MESH_POINTS_LONGTEXT N_( \
+    "Offsets of the mesh points from their place in the corner keystone, " \
+    "in fractions of the picture size like the corners: x and y of every " \
+    "point, row by row, separated by spaces or commas. Updated when a " \
+    "point is dragged." )
+
+#define BLEND_LEFT_TEXT N_("Left soft edge")
+#define BLEND_LEFT_LONGTEXT N_( \
+    "Width of the left edge overlapping another projector, as a fraction " \
+    "of the picture width (0 to 0.5): the picture fades out over it so " \
+    "that the light of both projectors adds up to one. Default: 0.0" )
+#define BLEND_RIGHT_TEXT N_("Right soft edge")
+#define BLEND_RIGHT_LONGTEXT N_( \
+    "Width of the right edge overlapping another projector, as a " \
+    "fraction of the picture width (0 to 0.5). Default: 0.0" )
+#define BLEND_TOP_TEXT N_("Top soft edge")
+#define BLEND_TOP_LONGTEXT N_( \
+    "Height of the top edge overlapping another projector, as a fraction " \
+    "of the picture height (0 to 0.5). Default: 0.0" )
+#define BLEND_BOTTOM_TEXT N_("Bottom soft edge")
+#define BLEND_BOTTOM_LONGTEXT N_( \
+    "Height of the bottom edge overlapping another projector, as a " \
+    "fraction of the picture height (0 to 0.5). Default: 0.0" )
+#define BLEND_GAMMA_TEXT N_("Soft edge gamma")
+#define BLEND_GAMMA_LONGTEXT N_( \
+    "Gamma of the projectors, to fade their light rather than the " \
+    "samples linearly (1.0 to 4.0). Default: 2.2" )
+#define BLEND_BLACK_TEXT N_("Soft edge black level")
+#define BLEND_BLACK_LONGTEXT N_( \
+    "Raise the black of the picture outside of the soft edges by this " \
+    "fraction of the sample range (0 to 0.25), to match the black of the " \
+    "overlaps lit by two projectors. Default: 0.0" )
+
+#define THREADS_TEXT N_("Rendering threads")
+#define THREADS_LONGTEXT N_( \
+    "Number of threads rendering the warped picture, each taking " \
+    "horizontal bands of the planes (0 = one per CPU). Default: 0" )
+#define QUALITY_TEXT N_("Warp quality")
+#define QUALITY_LONGTEXT N_( \
+    "\"exact\" evaluates the perspective transform for every pixel. " \
+    "\"fast\" evaluates it on a grid of tiles sized to stay within the " \
+    "tolerance below, and interpolates inside the tiles, on the pictures " \
+    "where the corners change: it makes dragging them cheaper, then the " \
+    "pictures are exact again once the corners stay. Default: exact" )
+#define TOLERANCE_TEXT N_("Fast mode tolerance")
+#define TOLERANCE_LONGTEXT N_( \
+    "Largest deviation from the exact transform allowed in fast mode, in " \
+    "source pixels (0.01 to 2.0). Default: 0.25" )
+#define INTERP_TEXT N_("Interpolation")
+#define INTERP_LONGTEXT N_( \
+    "How source pixels are resampled: \"nearest\" is the cheapest and " \
+    "blocky, \"bilinear\" is smooth, \"bicubic\" and \"lanczos\" " \
+    "(3 lobes) keep more detail at a higher cost. The fast quality only " \
+    "applies to bilinear. Default: bilinear" )
+#define PROFILE_TEXT N_("Calibration profile")
+#define PROFILE_LONGTEXT N_( \
+    "File holding the corners and mesh points, loaded when the filter " \
+    "starts instead of the values above, and saved when it ends. It is " \
+    "created if needed." )
+#define PROFILE_MAPS_TEXT N_("Store the warp maps in the profile")
+#define PROFILE_MAPS_LONGTEXT N_( \
+    "Save the warp maps built for the calibration with it, so that the " \
+    "next start reads them from the file instead of computing them again. " \
+    "They take about 12 bytes per pixel in 4:2:0. Default: enabled" )
+#define OUTPUT_SIZE_TEXT N_("Output size")
+#define OUTPUT_SIZE_LONGTEXT N_( \
+    "Size of the filtered pictures, as width x height (for example " \
+    "1280x720, rounded down to even sizes in YUV), when it differs from " \
+    "the source: the rescaling is part of the warp, without a second " \
+    "interpolation. The display aspect ratio is kept. Default: none, the " \
+    "size of the source" )
+
+#define STATS_TEXT N_("Timing statistics")
+#define STATS_LONGTEXT N_( \
+    "Time the stages of the filter, and publish their mean, 95th " \
+    "percentile and largest times over the last pictures, with the number " \
+    "of warped and passed through pictures, as keystone-stats-* variables " \
+    "of the filter. Default: disabled" )
+#define TRACE_TEXT N_("Trace file")
+#define TRACE_LONGTEXT N_( \
+    "Write the timings of every picture and of every band of every thread " \
+    "to this file, in the Chrome trace event format (chrome://tracing, " \
+    "Perfetto). Default: none" )
+
+static const char *const ppsz_quality_values[] = { "exact", "fast" };
+static const char *const ppsz_quality_descriptions[] = {
+    N_("Exact"), N_("Fast (approximate)") };
+
+/* In INTERP_* order */
+static const char *const ppsz_interp_values[] = {
+    "nearest", "bilinear", "bicubic", "lanczos" };
+static const char *const ppsz_interp_descriptions[] = {
+    N_("Nearest neighbour"), N_("Bilinear"), N_("Bicubic"),
+    N_("Lanczos") };
 
 vlc_module_begin ()
     set_description( N_("Keystone / corner pin video filter") )
@@ -128,6 +261,51 @@ vlc_module_begin ()
     add_bool( FILTER_PREFIX "show-handles", true,
               HANDLES_TEXT, HANDLES_LONGTEXT, false )
         change_safe()
+    add_bool( FILTER_PREFIX "show-outline", false,
+              OUTLINE_TEXT, OUTLINE_LONGTEXT, false )
+        change_safe()
+
+    add_string( FILTER_PREFIX "mesh", "",
+                MESH_TEXT, MESH_LONGTEXT, false )
+    add_string( FILTER_PREFIX "mesh-points", "",
+                MESH_POINTS_TEXT, MESH_POINTS_LONGTEXT, false )
+        change_safe()
+
+    add_savefile( FILTER_PREFIX "profile", NULL,
+                  PROFILE_TEXT, PROFILE_LONGTEXT, false )
+    add_bool( FILTER_PREFIX "profile-maps", true,
+              PROFILE_MAPS_TEXT, PROFILE_MAPS_LONGTEXT, true )
+
+    add_float_with_range( FILTER_PREFIX "blend-left", 0.0, 0.0, 0.5,
+                          BLEND_LEFT_TEXT, BLEND_LEFT_LONGTEXT, false )
+    add_float_with_range( FILTER_PREFIX "blend-right", 0.0, 0.0, 0.5,
+                          BLEND_RIGHT_TEXT, BLEND_RIGHT_LONGTEXT, false )
+    add_float_with_range( FILTER_PREFIX "blend-top", 0.0, 0.0, 0.5,
+                          BLEND_TOP_TEXT, BLEND_TOP_LONGTEXT, false )
+    add_float_with_range( FILTER_PREFIX "blend-bottom", 0.0, 0.0, 0.5,
+                          BLEND_BOTTOM_TEXT, BLEND_BOTTOM_LONGTEXT, false )
+    add_float_with_range( FILTER_PREFIX "blend-gamma", 2.2, 1.0, 4.0,
+                          BLEND_GAMMA_TEXT, BLEND_GAMMA_LONGTEXT, true )
+    add_float_with_range( FILTER_PREFIX "blend-black", 0.0, 0.0, 0.25,
+                          BLEND_BLACK_TEXT, BLEND_BLACK_LONGTEXT, true )
+
+    add_integer_with_range( FILTER_PREFIX "threads", 0, 0, 32,
+                            THREADS_TEXT, THREADS_LONGTEXT, true )
+    add_string( FILTER_PREFIX "quality", "exact",
+                QUALITY_TEXT, QUALITY_LONGTEXT, false )
+        change_string_list( ppsz_quality_values, ppsz_quality_descriptions )
+    add_float_with_range( FILTER_PREFIX "tolerance", 0.25, 0.01, 2.0,
+                          TOLERANCE_TEXT, TOLERANCE_LONGTEXT, true )
+    add_string( FILTER_PREFIX "interp", "bilinear",
+                INTERP_TEXT, INTERP_LONGTEXT, false )
+        change_string_list( ppsz_interp_values, ppsz_interp_descriptions )
+    add_string( FILTER_PREFIX "output-size", "",
+                OUTPUT_SIZE_TEXT, OUTPUT_SIZE_LONGTEXT, false )
+
+    add_bool( FILTER_PREFIX "stats", false,
+              STATS_TEXT, STATS_LONGTEXT, true )
+    add_savefile( FILTER_PREFIX "trace-file", NULL,
+                  TRACE_TEXT, TRACE_LONGTEXT, true )
 
     add_shortcut( "keystone" )
     set_callbacks( Create, Destroy )
@@ -136,8 +314,11 @@ vlc_module_end ()
 static const char *const ppsz_filter_options[] = {
     "tl-x", "tl-y", "tr-x", "tr-y",
     "bl-x", "bl-y", "br-x", "br-y",
-    "show-handles",
-    NULL
+    "show-handles", "show-outline", "mesh", "mesh-points", "profile",
+    "profile-maps",
+    "blend-left", "blend-right", "blend-top", "blend-bottom", "blend-gamma",
+    "blend-black", "threads", "quality", "tolerance", "interp",
+    "output-size", "stats", "trace-file", NULL
 };
 
 /* Names of the 8 corner offset variables, for iteration */
@@ -152,7 +333,7 @@ static const char *const ppsz_corner_vars[] = {
  * Constants
  *****************************************************************************/
 #define HANDLE_SIZE  12   /* Half-size of corner handle in pixels */
-#define HANDLE_Y    255   /* Handle color: white */
+#define HANDLE_Y    255   /* Quad outline color: white */
 #define HANDLE_U    128
 #define HANDLE_V    128
 #define ACTIVE_Y     76   /* Active/dragged handle color: red */
@@ -162,21 +343,474 @@ static const char *const ppsz_corner_vars[] = {
 #define HOVER_U      36
 #define HOVER_V     222
 
+/* Longest delay of the parent variables behind a drag */
+#define PERSIST_PERIOD  ( CLOCK_FREQ / 4 )
+
+/* Warp map tap mask: which bilinear neighbours lie inside the source plane */
+#define TAP_00      0x1
+#define TAP_10      0x2
+#define TAP_01      0x4
+#define TAP_11      0x8
+#define TAP_ALL     ( TAP_00 | TAP_10 | TAP_01 | TAP_11 )
+
+#define MESH_MAX        16  /* Control points per axis of a mesh */
+#define MESH_POINTS     ( MESH_MAX * MESH_MAX )
+#define MAX_HANDLES     ( 4 + MESH_POINTS )
+
+#define OUTPUT_MAX      16384   /* Largest side of the output-size */
+
+#define MAX_THREADS     32  /* Rendering threads, video thread included */
+#define MAX_BANDS       ( 2 * MAX_THREADS )
+#define BAND_MIN_LINES  16  /* Smallest band worth handing to a thread */
+
+#define EDGE_BITS       14  /* Soft edge gains are in 1/16384 */
+#define EDGE_CHUNK   16384  /* Output bytes rendered before their soft edges
+                             * are applied, still in the first level cache */
+
+#define TILE_WIDTH      64  /* Destination tiles of the steep warps */
+#define TILE_LINES      16
+#define TILE_PREFETCH 1024  /* Most source cache lines prefetched per tile */
+#define TILE_STEEP_ROWS 64  /* Source rows crossed by an output row */
+#define CACHE_LINE      64
+#ifdef __GNUC__
+# define PREFETCH( p, rw ) __builtin_prefetch( p, rw )
+#else
+# define PREFETCH( p, rw ) ( (void)( p ) )
+#endif
+
+#define GRID_TILE_MAX   64  /* Fast mode tile sizes, tried from the largest */
+#define GRID_TILE_MIN    8
+
+#define KERNEL_PHASES   64  /* Sub-pixel positions of the kernel tables */
+#define KERNEL_BITS     12  /* Kernel weights are in 1/4096 */
+#define KERNEL_EXTRA     6  /* Fraction bits kept between the two passes */
+#define KERNEL_MAX_TAPS  6
+
+#define COST_FRAMES    100  /* Frames averaged for the reported render cost */
+#define STATS_WINDOW   120  /* Frames of the rolling timing statistics */
+#define STATS_PERIOD    25  /* Frames between updates of their variables */
+
+#define PROFILE_MAGIC   "VLCKSTPR"
+#define PROFILE_VERSION 2   /* Bumped whenever the layout or maps change */
+#define PROFILE_ALIGN   64  /* Of the maps in the profile files */
+
+/*****************************************************************************
+ * warp_map_t: precomputed per-pixel source taps for one plane geometry
+ *****************************************************************************/
+typedef struct
+{
+    int32_t i_offset;   /* Byte offset of the top-left tap in the source */
+    uint8_t i_fx;       /* Horizontal weight of the right taps (1/256) */
+    uint8_t i_fy;       /* Vertical weight of the bottom taps (1/256) */
+    uint8_t i_taps;     /* TAP_* mask, 0 = pixel outside of the source */
+    uint8_t i_reserved;
+} warp_entry_t;
+
+typedef struct
+{
+    /* Columns that may hit the source, the rest of the row is filled */
+    int i_begin, i_end;
+    /* Run of pixels whose four taps are all inside the source, and whose
+     * top-left loads (32 bits or two pixels) stay within the source row
+     * (SIMD-safe) */
+    int i_inner_begin, i_inner_end;
+} warp_row_t;
+
+typedef struct
+{
+    /* Geometry the map was built for (cache key with the corners) */
+    int i_dst_width, i_dst_height;
+    int i_src_width, i_src_height;
+    int i_src_pitch;
+    int i_pixel_size;           /* Bytes between horizontal taps */
+
+    warp_entry_t *p_entries;    /* i_dst_width * i_dst_height entries */
+    size_t        i_entries;    /* Allocated entries */
+    warp_row_t   *p_rows;       /* i_dst_height rows */
+    size_t        i_rows;       /* Allocated rows */
+    bool          b_mapped;     /* Both point into the profile instead */
+} warp_map_t;
+
+/*****************************************************************************
+ * Calibration profile files
+ *****************************************************************************
+ * A header with the parameters, then the records of the warp maps built
+ * for them, each with its entries and rows, in the byte order and layout
+ * of the machine that wrote them (the version number catches the other
+ * byte order). Unused mesh offsets are 0 so that the hash of the
+ * parameters only depends on the calibration.
+ *****************************************************************************/
+typedef struct
+{
+    float    pf_corners[8];
+    uint32_t i_mesh_cols, i_mesh_rows;  /* 0 without a mesh */
+    float    pf_mesh[2 * MESH_POINTS];
+} profile_params_t;
+
+typedef struct
+{
+    char     psz_magic[8];      /* PROFILE_MAGIC, not terminated */
+    uint32_t i_version;         /* PROFILE_VERSION */
+    uint32_t i_maps;            /* Records after the header */
+    uint64_t i_hash;            /* Of the parameters */
+    profile_params_t params;
+} profile_header_t;
+
+typedef struct
+{
+    uint64_t i_key;             /* GetProfileMapKey() it was built for */
+    uint64_t i_check;           /* HashWords() of its entries and rows */
+    int32_t  i_dst_width, i_dst_height;
+    int32_t  i_src_width, i_src_height;
+    int32_t  i_src_pitch, i_pixel_size;
+    int32_t  i_taps;            /* Kernel taps, 0 for a bilinear map */
+    uint32_t i_reserved;
+    uint64_t i_offset;          /* Of its entries in the file, its rows
+                                 * following them */
+} profile_map_t;
+
+typedef struct
+{
+    uint8_t *p_data;            /* Whole file, NULL without */
+    size_t   i_size;
+    const profile_header_t *p_header;
+    const profile_map_t    *p_maps;
+    unsigned i_bad_maps;        /* Bit m: map m would read outside of its
+                                 * source, it is rebuilt instead */
+} profile_t;
+
+/*****************************************************************************
+ * warp_grid_t: fast mode sampling of the transform on a grid of tiles
+ *****************************************************************************/
+typedef struct
+{
+    /* Geometry the grid was built for (cache key with the corners) */
+    int i_dst_width, i_dst_height;
+    int i_src_width, i_src_height;
+
+    int i_tile;             /* Tile size, in pixels */
+    int i_cols, i_rows;     /* Number of tiles */
+    int32_t *p_points;      /* (i_cols + 1) * (i_rows + 1) source (x, y)
+                             * pairs, in 16.16 fixed point */
+    uint8_t *p_exact;       /* Per tile: interpolation is out of tolerance,
+                             * evaluate the transform for every pixel */
+    size_t   i_points, i_tiles; /* Allocated sizes */
+} warp_grid_t;
+
+/*****************************************************************************
+ * warp_kernel_t: separable interpolation kernel
+ *****************************************************************************
+ * Weights of the taps for each sub-pixel position, quantized so that they
+ * add up to exactly 1 << KERNEL_BITS: flat areas stay flat. The first tap
+ * is 1 - i_taps / 2 pixels before the bilinear top-left one.
+ *****************************************************************************/
+typedef struct
+{
+    int     i_taps;     /* Per axis */
+    int16_t pi_weights[KERNEL_PHASES][KERNEL_MAX_TAPS];
+} warp_kernel_t;
+
+/* Interior kernel: blends i_count pixels whose taps are all in bounds and
+ * returns how many it processed (the remainder is left to the C code) */
+typedef int (*blend_interior_fn)( uint8_t *, const uint8_t *, int,
+                                  const warp_entry_t *, int );
+
+/*****************************************************************************
+ * warp_component_t: sample layout of one warped plane
+ *****************************************************************************
+ * A pixel holds i_channels interleaved samples (2 for the CbCr plane of the
+ * semi-planar formats), all blended with the same taps and weights. Packed
+ * formats put several components on the same plane: their pixels are then
+ * larger than their samples, and only the own bytes of each are written.
+ *****************************************************************************/
+typedef struct
+{
+    int      i_plane;       /* Picture plane holding the samples */
+    int      i_channels;    /* Interleaved samples per pixel */
+    int      i_pixel_size;  /* Bytes per pixel */
+    uint8_t  pi_channel[4]; /* Y_PLANE, U_PLANE... or RGB_R... of each sample */
+    uint8_t  pi_offset[4];  /* Byte offset of each sample in the pixel */
+    unsigned i_sample_size; /* Bytes per sample: 1, or 2 above 8 bits */
+    unsigned i_bits;        /* Significant bits per sample */
+    bool     b_big_endian;  /* Byte order of 2-byte samples */
+    unsigned i_fill;        /* Sample value outside of the source */
+
+    blend_interior_fn pf_blend_interior; /* NULL: C code only */
+} warp_component_t;
+
+/*****************************************************************************
+ * soft_edge_t: soft edge gains of one component
+ *****************************************************************************
+ * The gain of a pixel is the product of those of its column and its row,
+ * so that the corners of four overlapping projectors add up too. Whole
+ * gains fit 16-bit vector lanes. The samples are scaled towards the fill
+ * value, then raised by the black level where both gains are whole (luma
+ * and RGB only).
+ *****************************************************************************/
+typedef struct
+{
+    uint16_t *pi_gains;         /* i_width columns, then i_height rows */
+    int       i_width, i_height;
+    int       i_left, i_right;  /* Columns [i_left, i_right) at full gain */
+    unsigned  i_lift;           /* Black level, in sample units */
+    bool      pb_scale[4];      /* Per channel: false for alpha */
+    bool      pb_lift[4];       /* Per channel: luma and RGB */
+    bool      b_lift_all;       /* All the bytes of the pixels are lifted */
+} soft_edge_t;
+
+/* Channels of the RGB components */
+enum
+{
+    RGB_R,
+    RGB_G,
+    RGB_B,
+    RGB_A, /* Alpha, or padding */
+};
+
+/* How a plane is rendered for the current picture */
+enum
+{
+    RENDER_MAP,         /* Gather from the cached warp map */
+    RENDER_BUILD_MAP,   /* Fill the warp map rows, then gather from them */
+    RENDER_DIRECT,      /* No map available: RenderPlane() */
+    RENDER_FAST,        /* Interpolate the transform on the warp grid */
+    RENDER_TRANSLATE,   /* Whole pixel shift: copy rows */
+    RENDER_ROWS,        /* One source row pair per row: 1D resampling */
+    RENDER_KERNEL,      /* Not bilinear, no map: RenderPlaneKernel() */
+};
+
+/* Instruction sets of the interior kernels of this build, from the least
+ * capable: a CPU runs all of them up to the one it supports */
+enum
+{
+    ISA_C,
+#if defined(X86_KERNELS)
+    ISA_SSE2,           /* x86 baseline */
+    ISA_SSE4_1,
+    ISA_AVX2,
+    ISA_AVX512,         /* F and BW */
+#elif defined(__ARM_NEON)
+    ISA_NEON,
+#endif
+    ISA_COUNT
+};
+
+static const char *const ppsz_isa_names[] = {
+    "C",
+#if defined(X86_KERNELS)
+    "SSE2", "SSE4.1", "AVX2", "AVX-512",
+#elif defined(__ARM_NEON)
+    "NEON",
+#endif
+};
+
+/* Interpolation, in ppsz_interp_values order */
+enum
+{
+    INTERP_NEAREST,
+    INTERP_BILINEAR,
+    INTERP_BICUBIC,
+    INTERP_LANCZOS,
+};
+
+/* Shape of the transform, from the most to the least specific */
+enum
+{
+    TRANSFORM_TRANSLATE,    /* All corners moved by the same amount */
+    TRANSFORM_ROWS,         /* Top and bottom edges horizontal: h3 = h6 = 0 */
+    TRANSFORM_AFFINE,       /* Parallelogram: h6 = h7 = 0 */
+    TRANSFORM_PERSPECTIVE,
+    TRANSFORM_MESH,         /* Mesh points moved, h[] is for the corners */
+};
+
+/* One horizontal band of one component */
+typedef struct
+{
+    int i_component;
+    int i_y_begin, i_y_end;
+
+    /* When and where it ran, with the statistics only */
+    mtime_t i_start, i_end;
+    int     i_thread;           /* 0 = video thread, workers from 1 */
+} render_job_t;
+
+/* Timed stages of Filter(), in ppsz_stage_names order */
+enum
+{
+    STAGE_TOTAL,
+    STAGE_OVERLAY,      /* UpdateOverlay() */
+    STAGE_HOMOGRAPHY,   /* UpdateRenderCache() */
+    STAGE_RENDER,       /* RenderPicture(), wall clock */
+    STAGE_COPY,         /* Output picture and copy of the properties */
+    STAGE_PLANE,        /* Then one per component: its bands, summed over
+                         * the threads that rendered them */
+    STAGE_COUNT = STAGE_PLANE + PICTURE_PLANE_MAX
+};
+
+static const char *const ppsz_stage_names[] = {
+    "total", "overlay", "homography", "render", "copy",
+    "plane0", "plane1", "plane2", "plane3", "plane4",
+};
+static_assert( ARRAY_SIZE( ppsz_stage_names ) == STAGE_COUNT,
+               "one name per stage" );
+
+/* Statistics of each stage, in ms */
+static const char *const ppsz_stat_names[] = { "mean", "p95", "max" };
+
+/* Instants of a picture, delimiting the stages */
+enum
+{
+    MARK_BEGIN,
+    MARK_OVERLAY,
+    MARK_HOMOGRAPHY,
+    MARK_PICTURE,       /* Output picture obtained */
+    MARK_RENDER,
+    MARK_END,
+    MARK_COUNT
+};
+
+/*****************************************************************************
+ * filter_stats_t: timing statistics, allocated only when enabled
+ *****************************************************************************/
+typedef struct
+{
+    uint64_t i_frames;          /* Warped pictures */
+    uint64_t i_passthrough;     /* Pictures returned untouched */
+    int      i_stages;          /* STAGE_PLANE + components */
+    int      i_period;          /* Pictures since the variables were set */
+
+    /* Last STATS_WINDOW warped pictures, in ms */
+    float    pf_window[STAGE_COUNT][STATS_WINDOW];
+    int      i_window_pos, i_window_count;
+
+    FILE    *p_trace;           /* Chrome trace events, or NULL */
+    mtime_t  i_trace_origin;
+} filter_stats_t;
+
 /*****************************************************************************
  * filter_sys_t
  *****************************************************************************/
 struct filter_sys_t
 {
-    /* Corner offsets (normalized -1..1) */
-    vlc_atomic_float f_tl_x, f_tl_y;
-    vlc_atomic_float f_tr_x, f_tr_y;
-    vlc_atomic_float f_bl_x, f_bl_y;
-    vlc_atomic_float f_br_x, f_br_y;
+    /* Corner offsets (normalized -1..1), in the order of ppsz_corner_vars,
+     * under a sequence lock: the count is odd while they are written, and
+     * changes with every write. Readers never block and retry a torn read
+     * (LoadCorners()), writers are serialized by corners_lock. */
+    vlc_atomic_float pf_corners[8];
+    atomic_uint      i_corners_seq;
+    vlc_mutex_t      corners_lock;
 
-    /* Mouse interaction state */
-    atomic_int  i_drag_corner;  /* -1 = none, 0=TL, 1=TR, 2=BL, 3=BR */
-    atomic_int  i_hover_corner; /* -1 = none, corner closest to mouse */
+    /* Mesh of i_mesh_cols x i_mesh_rows points, 0 x 0 without one: offsets
+     * of the points from their place in the corner keystone, x and y row
+     * by row, under the same sequence lock. Those of the corner points
+     * stay 0, the corners move them. */
+    int              i_mesh_cols, i_mesh_rows;
+    vlc_atomic_float pf_mesh[2 * MESH_POINTS];
+
+    /* Mouse interaction state, on handles: 0=TL, 1=TR, 2=BL, 3=BR, then
+     * 4 + the index of the mesh points */
+    atomic_int  i_drag_corner;  /* -1 = none */
+    atomic_int  i_hover_corner; /* -1 = none, handle closest to mouse */
     atomic_bool b_show_handles; /* Whether to draw corner handles */
+
+    /* Corners last written to the parent variables, which a drag only
+     * updates on release, every PERSIST_PERIOD, and when the filter is
+     * destroyed. Only accessed from the video thread. */
+    float   pf_persisted[8];
+    float   pf_persisted_mesh[2 * MESH_POINTS];
+    bool    b_persist;          /* Dragged since */
+    mtime_t i_persist_time;
+
+    /* Overlay of the handles and of the quad outline: a subpicture on its
+     * own channel of the video output (none when the filter is not under
+     * one). Only accessed from the video thread. */
+    vout_thread_t *p_vout;
+    int    i_spu_channel;
+    bool   b_show_outline;
+    bool   b_overlay;               /* A subpicture is up, drawn from: */
+    int    i_overlay_corner;        /* Handle shown, -1 = none */
+    bool   b_overlay_active;        /* Dragged rather than hovered */
+    unsigned i_overlay_seq;         /* i_corners_seq */
+    int    i_overlay_width, i_overlay_height;
+
+    /* Render cache, only accessed from the video thread. The homography
+     * and the warp maps are rebuilt when the corners or the picture
+     * geometry differ from the ones they were computed for. */
+    float  pf_cache_corners[8];
+    float  pf_cache_mesh[2 * MESH_POINTS];
+    int    i_cache_width, i_cache_height;           /* Output Y plane */
+    int    i_cache_src_width, i_cache_src_height;   /* Source Y plane */
+    bool   b_cache_valid;       /* Key above is meaningful */
+    bool   b_cache_new;         /* and set for the current picture */
+    unsigned i_cache_seq;       /* i_corners_seq of the last picture, */
+    bool   b_cache_seq;         /* if any: its corners are cached, */
+    bool   b_identity;          /* and all zero, without soft edges */
+    bool   b_homography;        /* h[] is usable (system not degenerate) */
+    double h[8];
+    int    i_transform;         /* TRANSFORM_*, with h[] snapped to it */
+    bool   b_tiled;             /* Steep: maps rendered in tiles */
+    double pf_mesh_points[2 * MESH_POINTS]; /* TRANSFORM_MESH: destination
+                                             * of the points, in pixels */
+    warp_map_t maps[PICTURE_PLANE_MAX];
+
+    /* Calibration profile: its parameters and maps, read at creation,
+     * and the file they are saved to at the end */
+    char        *psz_profile;   /* NULL without */
+    bool         b_profile_invalid; /* Exists but unreadable: kept aside */
+    bool         b_profile_maps;
+    vlc_fourcc_t i_chroma;      /* Part of the keys of the maps */
+    profile_t    profile;
+
+    /* What is warped, one map per component */
+    warp_component_t components[PICTURE_PLANE_MAX];
+    int              i_components;
+    bool             b_rgb;     /* Channels are RGB_R... instead of planes */
+    int              i_isa;     /* ISA_* of their interior kernels */
+
+    /* Interpolation: bilinear is built into the renderers, the others use
+     * the kernel tables (nearest only without a map) */
+    int           i_interp;
+    warp_kernel_t kernel;
+
+    /* Render time, reported every COST_FRAMES warped pictures */
+    mtime_t i_cost_time;
+    int     i_cost_frames;
+
+    /* Per stage timings, NULL unless keystone-stats or a trace file is
+     * set: the jobs are then timed too */
+    filter_stats_t *p_stats;
+
+    /* Fast mode: no maps, the transform is interpolated on grids */
+    bool        b_fast;
+    double      f_tolerance;    /* Largest interpolation error, in pixels */
+    warp_grid_t grids[PICTURE_PLANE_MAX];
+
+    /* Soft edges, applied by the jobs right after rendering */
+    bool        b_soft_edge;
+    float       pf_edge[4];         /* Left, right, top, bottom widths */
+    float       f_edge_gamma, f_edge_black;
+    soft_edge_t edges[PICTURE_PLANE_MAX];
+
+    /* Picture being rendered by the jobs, set by the video thread */
+    const picture_t *p_job_src;
+    picture_t       *p_job_dst;
+    int              pi_mode[PICTURE_PLANE_MAX];  /* Per component */
+
+    /* Worker pool: the video thread and i_workers threads pick jobs until
+     * none is left, then the video thread waits for the last one */
+    vlc_mutex_t  pool_lock;
+    vlc_cond_t   pool_work;     /* New jobs were queued, or exit */
+    vlc_cond_t   pool_done;     /* All the jobs are finished */
+    vlc_thread_t workers[MAX_THREADS - 1];
+    int          i_workers;
+    uint32_t    *p_columns;     /* RenderPlaneRows() blends, per thread */
+    size_t       i_columns;     /* Samples per thread */
+    int          i_worker_ids;  /* Handed out to the workers as they start */
+    int          i_bands;       /* Bands per plane */
+    unsigned     i_generation;  /* Incremented for each queued picture */
+    bool         b_exit;
+    render_job_t jobs[PICTURE_PLANE_MAX * MAX_BANDS];
+    int          i_jobs, i_next_job, i_jobs_done;
 };
 
 /*****************************************************************************
@@ -273,30 +907,167 @@ static bool ComputeHomography( double h[8],
 }
 
 /*****************************************************************************
- * RenderPlane: apply perspective transform to one picture plane
+ * ClipSpan: narrow the open interval (lo, hi) to where a + b * x > -tol
+ *****************************************************************************/
+static bool ClipSpan( double a, double b, double tol,
+                      double *p_lo, double *p_hi )
+{
+    if( b > 0. )
+    {
+        const double x = ( -tol - a ) / b;
+        if( x > *p_lo )
+            *p_lo = x;
+    }
+    else if( b < 0. )
+    {
+        const double x = ( -tol - a ) / b;
+        if( x < *p_hi )
+            *p_hi = x;
+    }
+    else if( a <= -tol )
+        return false;
+
+    return *p_lo < *p_hi;
+}
+
+/*****************************************************************************
+ * GetRowSpan: columns [*pi_begin, *pi_end) of a destination row that can
+ * map inside the source
+ *****************************************************************************
+ * Along a row, the numerators and the denominator of the homography are
+ * affine in x. On each side of den = 0, the conditions -m < sx < width + m - 1
+ * and -m < sy < height + m - 1 are then half-lines, whose intersection is
+ * solved directly; m is the reach of the kernel outside of its first tap
+ * position, 1 for bilinear. The result is the hull of both sides, rounded
+ * outwards with a safety margin: the exact per-pixel test still runs inside
+ * of it.
+ *****************************************************************************/
+static void GetRowSpan( double num_x, double num_y, double den,
+                        double dnum_x, double dnum_y, double dden,
+                        double f_inv_scale_x, double f_inv_scale_y,
+                        int i_src_width, int i_src_height, int i_dst_width,
+                        int i_margin, int *pi_begin, int *pi_end )
+{
+    const double ax = num_x * f_inv_scale_x, bx = dnum_x * f_inv_scale_x;
+    const double ay = num_y * f_inv_scale_y, by = dnum_y * f_inv_scale_y;
+    const double m = i_margin;
+    const double f_right  = i_src_width + i_margin - 1;
+    const double f_bottom = i_src_height + i_margin - 1;
+    double f_begin = i_dst_width, f_end = -1.;
+
+    for( int i_side = -1; i_side <= 1; i_side += 2 )
+    {
+        const double c[5][2] = {
+            { den, dden },                                 /* side */
+            { ax + m * den, bx + m * dden },               /* sx > -m */
+            { f_right * den - ax, f_right * dden - bx },   /* sx < w + m - 1 */
+            { ay + m * den, by + m * dden },               /* sy > -m */
+            { f_bottom * den - ay, f_bottom * dden - by }, /* sy < h + m - 1 */
+        };
+        double lo = -1., hi = i_dst_width;
+        bool b_hit = true;
+
+        for( int k = 0; k < 5 && b_hit; k++ )
+        {
+            const double a = i_side * c[k][0], b = i_side * c[k][1];
+            /* Err on the inclusive side: rounding is settled per pixel */
+            const double tol = 1e-9 * ( fabs( a ) + fabs( b ) * i_dst_width );
+            b_hit = ClipSpan( a, b, tol, &lo, &hi );
+        }
+
+        if( b_hit )
+        {
+            if( lo < f_begin )
+                f_begin = lo;
+            if( hi > f_end )
+                f_end = hi;
+        }
+    }
+
+    if( f_begin >= f_end )
+    {
+        *pi_begin = *pi_end = 0;
+        return;
+    }
+
+    /* Integers strictly inside (f_begin, f_end), widened by one pixel */
+    *pi_begin = __MAX( (int)floor( f_begin ), 0 );
+    *pi_end   = __MIN( (int)ceil( f_end ) + 1, i_dst_width );
+    if( *pi_begin > *pi_end )
+        *pi_begin = *pi_end;
+}
+
+/*****************************************************************************
+ * Sample access for 8-bit and 2-byte components
+ *****************************************************************************/
+static inline unsigned GetSample( const uint8_t *p,
+                                  const warp_component_t *p_comp )
+{
+    if( p_comp->i_sample_size == 1 )
+        return *p;
+    return p_comp->b_big_endian ? GetWBE( p ) : GetWLE( p );
+}
+
+static inline void PutSample( uint8_t *p, unsigned i_value,
+                              const warp_component_t *p_comp )
+{
+    if( p_comp->i_sample_size == 1 )
+        *p = i_value;
+    else if( p_comp->b_big_endian )
+        SetWBE( p, i_value );
+    else
+        SetWLE( p, i_value );
+}
+
+static inline bool IsDense( const warp_component_t *p_comp )
+{
+    /* The pixel has no bytes of other components */
+    return (unsigned)p_comp->i_pixel_size
+           == p_comp->i_channels * p_comp->i_sample_size;
+}
+
+static void FillPixels( uint8_t *p, int i_count,
+                        const warp_component_t *p_comp )
+{
+    if( p_comp->i_sample_size == 1 && IsDense( p_comp ) )
+    {
+        memset( p, p_comp->i_fill, i_count * p_comp->i_pixel_size );
+        return;
+    }
+    for( int i = 0; i < i_count; i++, p += p_comp->i_pixel_size )
+        for( int c = 0; c < p_comp->i_channels; c++ )
+            PutSample( &p[p_comp->pi_offset[c]], p_comp->i_fill, p_comp );
+}
+
+/*****************************************************************************
+ * RenderPlane: apply perspective transform to rows [i_y_begin, i_y_end) of
+ * one picture plane
  *****************************************************************************/
 static void RenderPlane( const plane_t *p_src, plane_t *p_dst,
                          int i_y_width, int i_y_height,
-                         const double h[8], int i_plane )
+                         const double h[8], const warp_component_t *p_comp,
+                         int i_y_begin, int i_y_end )
 {
-    const int i_dst_width  = p_dst->i_visible_pitch / p_dst->i_pixel_pitch;
+    const int i_dst_width  = p_dst->i_visible_pitch / p_comp->i_pixel_size;
     const int i_dst_height = p_dst->i_visible_lines;
-    const int i_src_width  = p_src->i_visible_pitch / p_src->i_pixel_pitch;
+    const int i_src_width  = p_src->i_visible_pitch / p_comp->i_pixel_size;
     const int i_src_height = p_src->i_visible_lines;
+    const int i_pixel = p_comp->i_pixel_size;
 
     const double f_scale_x = (double)i_y_width / i_dst_width;
     const double f_scale_y = (double)i_y_height / i_dst_height;
     const double f_inv_scale_x = (double)i_dst_width / i_y_width;
     const double f_inv_scale_y = (double)i_dst_height / i_y_height;
 
-    const uint8_t fill = ( i_plane == U_PLANE || i_plane == V_PLANE )
-                         ? 0x80 : 0x00;
+    const unsigned fill = p_comp->i_fill;
+    /* den is exactly 1 for affine transforms: skip the divides */
+    const bool b_affine = h[6] == 0. && h[7] == 0.;
 
     const double h0_sx = h[0] * f_scale_x;
     const double h3_sx = h[3] * f_scale_x;
     const double h6_sx = h[6] * f_scale_x;
 
-    for( int y = 0; y < i_dst_height; y++ )
+    for( int y = i_y_begin; y < i_y_end; y++ )
     {
         uint8_t *p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
 
@@ -306,19 +1077,36 @@ static void RenderPlane( const plane_t *p_src, plane_t *p_dst,
         double num_y = h[4] * dy + h[5];
         double den   = h[7] * dy + 1.0;
 
-        for( int x = 0; x < i_dst_width; x++ )
+        int i_begin, i_end;
+        GetRowSpan( num_x, num_y, den, h0_sx, h3_sx, h6_sx,
+                    f_inv_scale_x, f_inv_scale_y,
+                    i_src_width, i_src_height, i_dst_width, 1,
+                    &i_begin, &i_end );
+
+        FillPixels( p_out, i_begin, p_comp );
+        FillPixels( &p_out[i_end * i_pixel], i_dst_width - i_end, p_comp );
+
+        /* Keep the incremental evaluation for exactness, minus the divide */
+        for( int x = 0; x < i_begin; x++ )
+        {
+            num_x += h0_sx;
+            num_y += h3_sx;
+            den   += h6_sx;
+        }
+
+        for( int x = i_begin; x < i_end; x++ )
         {
             if( fabs( den ) < 1e-12 )
             {
-                p_out[x] = fill;
+                FillPixels( &p_out[x * i_pixel], 1, p_comp );
                 num_x += h0_sx;
                 num_y += h3_sx;
                 den   += h6_sx;
                 continue;
             }
 
-            double sx = ( num_x / den ) * f_inv_scale_x;
-            double sy = ( num_y / den ) * f_inv_scale_y;
+            double sx = ( b_affine ? num_x : num_x / den ) * f_inv_scale_x;
+            double sy = ( b_affine ? num_y : num_y / den ) * f_inv_scale_y;
 
             int i_sx = (int)( sx >= 0 ? sx : sx - 1 );
             int i_sy = (int)( sy >= 0 ? sy : sy - 1 );
@@ -326,7 +1114,7 @@ static void RenderPlane( const plane_t *p_src, plane_t *p_dst,
             if( i_sx < -1 || i_sx >= i_src_width
              || i_sy < -1 || i_sy >= i_src_height )
             {
-                p_out[x] = fill;
+                FillPixels( &p_out[x * i_pixel], 1, p_comp );
                 num_x += h0_sx;
                 num_y += h3_sx;
                 den   += h6_sx;
@@ -336,23 +1124,30 @@ static void RenderPlane( const plane_t *p_src, plane_t *p_dst,
             int i_fx = (int)( ( sx - i_sx ) * 256.0 );
             int i_fy = (int)( ( sy - i_sy ) * 256.0 );
 
-            uint8_t p00 = fill, p10 = fill, p01 = fill, p11 = fill;
+            const uint8_t *p_base = &p_src->p_pixels[i_sy * p_src->i_pitch
+                                                     + i_sx * i_pixel];
+            for( int c = 0; c < p_comp->i_channels; c++ )
+            {
+                const uint8_t *p_in = p_base + p_comp->pi_offset[c];
+                unsigned p00 = fill, p10 = fill, p01 = fill, p11 = fill;
 
-            if( i_sy >= 0 && i_sx >= 0 )
-                p00 = p_src->p_pixels[i_sy * p_src->i_pitch + i_sx];
-            if( i_sy >= 0 && i_sx + 1 < i_src_width )
-                p10 = p_src->p_pixels[i_sy * p_src->i_pitch + i_sx + 1];
-            if( i_sy + 1 < i_src_height && i_sx >= 0 )
-                p01 = p_src->p_pixels[( i_sy + 1 ) * p_src->i_pitch + i_sx];
-            if( i_sy + 1 < i_src_height && i_sx + 1 < i_src_width )
-                p11 = p_src->p_pixels[( i_sy + 1 ) * p_src->i_pitch + i_sx + 1];
+                if( i_sy >= 0 && i_sx >= 0 )
+                    p00 = GetSample( p_in, p_comp );
+                if( i_sy >= 0 && i_sx + 1 < i_src_width )
+                    p10 = GetSample( p_in + i_pixel, p_comp );
+                if( i_sy + 1 < i_src_height && i_sx >= 0 )
+                    p01 = GetSample( p_in + p_src->i_pitch, p_comp );
+                if( i_sy + 1 < i_src_height && i_sx + 1 < i_src_width )
+                    p11 = GetSample( p_in + p_src->i_pitch + i_pixel, p_comp );
 
-            unsigned int temp = 0;
-            temp += p00 * ( 256 - i_fy ) * ( 256 - i_fx );
-            temp += p01 * i_fy * ( 256 - i_fx );
-            temp += p11 * i_fx * i_fy;
-            temp += p10 * i_fx * ( 256 - i_fy );
-            p_out[x] = temp >> 16;
+                unsigned int temp = 0;
+                temp += p00 * ( 256 - i_fy ) * ( 256 - i_fx );
+                temp += p01 * i_fy * ( 256 - i_fx );
+                temp += p11 * i_fx * i_fy;
+                temp += p10 * i_fx * ( 256 - i_fy );
+                PutSample( &p_out[x * i_pixel + p_comp->pi_offset[c]],
+                           temp >> 16, p_comp );
+            }
 
             num_x += h0_sx;
             num_y += h3_sx;
@@ -362,115 +1157,5230 @@ static void RenderPlane( const plane_t *p_src, plane_t *p_dst,
 }
 
 /*****************************************************************************
- * DrawHandle: draw a small filled square on the Y plane of the output picture
+ * PrepareWarpMap: allocate a warp map for a plane geometry
+ *****************************************************************************
+ * The map is keyed on the geometry right away; its rows must then all be
+ * filled by BuildWarpMap() before it is used. Returns false if the map
+ * could not be allocated.
  *****************************************************************************/
-static void DrawHandle( picture_t *p_pic, int i_cx, int i_cy,
-                        int i_size, uint8_t y_val, uint8_t u_val,
-                        uint8_t v_val )
+static bool PrepareWarpMap( warp_map_t *p_map, const plane_t *p_src,
+                            const plane_t *p_dst,
+                            const warp_component_t *p_comp )
 {
-    for( int i_plane = 0; i_plane < p_pic->i_planes && i_plane < 3; i_plane++ )
-    {
-        plane_t *p = &p_pic->p[i_plane];
-        const int i_pw = p->i_visible_pitch / p->i_pixel_pitch;
-        const int i_ph = p->i_visible_lines;
-        const int i_yw = p_pic->p[Y_PLANE].i_visible_pitch
-                         / p_pic->p[Y_PLANE].i_pixel_pitch;
-        const int i_yh = p_pic->p[Y_PLANE].i_visible_lines;
-
-        /* Scale center and size to this plane's coordinate space */
-        int cx = i_cx * i_pw / i_yw;
-        int cy = i_cy * i_ph / i_yh;
-        int sz = i_size * i_pw / i_yw;
-        if( sz < 1 ) sz = 1;
-
-        int x0 = cx - sz; if( x0 < 0 ) x0 = 0;
-        int y0 = cy - sz; if( y0 < 0 ) y0 = 0;
-        int x1 = cx + sz; if( x1 > i_pw ) x1 = i_pw;
-        int y1 = cy + sz; if( y1 > i_ph ) y1 = i_ph;
-
-        uint8_t val = ( i_plane == Y_PLANE ) ? y_val
-                    : ( i_plane == U_PLANE ) ? u_val : v_val;
+    const int i_dst_width  = p_dst->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_dst_height = p_dst->i_visible_lines;
 
-        for( int y = y0; y < y1; y++ )
-            memset( &p->p_pixels[y * p->i_pitch + x0], val, x1 - x0 );
+    /* The maps of a profile are read-only, and not ours to reallocate */
+    if( p_map->b_mapped )
+    {
+        p_map->p_entries = NULL;
+        p_map->p_rows = NULL;
+        p_map->i_entries = p_map->i_rows = 0;
+        p_map->b_mapped = false;
     }
-}
 
-/*****************************************************************************
- * GetCornerPixelPos: compute the pixel position of a corner on the output
- *****************************************************************************/
-static void GetCornerPixelPos( int i_corner, int i_width, int i_height,
-                               float f_tl_x, float f_tl_y,
-                               float f_tr_x, float f_tr_y,
-                               float f_bl_x, float f_bl_y,
-                               float f_br_x, float f_br_y,
-                               int *pi_x, int *pi_y )
-{
-    switch( i_corner )
+    const size_t i_count = (size_t)i_dst_width * i_dst_height;
+    if( i_count > p_map->i_entries )
     {
-        case 0: /* TL */
-            *pi_x = (int)( f_tl_x * i_width );
-            *pi_y = (int)( f_tl_y * i_height );
-            break;
-        case 1: /* TR */
-            *pi_x = ( i_width - 1 ) + (int)( f_tr_x * i_width );
-            *pi_y = (int)( f_tr_y * i_height );
-            break;
-        case 2: /* BL */
-            *pi_x = (int)( f_bl_x * i_width );
-            *pi_y = ( i_height - 1 ) + (int)( f_bl_y * i_height );
-            break;
-        case 3: /* BR */
-            *pi_x = ( i_width - 1 ) + (int)( f_br_x * i_width );
-            *pi_y = ( i_height - 1 ) + (int)( f_br_y * i_height );
-            break;
-        default:
-            *pi_x = 0;
-            *pi_y = 0;
-            break;
+        warp_entry_t *p_entries = realloc( p_map->p_entries,
+                                           i_count * sizeof( *p_entries ) );
+        if( !p_entries )
+            return false;
+        p_map->p_entries = p_entries;
+        p_map->i_entries = i_count;
     }
+    if( (size_t)i_dst_height > p_map->i_rows )
+    {
+        warp_row_t *p_rows = realloc( p_map->p_rows,
+                                      i_dst_height * sizeof( *p_rows ) );
+        if( !p_rows )
+            return false;
+        p_map->p_rows = p_rows;
+        p_map->i_rows = i_dst_height;
+    }
+
+    p_map->i_dst_width  = i_dst_width;
+    p_map->i_dst_height = i_dst_height;
+    p_map->i_src_width  = p_src->i_visible_pitch / p_comp->i_pixel_size;
+    p_map->i_src_height = p_src->i_visible_lines;
+    p_map->i_src_pitch  = p_src->i_pitch;
+    p_map->i_pixel_size = p_comp->i_pixel_size;
+    return true;
 }
 
 /*****************************************************************************
- * Create: allocate and initialize keystone filter
+ * SetWarpEntry: source taps of the destination pixel sampling (sx, sy)
+ *****************************************************************************
+ * The entry is left alone for positions outside of the source, whose taps
+ * the caller cleared. Returns true if its blend is SIMD-safe: four taps
+ * inside the source, and top-left loads (32 bits or two pixels) within the
+ * source row.
  *****************************************************************************/
-static int Create( vlc_object_t *p_this )
+static bool SetWarpEntry( const warp_map_t *p_map, warp_entry_t *p_entry,
+                          double sx, double sy )
 {
-    filter_t *p_filter = (filter_t *)p_this;
+    const int i_src_width  = p_map->i_src_width;
+    const int i_src_height = p_map->i_src_height;
+    const int i_src_pitch  = p_map->i_src_pitch;
+    const int i_pixel_size = p_map->i_pixel_size;
+    /* Widest load of the interior kernels: 32 bits, or two whole pixels */
+    const int i_load_size  = __MAX( 4, 2 * i_pixel_size );
 
-    if( p_filter->fmt_in.video.i_chroma != p_filter->fmt_out.video.i_chroma )
+    int i_sx = (int)( sx >= 0 ? sx : sx - 1 );
+    int i_sy = (int)( sy >= 0 ? sy : sy - 1 );
+
+    if( i_sx < -1 || i_sx >= i_src_width
+     || i_sy < -1 || i_sy >= i_src_height )
+        return false;
+
+    int i_offset = i_sy * i_src_pitch + i_sx * i_pixel_size;
+    int i_fx = (int)( ( sx - i_sx ) * 256.0 );
+    int i_fy = (int)( ( sy - i_sy ) * 256.0 );
+    unsigned i_taps = 0;
+
+    if( i_sy >= 0 && i_sx >= 0 )
+        i_taps |= TAP_00;
+    if( i_sy >= 0 && i_sx + 1 < i_src_width )
+        i_taps |= TAP_10;
+    if( i_sy + 1 < i_src_height && i_sx >= 0 )
+        i_taps |= TAP_01;
+    if( i_sy + 1 < i_src_height && i_sx + 1 < i_src_width )
+        i_taps |= TAP_11;
+
+    /* A tiny negative coordinate gives a weight of 256: the far taps then
+     * carry all the weight, so move onto them */
+    if( i_fx == 256 )
     {
-        msg_Err( p_filter, "Input and output chromas don't match" );
-        return VLC_EGENERIC;
+        i_offset += i_pixel_size;
+        i_fx = 0;
+        i_taps = ( i_taps & ( TAP_10 | TAP_11 ) ) >> 1;
     }
-
-    /* Only accept planar YUV chromas that we can process pixel-by-pixel.
-     * On Windows, use --avcodec-hw=none to force software decoding so the
-     * decoder produces planar YUV instead of D3D11 opaque textures. */
-    switch( p_filter->fmt_in.video.i_chroma )
+    if( i_fy == 256 )
     {
-        CASE_PLANAR_YUV
-            break;
-        default:
-            msg_Dbg( p_filter, "Unsupported chroma (%4.4s), need planar YUV",
-                     (char *)&p_filter->fmt_in.video.i_chroma );
-            return VLC_EGENERIC;
+        i_offset += i_src_pitch;
+        i_fy = 0;
+        i_taps = ( i_taps & ( TAP_01 | TAP_11 ) ) >> 2;
     }
 
-    filter_sys_t *p_sys = malloc( sizeof( *p_sys ) );
-    if( !p_sys )
-        return VLC_ENOMEM;
-    p_filter->p_sys = p_sys;
+    p_entry->i_offset = i_offset;
+    p_entry->i_fx = i_fx;
+    p_entry->i_fy = i_fy;
+    p_entry->i_taps = i_taps;
 
-    config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
-                       p_filter->p_cfg );
+    return i_taps == TAP_ALL
+        && i_sx * i_pixel_size + i_load_size <= i_src_pitch;
+}
+
+/*****************************************************************************
+ * BuildWarpMap: precompute the source taps of rows [i_y_begin, i_y_end) of
+ * a prepared warp map
+ *****************************************************************************
+ * Walks the destination exactly like RenderPlane() so that rendering from
+ * the map is bit-exact with it; only the sampling is left for each frame.
+ *****************************************************************************/
+static void BuildWarpMap( warp_map_t *p_map, int i_y_width, int i_y_height,
+                          const double h[8], int i_y_begin, int i_y_end )
+{
+    const int i_dst_width  = p_map->i_dst_width;
+    const int i_dst_height = p_map->i_dst_height;
+    const int i_src_width  = p_map->i_src_width;
+    const int i_src_height = p_map->i_src_height;
+    const bool b_affine = h[6] == 0. && h[7] == 0.;
+
+    const double f_scale_x = (double)i_y_width / i_dst_width;
+    const double f_scale_y = (double)i_y_height / i_dst_height;
+    const double f_inv_scale_x = (double)i_dst_width / i_y_width;
+    const double f_inv_scale_y = (double)i_dst_height / i_y_height;
+
+    const double h0_sx = h[0] * f_scale_x;
+    const double h3_sx = h[3] * f_scale_x;
+    const double h6_sx = h[6] * f_scale_x;
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        warp_entry_t *p_entry = &p_map->p_entries[(size_t)y * i_dst_width];
+
+        const double dy = y * f_scale_y;
+
+        double num_x = h[1] * dy + h[2];
+        double num_y = h[4] * dy + h[5];
+        double den   = h[7] * dy + 1.0;
+
+        warp_row_t *p_row = &p_map->p_rows[y];
+        GetRowSpan( num_x, num_y, den, h0_sx, h3_sx, h6_sx,
+                    f_inv_scale_x, f_inv_scale_y,
+                    i_src_width, i_src_height, i_dst_width, 1,
+                    &p_row->i_begin, &p_row->i_end );
+
+        for( int x = 0; x < p_row->i_begin; x++ )
+        {
+            num_x += h0_sx;
+            num_y += h3_sx;
+            den   += h6_sx;
+        }
+        p_entry += p_row->i_begin;
+
+        /* Longest run of SIMD-safe pixels of the row */
+        int i_run_begin = p_row->i_begin;
+        int i_best_begin = i_run_begin, i_best_end = i_run_begin;
+
+        for( int x = p_row->i_begin; x < p_row->i_end; x++, p_entry++ )
+        {
+            bool b_inner = false;
+            p_entry->i_taps = 0;
+
+            /* den is exactly 1 for affine transforms */
+            if( fabs( den ) >= 1e-12 )
+                b_inner = SetWarpEntry( p_map, p_entry,
+                            ( b_affine ? num_x : num_x / den ) * f_inv_scale_x,
+                            ( b_affine ? num_y : num_y / den ) * f_inv_scale_y );
+
+            if( !b_inner )
+                i_run_begin = x + 1;
+            else if( x + 1 - i_run_begin > i_best_end - i_best_begin )
+            {
+                i_best_begin = i_run_begin;
+                i_best_end   = x + 1;
+            }
+
+            num_x += h0_sx;
+            num_y += h3_sx;
+            den   += h6_sx;
+        }
+
+        p_row->i_inner_begin = i_best_begin;
+        p_row->i_inner_end   = i_best_end;
+    }
+}
+
+/*****************************************************************************
+ * WarpMapMatches: check that a map was built for this plane geometry
+ *****************************************************************************/
+static bool WarpMapMatches( const warp_map_t *p_map, const plane_t *p_src,
+                            const plane_t *p_dst,
+                            const warp_component_t *p_comp )
+{
+    const int i_pixel = p_comp->i_pixel_size;
+
+    return p_map->p_entries != NULL
+        && p_map->i_dst_width  == p_dst->i_visible_pitch / i_pixel
+        && p_map->i_dst_height == p_dst->i_visible_lines
+        && p_map->i_src_width  == p_src->i_visible_pitch / i_pixel
+        && p_map->i_src_height == p_src->i_visible_lines
+        && p_map->i_src_pitch  == p_src->i_pitch
+        && p_map->i_pixel_size == i_pixel;
+}
+
+/*****************************************************************************
+ * BlendSpan: edge-aware bilinear blend of a run of warp map entries
+ *****************************************************************************/
+static void BlendSpan( uint8_t *p_out, const uint8_t *p_src, int i_src_pitch,
+                       const warp_entry_t *p_entry, int i_count, uint8_t fill )
+{
+    for( int x = 0; x < i_count; x++, p_entry++ )
+    {
+        const unsigned i_taps = p_entry->i_taps;
+        if( !i_taps )
+        {
+            p_out[x] = fill;
+            continue;
+        }
+
+        const uint8_t *p_in = &p_src[p_entry->i_offset];
+        const unsigned i_fx = p_entry->i_fx;
+        const unsigned i_fy = p_entry->i_fy;
+        unsigned p00, p10, p01, p11;
+
+        if( i_taps == TAP_ALL )
+        {
+            p00 = p_in[0];
+            p10 = p_in[1];
+            p01 = p_in[i_src_pitch];
+            p11 = p_in[i_src_pitch + 1];
+        }
+        else
+        {
+            p00 = ( i_taps & TAP_00 ) ? p_in[0] : fill;
+            p10 = ( i_taps & TAP_10 ) ? p_in[1] : fill;
+            p01 = ( i_taps & TAP_01 ) ? p_in[i_src_pitch] : fill;
+            p11 = ( i_taps & TAP_11 ) ? p_in[i_src_pitch + 1] : fill;
+        }
+
+        unsigned int temp = 0;
+        temp += p00 * ( 256 - i_fy ) * ( 256 - i_fx );
+        temp += p01 * i_fy * ( 256 - i_fx );
+        temp += p11 * i_fx * i_fy;
+        temp += p10 * i_fx * ( 256 - i_fy );
+        p_out[x] = temp >> 16;
+    }
+}
+
+/*****************************************************************************
+ * BlendSpanGeneric: BlendSpan() for any component layout: 2-byte samples in
+ * either byte order, and interleaved channels
+ *****************************************************************************/
+static void BlendSpanGeneric( uint8_t *p_out, const uint8_t *p_src,
+                              int i_src_pitch, const warp_entry_t *p_entry,
+                              int i_count, const warp_component_t *p_comp )
+{
+    const unsigned fill = p_comp->i_fill;
+    const int i_pixel = p_comp->i_pixel_size;
+
+    for( int x = 0; x < i_count; x++, p_entry++, p_out += i_pixel )
+    {
+        const unsigned i_taps = p_entry->i_taps;
+        if( !i_taps )
+        {
+            FillPixels( p_out, 1, p_comp );
+            continue;
+        }
+
+        const unsigned i_fx = p_entry->i_fx;
+        const unsigned i_fy = p_entry->i_fy;
+        const uint8_t *p_base = &p_src[p_entry->i_offset];
+
+        if( i_taps == TAP_ALL && p_comp->i_sample_size == 1 )
+        {
+            /* Packed 8-bit pixels without a kernel: same blend, inlined */
+            for( int c = 0; c < p_comp->i_channels; c++ )
+            {
+                const uint8_t *p_in = p_base + p_comp->pi_offset[c];
+                const unsigned i_top = p_in[0] * ( 256 - i_fx )
+                                     + p_in[i_pixel] * i_fx;
+                const unsigned i_bot = p_in[i_src_pitch] * ( 256 - i_fx )
+                                     + p_in[i_src_pitch + i_pixel] * i_fx;
+                p_out[p_comp->pi_offset[c]] =
+                    ( i_top * ( 256 - i_fy ) + i_bot * i_fy ) >> 16;
+            }
+            continue;
+        }
+
+        for( int c = 0; c < p_comp->i_channels; c++ )
+        {
+            const uint8_t *p_in = p_base + p_comp->pi_offset[c];
+            const unsigned p00 = ( i_taps & TAP_00 )
+                ? GetSample( p_in, p_comp ) : fill;
+            const unsigned p10 = ( i_taps & TAP_10 )
+                ? GetSample( p_in + i_pixel, p_comp ) : fill;
+            const unsigned p01 = ( i_taps & TAP_01 )
+                ? GetSample( p_in + i_src_pitch, p_comp ) : fill;
+            const unsigned p11 = ( i_taps & TAP_11 )
+                ? GetSample( p_in + i_src_pitch + i_pixel, p_comp ) : fill;
+
+            unsigned int temp = 0;
+            temp += p00 * ( 256 - i_fy ) * ( 256 - i_fx );
+            temp += p01 * i_fy * ( 256 - i_fx );
+            temp += p11 * i_fx * i_fy;
+            temp += p10 * i_fx * ( 256 - i_fy );
+            PutSample( &p_out[p_comp->pi_offset[c]], temp >> 16, p_comp );
+        }
+    }
+}
+
+/*****************************************************************************
+ * Interior kernels
+ *****************************************************************************
+ * All taps are in bounds, so the blend is a branchless gather. The vertical
+ * pass is factored as (256-fy) * top + fy * bottom, where top and bottom
+ * are the horizontal blends: this is the same integer as the 4-term sum
+ * used by the C code, so the results are bit-exact with it.
+ *****************************************************************************/
+#if defined(X86_KERNELS) || defined(__ARM_NEON)
+static inline uint16_t Load16( const uint8_t *p )
+{
+    uint16_t i_val;
+    memcpy( &i_val, p, sizeof( i_val ) );
+    return i_val;
+}
+#endif
+
+#if defined(X86_KERNELS)
+X86_TARGET( "sse2" )
+static int BlendInterior_SSE2( uint8_t *p_out, const uint8_t *p_src,
+                               int i_src_pitch, const warp_entry_t *p_entry,
+                               int i_count )
+{
+    const __m128i c256  = _mm_set1_epi16( 256 );
+    const __m128i cmask = _mm_set1_epi16( 0xff );
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        /* Fetch p00|p10 and p01|p11 pairs (little-endian) */
+        __m128i top = _mm_setzero_si128(), bot = _mm_setzero_si128();
+#define LOAD_TAPS( k ) do { \
+            const uint8_t *p_in = &p_src[p_entry[k].i_offset]; \
+            top = _mm_insert_epi16( top, Load16( p_in ), k ); \
+            bot = _mm_insert_epi16( bot, Load16( p_in + i_src_pitch ), k ); \
+        } while( 0 )
+        LOAD_TAPS( 0 ); LOAD_TAPS( 1 ); LOAD_TAPS( 2 ); LOAD_TAPS( 3 );
+        LOAD_TAPS( 4 ); LOAD_TAPS( 5 ); LOAD_TAPS( 6 ); LOAD_TAPS( 7 );
+#undef LOAD_TAPS
+
+        /* Extract the weight words (fx | fy << 8 | taps << 16) */
+        const __m128 e0 = _mm_loadu_ps( (const float *)&p_entry[0] );
+        const __m128 e1 = _mm_loadu_ps( (const float *)&p_entry[2] );
+        const __m128 e2 = _mm_loadu_ps( (const float *)&p_entry[4] );
+        const __m128 e3 = _mm_loadu_ps( (const float *)&p_entry[6] );
+        const __m128i w_lo = _mm_castps_si128(
+            _mm_shuffle_ps( e0, e1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+        const __m128i w_hi = _mm_castps_si128(
+            _mm_shuffle_ps( e2, e3, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+        const __m128i fx = _mm_packs_epi32(
+            _mm_and_si128( w_lo, _mm_set1_epi32( 0xff ) ),
+            _mm_and_si128( w_hi, _mm_set1_epi32( 0xff ) ) );
+        const __m128i fy = _mm_packs_epi32(
+            _mm_and_si128( _mm_srli_epi32( w_lo, 8 ), _mm_set1_epi32( 0xff ) ),
+            _mm_and_si128( _mm_srli_epi32( w_hi, 8 ), _mm_set1_epi32( 0xff ) ) );
+        const __m128i fx0 = _mm_sub_epi16( c256, fx );
+        const __m128i fy0 = _mm_sub_epi16( c256, fy );
+
+        /* Horizontal pass, fits in 16 bits (at most 255 * 256) */
+        const __m128i t = _mm_add_epi16(
+            _mm_mullo_epi16( _mm_and_si128( top, cmask ), fx0 ),
+            _mm_mullo_epi16( _mm_srli_epi16( top, 8 ), fx ) );
+        const __m128i b = _mm_add_epi16(
+            _mm_mullo_epi16( _mm_and_si128( bot, cmask ), fx0 ),
+            _mm_mullo_epi16( _mm_srli_epi16( bot, 8 ), fx ) );
+
+        /* Vertical pass, 16x16 -> 32-bit products */
+        const __m128i tl = _mm_mullo_epi16( t, fy0 );
+        const __m128i th = _mm_mulhi_epu16( t, fy0 );
+        const __m128i bl = _mm_mullo_epi16( b, fy );
+        const __m128i bh = _mm_mulhi_epu16( b, fy );
+        const __m128i s0 = _mm_add_epi32( _mm_unpacklo_epi16( tl, th ),
+                                          _mm_unpacklo_epi16( bl, bh ) );
+        const __m128i s1 = _mm_add_epi32( _mm_unpackhi_epi16( tl, th ),
+                                          _mm_unpackhi_epi16( bl, bh ) );
+
+        const __m128i r = _mm_packs_epi32( _mm_srli_epi32( s0, 16 ),
+                                           _mm_srli_epi32( s1, 16 ) );
+        _mm_storel_epi64( (__m128i *)&p_out[x], _mm_packus_epi16( r, r ) );
+    }
+    return x;
+}
+#endif
+
+#if defined(X86_KERNELS)
+X86_TARGET( "avx2" )
+static int BlendInterior_AVX2( uint8_t *p_out, const uint8_t *p_src,
+                               int i_src_pitch, const warp_entry_t *p_entry,
+                               int i_count )
+{
+    const __m256i c256   = _mm256_set1_epi32( 256 );
+    const __m256i cmask  = _mm256_set1_epi32( 0xff );
+    const __m256i split  = _mm256_setr_epi32( 0, 2, 4, 6, 1, 3, 5, 7 );
+    /* Spread bytes 0 and 1 of each dword to its two 16-bit halves */
+    const __m256i spread = _mm256_setr_epi8(
+        0, -1, 1, -1, 4, -1, 5, -1, 8, -1, 9, -1, 12, -1, 13, -1,
+        0, -1, 1, -1, 4, -1, 5, -1, 8, -1, 9, -1, 12, -1, 13, -1 );
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        /* Deinterleave 8 entries into offsets and weight words */
+        const __m256i e0 = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256( (const __m256i *)&p_entry[0] ), split );
+        const __m256i e1 = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256( (const __m256i *)&p_entry[4] ), split );
+        const __m256i off = _mm256_permute2x128_si256( e0, e1, 0x20 );
+        const __m256i w   = _mm256_permute2x128_si256( e0, e1, 0x31 );
+
+        /* The row run guarantees the 32-bit loads stay within the rows */
+        const __m256i top = _mm256_i32gather_epi32(
+            (const int *)p_src, off, 1 );
+        const __m256i bot = _mm256_i32gather_epi32(
+            (const int *)( p_src + i_src_pitch ), off, 1 );
+
+        const __m256i fx = _mm256_and_si256( w, cmask );
+        const __m256i fy = _mm256_and_si256( _mm256_srli_epi32( w, 8 ), cmask );
+        const __m256i wx = _mm256_or_si256( _mm256_sub_epi32( c256, fx ),
+                                            _mm256_slli_epi32( fx, 16 ) );
+
+        /* Horizontal pass: p00 * (256 - fx) + p10 * fx in one madd */
+        const __m256i t = _mm256_madd_epi16(
+            _mm256_shuffle_epi8( top, spread ), wx );
+        const __m256i b = _mm256_madd_epi16(
+            _mm256_shuffle_epi8( bot, spread ), wx );
+
+        /* Vertical pass: (256 - fy) * t + fy * b == 256 * t + fy * (b - t) */
+        const __m256i sum = _mm256_add_epi32( _mm256_slli_epi32( t, 8 ),
+            _mm256_mullo_epi32( _mm256_sub_epi32( b, t ), fy ) );
+        const __m256i r = _mm256_srli_epi32( sum, 16 );
+
+        const __m128i r16 = _mm_packs_epi32( _mm256_castsi256_si128( r ),
+                                             _mm256_extracti128_si256( r, 1 ) );
+        _mm_storel_epi64( (__m128i *)&p_out[x], _mm_packus_epi16( r16, r16 ) );
+    }
+    return x;
+}
+
+/* Same as AVX2 on 16 pixels, the end of the run being left to it */
+X86_TARGET( "avx512f,avx512bw" )
+static int BlendInterior_AVX512( uint8_t *p_out, const uint8_t *p_src,
+                                 int i_src_pitch, const warp_entry_t *p_entry,
+                                 int i_count )
+{
+    const __m512i c256  = _mm512_set1_epi32( 256 );
+    const __m512i cmask = _mm512_set1_epi32( 0xff );
+    const __m512i even  = _mm512_setr_epi32( 0, 2, 4, 6, 8, 10, 12, 14,
+                                             16, 18, 20, 22, 24, 26, 28, 30 );
+    const __m512i odd   = _mm512_add_epi32( even, _mm512_set1_epi32( 1 ) );
+    const __m512i spread = _mm512_broadcast_i32x4( _mm_setr_epi8(
+        0, -1, 1, -1, 4, -1, 5, -1, 8, -1, 9, -1, 12, -1, 13, -1 ) );
+    int x = 0;
+
+    for( ; x + 16 <= i_count; x += 16, p_entry += 16 )
+    {
+        /* Offsets are the even dwords of the entries, weights the odd */
+        const __m512i e0 = _mm512_loadu_si512( &p_entry[0] );
+        const __m512i e1 = _mm512_loadu_si512( &p_entry[8] );
+        const __m512i off = _mm512_permutex2var_epi32( e0, even, e1 );
+        const __m512i w   = _mm512_permutex2var_epi32( e0, odd, e1 );
+
+        const __m512i top = _mm512_i32gather_epi32( off, p_src, 1 );
+        const __m512i bot = _mm512_i32gather_epi32( off, p_src + i_src_pitch,
+                                                    1 );
+
+        const __m512i fx = _mm512_and_si512( w, cmask );
+        const __m512i fy = _mm512_and_si512( _mm512_srli_epi32( w, 8 ), cmask );
+        const __m512i wx = _mm512_or_si512( _mm512_sub_epi32( c256, fx ),
+                                            _mm512_slli_epi32( fx, 16 ) );
+
+        const __m512i t = _mm512_madd_epi16(
+            _mm512_shuffle_epi8( top, spread ), wx );
+        const __m512i b = _mm512_madd_epi16(
+            _mm512_shuffle_epi8( bot, spread ), wx );
+        const __m512i sum = _mm512_add_epi32( _mm512_slli_epi32( t, 8 ),
+            _mm512_mullo_epi32( _mm512_sub_epi32( b, t ), fy ) );
+
+        /* At most 255: the truncating narrowing is exact */
+        _mm_storeu_si128( (__m128i *)&p_out[x],
+                          _mm512_cvtepi32_epi8( _mm512_srli_epi32( sum, 16 ) ) );
+    }
+    return x + BlendInterior_AVX2( &p_out[x], p_src, i_src_pitch, p_entry,
+                                   i_count - x );
+}
+#endif
+
+#if defined(__ARM_NEON)
+static int BlendInterior_NEON( uint8_t *p_out, const uint8_t *p_src,
+                               int i_src_pitch, const warp_entry_t *p_entry,
+                               int i_count )
+{
+    const uint16x8_t c256  = vdupq_n_u16( 256 );
+    const uint16x8_t cmask = vdupq_n_u16( 0xff );
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        uint16_t pi_top[8], pi_bot[8];
+        for( int k = 0; k < 8; k++ )
+        {
+            const uint8_t *p_in = &p_src[p_entry[k].i_offset];
+            pi_top[k] = Load16( p_in );
+            pi_bot[k] = Load16( p_in + i_src_pitch );
+        }
+        const uint16x8_t top = vld1q_u16( pi_top );
+        const uint16x8_t bot = vld1q_u16( pi_bot );
+
+        /* val[1] holds the weight words (fx | fy << 8 | taps << 16) */
+        const uint32x4x2_t e0 = vld2q_u32( (const uint32_t *)&p_entry[0] );
+        const uint32x4x2_t e1 = vld2q_u32( (const uint32_t *)&p_entry[4] );
+        const uint16x8_t w = vcombine_u16( vmovn_u32( e0.val[1] ),
+                                           vmovn_u32( e1.val[1] ) );
+        const uint16x8_t fx  = vandq_u16( w, cmask );
+        const uint16x8_t fy  = vshrq_n_u16( w, 8 );
+        const uint16x8_t fx0 = vsubq_u16( c256, fx );
+        const uint16x8_t fy0 = vsubq_u16( c256, fy );
+
+        const uint16x8_t t = vmlaq_u16( vmulq_u16( vandq_u16( top, cmask ), fx0 ),
+                                        vshrq_n_u16( top, 8 ), fx );
+        const uint16x8_t b = vmlaq_u16( vmulq_u16( vandq_u16( bot, cmask ), fx0 ),
+                                        vshrq_n_u16( bot, 8 ), fx );
+
+        const uint32x4_t s0 = vmlal_u16( vmull_u16( vget_low_u16( t ),
+                                                    vget_low_u16( fy0 ) ),
+                                         vget_low_u16( b ), vget_low_u16( fy ) );
+        const uint32x4_t s1 = vmlal_u16( vmull_u16( vget_high_u16( t ),
+                                                    vget_high_u16( fy0 ) ),
+                                         vget_high_u16( b ), vget_high_u16( fy ) );
+
+        const uint16x8_t r = vcombine_u16( vshrn_n_u32( s0, 16 ),
+                                           vshrn_n_u32( s1, 16 ) );
+        vst1_u8( &p_out[x], vmovn_u16( r ) );
+    }
+    return x;
+}
+#endif
+
+/*****************************************************************************
+ * 2-byte interior kernels
+ *****************************************************************************
+ * Same blend on little-endian samples. A 32-bit load at the tap offset gets
+ * p00 | p10 << 16, so the horizontal pass is a single multiply-add of each
+ * pair with (256 - fx) | fx << 16. The x86 ones use signed 16-bit madd and
+ * saturating packs, which holds for samples of up to 15 bits.
+ *****************************************************************************/
+#if defined(X86_KERNELS) || defined(__ARM_NEON)
+static inline uint32_t Load32( const uint8_t *p )
+{
+    uint32_t i_val;
+    memcpy( &i_val, p, sizeof( i_val ) );
+    return i_val;
+}
+#endif
+
+#if defined(X86_KERNELS)
+/* 32-bit low multiply, which SSE2 only has for the even lanes */
+X86_TARGET( "sse2" )
+static inline __m128i MulLo32_SSE2( __m128i a, __m128i b )
+{
+    const __m128i even = _mm_mul_epu32( a, b );
+    const __m128i odd  = _mm_mul_epu32( _mm_srli_epi64( a, 32 ),
+                                        _mm_srli_epi64( b, 32 ) );
+    return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+                               _mm_shuffle_epi32( odd,  _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+X86_TARGET( "sse2" )
+static int BlendInterior16_SSE2( uint8_t *p_out, const uint8_t *p_src,
+                                 int i_src_pitch, const warp_entry_t *p_entry,
+                                 int i_count )
+{
+    const __m128i c256  = _mm_set1_epi32( 256 );
+    const __m128i cmask = _mm_set1_epi32( 0xff );
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        __m128i r[2];
+
+        for( int k = 0; k < 2; k++ )
+        {
+            const warp_entry_t *e = &p_entry[4 * k];
+            const uint8_t *p0 = &p_src[e[0].i_offset];
+            const uint8_t *p1 = &p_src[e[1].i_offset];
+            const uint8_t *p2 = &p_src[e[2].i_offset];
+            const uint8_t *p3 = &p_src[e[3].i_offset];
+
+            const __m128i top = _mm_setr_epi32( Load32( p0 ), Load32( p1 ),
+                                                Load32( p2 ), Load32( p3 ) );
+            const __m128i bot = _mm_setr_epi32(
+                Load32( p0 + i_src_pitch ), Load32( p1 + i_src_pitch ),
+                Load32( p2 + i_src_pitch ), Load32( p3 + i_src_pitch ) );
+
+            const __m128i w = _mm_castps_si128( _mm_shuffle_ps(
+                _mm_loadu_ps( (const float *)&e[0] ),
+                _mm_loadu_ps( (const float *)&e[2] ), _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+            const __m128i fx = _mm_and_si128( w, cmask );
+            const __m128i fy = _mm_and_si128( _mm_srli_epi32( w, 8 ), cmask );
+            const __m128i wx = _mm_or_si128( _mm_sub_epi32( c256, fx ),
+                                             _mm_slli_epi32( fx, 16 ) );
+
+            const __m128i t = _mm_madd_epi16( top, wx );
+            const __m128i b = _mm_madd_epi16( bot, wx );
+            const __m128i sum = _mm_add_epi32( _mm_slli_epi32( t, 8 ),
+                MulLo32_SSE2( _mm_sub_epi32( b, t ), fy ) );
+            r[k] = _mm_srli_epi32( sum, 16 );
+        }
+        _mm_storeu_si128( (__m128i *)&p_out[2 * x],
+                          _mm_packs_epi32( r[0], r[1] ) );
+    }
+    return x;
+}
+
+/* SSE4.1 has the 32-bit multiply and the unsigned pack */
+X86_TARGET( "sse4.1" )
+static int BlendInterior16_SSE41( uint8_t *p_out, const uint8_t *p_src,
+                                  int i_src_pitch, const warp_entry_t *p_entry,
+                                  int i_count )
+{
+    const __m128i c256  = _mm_set1_epi32( 256 );
+    const __m128i cmask = _mm_set1_epi32( 0xff );
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        __m128i r[2];
+
+        for( int k = 0; k < 2; k++ )
+        {
+            const warp_entry_t *e = &p_entry[4 * k];
+            __m128i top = _mm_cvtsi32_si128( Load32( &p_src[e[0].i_offset] ) );
+            __m128i bot = _mm_cvtsi32_si128(
+                Load32( &p_src[e[0].i_offset + i_src_pitch] ) );
+#define LOAD_TAPS( j ) do { \
+                const uint8_t *p_in = &p_src[e[j].i_offset]; \
+                top = _mm_insert_epi32( top, Load32( p_in ), j ); \
+                bot = _mm_insert_epi32( bot, Load32( p_in + i_src_pitch ), j ); \
+            } while( 0 )
+            LOAD_TAPS( 1 ); LOAD_TAPS( 2 ); LOAD_TAPS( 3 );
+#undef LOAD_TAPS
+
+            const __m128i w = _mm_castps_si128( _mm_shuffle_ps(
+                _mm_loadu_ps( (const float *)&e[0] ),
+                _mm_loadu_ps( (const float *)&e[2] ), _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+            const __m128i fx = _mm_and_si128( w, cmask );
+            const __m128i fy = _mm_and_si128( _mm_srli_epi32( w, 8 ), cmask );
+            const __m128i wx = _mm_or_si128( _mm_sub_epi32( c256, fx ),
+                                             _mm_slli_epi32( fx, 16 ) );
+
+            const __m128i t = _mm_madd_epi16( top, wx );
+            const __m128i b = _mm_madd_epi16( bot, wx );
+            const __m128i sum = _mm_add_epi32( _mm_slli_epi32( t, 8 ),
+                _mm_mullo_epi32( _mm_sub_epi32( b, t ), fy ) );
+            r[k] = _mm_srli_epi32( sum, 16 );
+        }
+        _mm_storeu_si128( (__m128i *)&p_out[2 * x],
+                          _mm_packus_epi32( r[0], r[1] ) );
+    }
+    return x;
+}
+#endif
+
+#if defined(X86_KERNELS)
+X86_TARGET( "avx2" )
+static int BlendInterior16_AVX2( uint8_t *p_out, const uint8_t *p_src,
+                                 int i_src_pitch, const warp_entry_t *p_entry,
+                                 int i_count )
+{
+    const __m256i c256  = _mm256_set1_epi32( 256 );
+    const __m256i cmask = _mm256_set1_epi32( 0xff );
+    const __m256i split = _mm256_setr_epi32( 0, 2, 4, 6, 1, 3, 5, 7 );
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        const __m256i e0 = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256( (const __m256i *)&p_entry[0] ), split );
+        const __m256i e1 = _mm256_permutevar8x32_epi32(
+            _mm256_loadu_si256( (const __m256i *)&p_entry[4] ), split );
+        const __m256i off = _mm256_permute2x128_si256( e0, e1, 0x20 );
+        const __m256i w   = _mm256_permute2x128_si256( e0, e1, 0x31 );
+
+        const __m256i top = _mm256_i32gather_epi32(
+            (const int *)p_src, off, 1 );
+        const __m256i bot = _mm256_i32gather_epi32(
+            (const int *)( p_src + i_src_pitch ), off, 1 );
+
+        const __m256i fx = _mm256_and_si256( w, cmask );
+        const __m256i fy = _mm256_and_si256( _mm256_srli_epi32( w, 8 ), cmask );
+        const __m256i wx = _mm256_or_si256( _mm256_sub_epi32( c256, fx ),
+                                            _mm256_slli_epi32( fx, 16 ) );
+
+        const __m256i t = _mm256_madd_epi16( top, wx );
+        const __m256i b = _mm256_madd_epi16( bot, wx );
+        const __m256i sum = _mm256_add_epi32( _mm256_slli_epi32( t, 8 ),
+            _mm256_mullo_epi32( _mm256_sub_epi32( b, t ), fy ) );
+        const __m256i r = _mm256_srli_epi32( sum, 16 );
+
+        _mm_storeu_si128( (__m128i *)&p_out[2 * x],
+                          _mm_packus_epi32( _mm256_castsi256_si128( r ),
+                                            _mm256_extracti128_si256( r, 1 ) ) );
+    }
+    return x;
+}
+
+X86_TARGET( "avx512f,avx512bw" )
+static int BlendInterior16_AVX512( uint8_t *p_out, const uint8_t *p_src,
+                                   int i_src_pitch,
+                                   const warp_entry_t *p_entry, int i_count )
+{
+    const __m512i c256  = _mm512_set1_epi32( 256 );
+    const __m512i cmask = _mm512_set1_epi32( 0xff );
+    const __m512i even  = _mm512_setr_epi32( 0, 2, 4, 6, 8, 10, 12, 14,
+                                             16, 18, 20, 22, 24, 26, 28, 30 );
+    const __m512i odd   = _mm512_add_epi32( even, _mm512_set1_epi32( 1 ) );
+    int x = 0;
+
+    for( ; x + 16 <= i_count; x += 16, p_entry += 16 )
+    {
+        const __m512i e0 = _mm512_loadu_si512( &p_entry[0] );
+        const __m512i e1 = _mm512_loadu_si512( &p_entry[8] );
+        const __m512i off = _mm512_permutex2var_epi32( e0, even, e1 );
+        const __m512i w   = _mm512_permutex2var_epi32( e0, odd, e1 );
+
+        const __m512i top = _mm512_i32gather_epi32( off, p_src, 1 );
+        const __m512i bot = _mm512_i32gather_epi32( off, p_src + i_src_pitch,
+                                                    1 );
+
+        const __m512i fx = _mm512_and_si512( w, cmask );
+        const __m512i fy = _mm512_and_si512( _mm512_srli_epi32( w, 8 ), cmask );
+        const __m512i wx = _mm512_or_si512( _mm512_sub_epi32( c256, fx ),
+                                            _mm512_slli_epi32( fx, 16 ) );
+
+        const __m512i t = _mm512_madd_epi16( top, wx );
+        const __m512i b = _mm512_madd_epi16( bot, wx );
+        const __m512i sum = _mm512_add_epi32( _mm512_slli_epi32( t, 8 ),
+            _mm512_mullo_epi32( _mm512_sub_epi32( b, t ), fy ) );
+
+        _mm256_storeu_si256( (__m256i *)&p_out[2 * x],
+                             _mm512_cvtepi32_epi16(
+                                 _mm512_srli_epi32( sum, 16 ) ) );
+    }
+    return x + BlendInterior16_AVX2( &p_out[2 * x], p_src, i_src_pitch,
+                                     p_entry, i_count - x );
+}
+#endif
+
+#if defined(__ARM_NEON)
+static int BlendInterior16_NEON( uint8_t *p_out, const uint8_t *p_src,
+                                 int i_src_pitch, const warp_entry_t *p_entry,
+                                 int i_count )
+{
+    const uint16x8_t c256  = vdupq_n_u16( 256 );
+    const uint16x8_t cmask = vdupq_n_u16( 0xff );
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        uint32_t pi_top[8], pi_bot[8];
+        for( int k = 0; k < 8; k++ )
+        {
+            const uint8_t *p_in = &p_src[p_entry[k].i_offset];
+            pi_top[k] = Load32( p_in );
+            pi_bot[k] = Load32( p_in + i_src_pitch );
+        }
+        /* val[0] holds the left taps, val[1] the right ones */
+        const uint16x8x2_t top = vld2q_u16( (const uint16_t *)pi_top );
+        const uint16x8x2_t bot = vld2q_u16( (const uint16_t *)pi_bot );
+
+        const uint32x4x2_t e0 = vld2q_u32( (const uint32_t *)&p_entry[0] );
+        const uint32x4x2_t e1 = vld2q_u32( (const uint32_t *)&p_entry[4] );
+        const uint16x8_t w = vcombine_u16( vmovn_u32( e0.val[1] ),
+                                           vmovn_u32( e1.val[1] ) );
+        const uint16x8_t fx  = vandq_u16( w, cmask );
+        const uint16x8_t fy  = vshrq_n_u16( w, 8 );
+        const uint16x8_t fx0 = vsubq_u16( c256, fx );
+        const uint16x8_t fy0 = vsubq_u16( c256, fy );
+
+#define BLEND_HALF( get ) \
+        vmlaq_u32( vmulq_u32( \
+            vmlal_u16( vmull_u16( get( top.val[0] ), get( fx0 ) ), \
+                       get( top.val[1] ), get( fx ) ), \
+            vmovl_u16( get( fy0 ) ) ), \
+            vmlal_u16( vmull_u16( get( bot.val[0] ), get( fx0 ) ), \
+                       get( bot.val[1] ), get( fx ) ), \
+            vmovl_u16( get( fy ) ) )
+        const uint32x4_t s0 = BLEND_HALF( vget_low_u16 );
+        const uint32x4_t s1 = BLEND_HALF( vget_high_u16 );
+#undef BLEND_HALF
+
+        vst1q_u16( (uint16_t *)&p_out[2 * x],
+                   vcombine_u16( vshrn_n_u32( s0, 16 ), vshrn_n_u32( s1, 16 ) ) );
+    }
+    return x;
+}
+#endif
+
+/*****************************************************************************
+ * 2-channel interior kernels
+ *****************************************************************************
+ * Same blend on the interleaved CbCr plane of the semi-planar formats. A
+ * 32-bit load at the tap offset gets the left and right pixels, whose two
+ * samples are blended with the weights of the pixel.
+ *****************************************************************************/
+#if defined(X86_KERNELS)
+X86_TARGET( "sse2" )
+static int BlendInteriorUV_SSE2( uint8_t *p_out, const uint8_t *p_src,
+                                 int i_src_pitch, const warp_entry_t *p_entry,
+                                 int i_count )
+{
+    const __m128i c256  = _mm_set1_epi16( 256 );
+    const __m128i cmask = _mm_set1_epi32( 0xff );
+    const __m128i zero  = _mm_setzero_si128();
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        uint32_t pi_top[8], pi_bot[8];
+        for( int k = 0; k < 8; k++ )
+        {
+            const uint8_t *p_in = &p_src[p_entry[k].i_offset];
+            pi_top[k] = Load32( p_in );
+            pi_bot[k] = Load32( p_in + i_src_pitch );
+        }
+
+        /* Split the words into left and right pixels (U | V << 8) */
+#define SPLIT( pi, left, right ) do { \
+            const __m128i d0 = _mm_loadu_si128( (const __m128i *)&pi[0] ); \
+            const __m128i d1 = _mm_loadu_si128( (const __m128i *)&pi[4] ); \
+            left = _mm_packs_epi32( \
+                _mm_srai_epi32( _mm_slli_epi32( d0, 16 ), 16 ), \
+                _mm_srai_epi32( _mm_slli_epi32( d1, 16 ), 16 ) ); \
+            right = _mm_packs_epi32( _mm_srai_epi32( d0, 16 ), \
+                                     _mm_srai_epi32( d1, 16 ) ); \
+        } while( 0 )
+        __m128i top_l, top_r, bot_l, bot_r;
+        SPLIT( pi_top, top_l, top_r );
+        SPLIT( pi_bot, bot_l, bot_r );
+#undef SPLIT
+
+        const __m128 e0 = _mm_loadu_ps( (const float *)&p_entry[0] );
+        const __m128 e1 = _mm_loadu_ps( (const float *)&p_entry[2] );
+        const __m128 e2 = _mm_loadu_ps( (const float *)&p_entry[4] );
+        const __m128 e3 = _mm_loadu_ps( (const float *)&p_entry[6] );
+        const __m128i w_lo = _mm_castps_si128(
+            _mm_shuffle_ps( e0, e1, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+        const __m128i w_hi = _mm_castps_si128(
+            _mm_shuffle_ps( e2, e3, _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+        const __m128i fx = _mm_packs_epi32(
+            _mm_and_si128( w_lo, cmask ), _mm_and_si128( w_hi, cmask ) );
+        const __m128i fy = _mm_packs_epi32(
+            _mm_and_si128( _mm_srli_epi32( w_lo, 8 ), cmask ),
+            _mm_and_si128( _mm_srli_epi32( w_hi, 8 ), cmask ) );
+
+        /* Each half holds 4 pixels, with their weights duplicated */
+        __m128i r[2];
+        for( int k = 0; k < 2; k++ )
+        {
+#define HALF( v ) ( k ? _mm_unpackhi_epi8( v, zero ) \
+                          : _mm_unpacklo_epi8( v, zero ) )
+#define DUP( v ) ( k ? _mm_unpackhi_epi16( v, v ) : _mm_unpacklo_epi16( v, v ) )
+            const __m128i wx  = DUP( fx ), wy = DUP( fy );
+            const __m128i wx0 = _mm_sub_epi16( c256, wx );
+            const __m128i wy0 = _mm_sub_epi16( c256, wy );
+
+            const __m128i t = _mm_add_epi16(
+                _mm_mullo_epi16( HALF( top_l ), wx0 ),
+                _mm_mullo_epi16( HALF( top_r ), wx ) );
+            const __m128i b = _mm_add_epi16(
+                _mm_mullo_epi16( HALF( bot_l ), wx0 ),
+                _mm_mullo_epi16( HALF( bot_r ), wx ) );
+#undef DUP
+#undef HALF
+
+            const __m128i tl = _mm_mullo_epi16( t, wy0 );
+            const __m128i th = _mm_mulhi_epu16( t, wy0 );
+            const __m128i bl = _mm_mullo_epi16( b, wy );
+            const __m128i bh = _mm_mulhi_epu16( b, wy );
+            const __m128i s0 = _mm_add_epi32( _mm_unpacklo_epi16( tl, th ),
+                                              _mm_unpacklo_epi16( bl, bh ) );
+            const __m128i s1 = _mm_add_epi32( _mm_unpackhi_epi16( tl, th ),
+                                              _mm_unpackhi_epi16( bl, bh ) );
+            r[k] = _mm_packs_epi32( _mm_srli_epi32( s0, 16 ),
+                                    _mm_srli_epi32( s1, 16 ) );
+        }
+        _mm_storeu_si128( (__m128i *)&p_out[2 * x],
+                          _mm_packus_epi16( r[0], r[1] ) );
+    }
+    return x;
+}
+#endif
+
+#if defined(__ARM_NEON)
+static int BlendInteriorUV_NEON( uint8_t *p_out, const uint8_t *p_src,
+                                 int i_src_pitch, const warp_entry_t *p_entry,
+                                 int i_count )
+{
+    const uint16x8_t c256  = vdupq_n_u16( 256 );
+    const uint16x8_t cmask = vdupq_n_u16( 0xff );
+    int x = 0;
+
+    for( ; x + 8 <= i_count; x += 8, p_entry += 8 )
+    {
+        uint32_t pi_top[8], pi_bot[8];
+        for( int k = 0; k < 8; k++ )
+        {
+            const uint8_t *p_in = &p_src[p_entry[k].i_offset];
+            pi_top[k] = Load32( p_in );
+            pi_bot[k] = Load32( p_in + i_src_pitch );
+        }
+        /* val[0] holds the left pixels, val[1] the right ones */
+        const uint16x8x2_t top = vld2q_u16( (const uint16_t *)pi_top );
+        const uint16x8x2_t bot = vld2q_u16( (const uint16_t *)pi_bot );
+
+        const uint32x4x2_t e0 = vld2q_u32( (const uint32_t *)&p_entry[0] );
+        const uint32x4x2_t e1 = vld2q_u32( (const uint32_t *)&p_entry[4] );
+        const uint16x8_t w = vcombine_u16( vmovn_u32( e0.val[1] ),
+                                           vmovn_u32( e1.val[1] ) );
+        /* Weights duplicated for both samples of a pixel */
+        const uint16x8x2_t fx = vzipq_u16( vandq_u16( w, cmask ),
+                                           vandq_u16( w, cmask ) );
+        const uint16x8x2_t fy = vzipq_u16( vshrq_n_u16( w, 8 ),
+                                           vshrq_n_u16( w, 8 ) );
+
+        uint8x8_t r[2];
+        for( int k = 0; k < 2; k++ )
+        {
+#define HALF( v ) vmovl_u8( k ? vget_high_u8( vreinterpretq_u8_u16( v ) ) \
+                                : vget_low_u8( vreinterpretq_u8_u16( v ) ) )
+            const uint16x8_t fx0 = vsubq_u16( c256, fx.val[k] );
+            const uint16x8_t fy0 = vsubq_u16( c256, fy.val[k] );
+            const uint16x8_t t = vmlaq_u16( vmulq_u16( HALF( top.val[0] ), fx0 ),
+                                            HALF( top.val[1] ), fx.val[k] );
+            const uint16x8_t b = vmlaq_u16( vmulq_u16( HALF( bot.val[0] ), fx0 ),
+                                            HALF( bot.val[1] ), fx.val[k] );
+#undef HALF
+            const uint32x4_t s0 = vmlal_u16(
+                vmull_u16( vget_low_u16( t ), vget_low_u16( fy0 ) ),
+                vget_low_u16( b ), vget_low_u16( fy.val[k] ) );
+            const uint32x4_t s1 = vmlal_u16(
+                vmull_u16( vget_high_u16( t ), vget_high_u16( fy0 ) ),
+                vget_high_u16( b ), vget_high_u16( fy.val[k] ) );
+            r[k] = vmovn_u16( vcombine_u16( vshrn_n_u32( s0, 16 ),
+                                            vshrn_n_u32( s1, 16 ) ) );
+        }
+        vst1q_u8( &p_out[2 * x], vcombine_u8( r[0], r[1] ) );
+    }
+    return x;
+}
+#endif
+
+/*****************************************************************************
+ * 4-channel interior kernels
+ *****************************************************************************
+ * 4-byte RGB pixels fit a 32-bit lane: the 4 samples of a pixel are
+ * gathered at once and blended with its weights duplicated over them.
+ *****************************************************************************/
+#if defined(X86_KERNELS)
+X86_TARGET( "sse2" )
+static int BlendInteriorRGBA_SSE2( uint8_t *p_out, const uint8_t *p_src,
+                                   int i_src_pitch,
+                                   const warp_entry_t *p_entry, int i_count )
+{
+    const __m128i c256  = _mm_set1_epi16( 256 );
+    const __m128i cmask = _mm_set1_epi32( 0xff );
+    const __m128i zero  = _mm_setzero_si128();
+    int x = 0;
+
+    for( ; x + 4 <= i_count; x += 4, p_entry += 4 )
+    {
+        uint32_t pi_tl[4], pi_tr[4], pi_bl[4], pi_br[4];
+        for( int k = 0; k < 4; k++ )
+        {
+            const uint8_t *p_in = &p_src[p_entry[k].i_offset];
+            pi_tl[k] = Load32( p_in );
+            pi_tr[k] = Load32( p_in + 4 );
+            pi_bl[k] = Load32( p_in + i_src_pitch );
+            pi_br[k] = Load32( p_in + i_src_pitch + 4 );
+        }
+        const __m128i tl = _mm_loadu_si128( (const __m128i *)pi_tl );
+        const __m128i tr = _mm_loadu_si128( (const __m128i *)pi_tr );
+        const __m128i bl = _mm_loadu_si128( (const __m128i *)pi_bl );
+        const __m128i br = _mm_loadu_si128( (const __m128i *)pi_br );
+
+        const __m128i w = _mm_castps_si128( _mm_shuffle_ps(
+            _mm_loadu_ps( (const float *)&p_entry[0] ),
+            _mm_loadu_ps( (const float *)&p_entry[2] ),
+            _MM_SHUFFLE( 3, 1, 3, 1 ) ) );
+        /* Weights of pixels 0 to 3, then each one over its 4 samples */
+        const __m128i fx = _mm_packs_epi32( _mm_and_si128( w, cmask ), zero );
+        const __m128i fy = _mm_packs_epi32(
+            _mm_and_si128( _mm_srli_epi32( w, 8 ), cmask ), zero );
+        const __m128i fx2 = _mm_unpacklo_epi16( fx, fx );
+        const __m128i fy2 = _mm_unpacklo_epi16( fy, fy );
+
+        /* Each half holds 2 pixels */
+        __m128i r[2];
+        for( int k = 0; k < 2; k++ )
+        {
+#define HALF( v ) ( k ? _mm_unpackhi_epi8( v, zero ) \
+                          : _mm_unpacklo_epi8( v, zero ) )
+#define DUP( v ) ( k ? _mm_unpackhi_epi32( v, v ) : _mm_unpacklo_epi32( v, v ) )
+            const __m128i wx  = DUP( fx2 ), wy = DUP( fy2 );
+            const __m128i wx0 = _mm_sub_epi16( c256, wx );
+            const __m128i wy0 = _mm_sub_epi16( c256, wy );
+
+            const __m128i t = _mm_add_epi16( _mm_mullo_epi16( HALF( tl ), wx0 ),
+                                             _mm_mullo_epi16( HALF( tr ), wx ) );
+            const __m128i b = _mm_add_epi16( _mm_mullo_epi16( HALF( bl ), wx0 ),
+                                             _mm_mullo_epi16( HALF( br ), wx ) );
+#undef DUP
+#undef HALF
+
+            const __m128i t_lo = _mm_mullo_epi16( t, wy0 );
+            const __m128i t_hi = _mm_mulhi_epu16( t, wy0 );
+            const __m128i b_lo = _mm_mullo_epi16( b, wy );
+            const __m128i b_hi = _mm_mulhi_epu16( b, wy );
+            const __m128i s0 = _mm_add_epi32( _mm_unpacklo_epi16( t_lo, t_hi ),
+                                              _mm_unpacklo_epi16( b_lo, b_hi ) );
+            const __m128i s1 = _mm_add_epi32( _mm_unpackhi_epi16( t_lo, t_hi ),
+                                              _mm_unpackhi_epi16( b_lo, b_hi ) );
+            r[k] = _mm_packs_epi32( _mm_srli_epi32( s0, 16 ),
+                                    _mm_srli_epi32( s1, 16 ) );
+        }
+        _mm_storeu_si128( (__m128i *)&p_out[4 * x],
+                          _mm_packus_epi16( r[0], r[1] ) );
+    }
+    return x;
+}
+#endif
+
+#if defined(__ARM_NEON)
+static int BlendInteriorRGBA_NEON( uint8_t *p_out, const uint8_t *p_src,
+                                   int i_src_pitch,
+                                   const warp_entry_t *p_entry, int i_count )
+{
+    const uint16x8_t c256 = vdupq_n_u16( 256 );
+    int x = 0;
+
+    for( ; x + 4 <= i_count; x += 4, p_entry += 4 )
+    {
+        uint32_t pi_tl[4], pi_tr[4], pi_bl[4], pi_br[4];
+        for( int k = 0; k < 4; k++ )
+        {
+            const uint8_t *p_in = &p_src[p_entry[k].i_offset];
+            pi_tl[k] = Load32( p_in );
+            pi_tr[k] = Load32( p_in + 4 );
+            pi_bl[k] = Load32( p_in + i_src_pitch );
+            pi_br[k] = Load32( p_in + i_src_pitch + 4 );
+        }
+        const uint8x16_t tl = vreinterpretq_u8_u32( vld1q_u32( pi_tl ) );
+        const uint8x16_t tr = vreinterpretq_u8_u32( vld1q_u32( pi_tr ) );
+        const uint8x16_t bl = vreinterpretq_u8_u32( vld1q_u32( pi_bl ) );
+        const uint8x16_t br = vreinterpretq_u8_u32( vld1q_u32( pi_br ) );
+
+        const uint16x4_t w = vmovn_u32(
+            vld2q_u32( (const uint32_t *)p_entry ).val[1] );
+        const uint16x4_t fx = vand_u16( w, vdup_n_u16( 0xff ) );
+        const uint16x4_t fy = vshr_n_u16( w, 8 );
+        /* Each weight over the 4 samples of its pixel */
+        const uint16x4x2_t fx2 = vzip_u16( fx, fx );
+        const uint16x4x2_t fy2 = vzip_u16( fy, fy );
+
+        uint8x8_t r[2];
+        for( int k = 0; k < 2; k++ )
+        {
+#define HALF( v ) vmovl_u8( k ? vget_high_u8( v ) : vget_low_u8( v ) )
+            const uint16x4x2_t zx = vzip_u16( fx2.val[k], fx2.val[k] );
+            const uint16x4x2_t zy = vzip_u16( fy2.val[k], fy2.val[k] );
+            const uint16x8_t wx = vcombine_u16( zx.val[0], zx.val[1] );
+            const uint16x8_t wy = vcombine_u16( zy.val[0], zy.val[1] );
+            const uint16x8_t wx0 = vsubq_u16( c256, wx );
+            const uint16x8_t wy0 = vsubq_u16( c256, wy );
+
+            const uint16x8_t t = vmlaq_u16( vmulq_u16( HALF( tl ), wx0 ),
+                                            HALF( tr ), wx );
+            const uint16x8_t b = vmlaq_u16( vmulq_u16( HALF( bl ), wx0 ),
+                                            HALF( br ), wx );
+#undef HALF
+            const uint32x4_t s0 = vmlal_u16(
+                vmull_u16( vget_low_u16( t ), vget_low_u16( wy0 ) ),
+                vget_low_u16( b ), vget_low_u16( wy ) );
+            const uint32x4_t s1 = vmlal_u16(
+                vmull_u16( vget_high_u16( t ), vget_high_u16( wy0 ) ),
+                vget_high_u16( b ), vget_high_u16( wy ) );
+            r[k] = vmovn_u16( vcombine_u16( vshrn_n_u32( s0, 16 ),
+                                            vshrn_n_u32( s1, 16 ) ) );
+        }
+        vst1q_u8( &p_out[4 * x], vcombine_u8( r[0], r[1] ) );
+    }
+    return x;
+}
+#endif
+
+/*****************************************************************************
+ * GetIsa: most capable instruction set of the kernels that the CPU runs
+ *****************************************************************************/
+static int GetIsa( void )
+{
+#if defined(X86_KERNELS)
+    /* VLC 3 does not detect AVX-512 */
+    if( __builtin_cpu_supports( "avx512f" )
+     && __builtin_cpu_supports( "avx512bw" ) )
+        return ISA_AVX512;
+    if( vlc_CPU_AVX2() )
+        return ISA_AVX2;
+    if( vlc_CPU_SSE4_1() )
+        return ISA_SSE4_1;
+    if( vlc_CPU_SSE2() )
+        return ISA_SSE2;
+#elif defined(__ARM_NEON)
+    return ISA_NEON;
+#endif
+    return ISA_C;
+}
+
+/*****************************************************************************
+ * GetBlendInterior: pick the interior kernel of a component layout, for
+ * instruction sets up to i_isa
+ *****************************************************************************
+ * Layouts without a kernel for the instruction set use the one of the
+ * closest set below it.
+ *****************************************************************************/
+static blend_interior_fn GetBlendInterior( const warp_component_t *p_comp,
+                                           int i_isa )
+{
+    /* The kernels store whole pixels, which would race with the rendering
+     * of the other components of a packed plane */
+    if( !IsDense( p_comp ) )
+        return NULL;
+
+    if( p_comp->i_sample_size == 1 && p_comp->i_channels == 1 )
+    {
+#if defined(X86_KERNELS)
+        if( i_isa >= ISA_AVX512 )
+            return BlendInterior_AVX512;
+        if( i_isa >= ISA_AVX2 )
+            return BlendInterior_AVX2;
+        if( i_isa >= ISA_SSE2 )
+            return BlendInterior_SSE2;
+#elif defined(__ARM_NEON)
+        if( i_isa >= ISA_NEON )
+            return BlendInterior_NEON;
+#endif
+    }
+    /* The 2-byte kernels read little-endian samples */
+    else if( p_comp->i_sample_size == 2 && p_comp->i_channels == 1
+          && !p_comp->b_big_endian )
+    {
+#if defined(X86_KERNELS)
+        if( i_isa >= ISA_AVX512 )
+            return BlendInterior16_AVX512;
+        if( i_isa >= ISA_AVX2 )
+            return BlendInterior16_AVX2;
+        if( i_isa >= ISA_SSE4_1 )
+            return BlendInterior16_SSE41;
+        if( i_isa >= ISA_SSE2 )
+            return BlendInterior16_SSE2;
+#elif defined(__ARM_NEON)
+        if( i_isa >= ISA_NEON )
+            return BlendInterior16_NEON;
+#endif
+    }
+    else if( p_comp->i_sample_size == 1 && p_comp->i_channels == 2 )
+    {
+#if defined(X86_KERNELS)
+        if( i_isa >= ISA_SSE2 )
+            return BlendInteriorUV_SSE2;
+#elif defined(__ARM_NEON)
+        if( i_isa >= ISA_NEON )
+            return BlendInteriorUV_NEON;
+#endif
+    }
+    else if( p_comp->i_sample_size == 1 && p_comp->i_channels == 4 )
+    {
+#if defined(X86_KERNELS)
+        if( i_isa >= ISA_SSE2 )
+            return BlendInteriorRGBA_SSE2;
+#elif defined(__ARM_NEON)
+        if( i_isa >= ISA_NEON )
+            return BlendInteriorRGBA_NEON;
+#endif
+    }
+    return NULL;
+}
+
+/*****************************************************************************
+ * RenderPlaneMap: render columns [i_x_begin, i_x_end) of rows [i_y_begin,
+ * i_y_end) of one plane from its warp map (gather and blend)
+ *****************************************************************************/
+static void RenderPlaneMap( const warp_map_t *p_map, const plane_t *p_src,
+                            plane_t *p_dst, const warp_component_t *p_comp,
+                            int i_x_begin, int i_x_end,
+                            int i_y_begin, int i_y_end )
+{
+    const blend_interior_fn pf_blend_interior = p_comp->pf_blend_interior;
+    const int i_width = p_map->i_dst_width;
+    const int i_src_pitch = p_map->i_src_pitch;
+    const int i_pixel = p_comp->i_pixel_size;
+    const bool b_generic = i_pixel != 1;
+
+#define BLEND_SPAN( i_begin, i_end ) do { \
+        if( b_generic ) \
+            BlendSpanGeneric( &p_out[(i_begin) * i_pixel], p_src->p_pixels, \
+                              i_src_pitch, &p_line[i_begin], \
+                              (i_end) - (i_begin), p_comp ); \
+        else \
+            BlendSpan( &p_out[i_begin], p_src->p_pixels, i_src_pitch, \
+                       &p_line[i_begin], (i_end) - (i_begin), p_comp->i_fill ); \
+    } while( 0 )
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        uint8_t *p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
+        const warp_entry_t *p_line = &p_map->p_entries[(size_t)y * i_width];
+        const warp_row_t *p_row = &p_map->p_rows[y];
+        const int i_begin = VLC_CLIP( p_row->i_begin, i_x_begin, i_x_end );
+        const int i_end = VLC_CLIP( p_row->i_end, i_begin, i_x_end );
+        int x = i_begin;
+
+        FillPixels( &p_out[i_x_begin * i_pixel], i_begin - i_x_begin,
+                    p_comp );
+        if( pf_blend_interior )
+        {
+            const int i_inner_begin = VLC_CLIP( p_row->i_inner_begin,
+                                                i_begin, i_end );
+            const int i_inner_end = VLC_CLIP( p_row->i_inner_end,
+                                              i_inner_begin, i_end );
+            BLEND_SPAN( x, i_inner_begin );
+            x = i_inner_begin;
+            x += pf_blend_interior( &p_out[x * i_pixel], p_src->p_pixels,
+                                    i_src_pitch, &p_line[x],
+                                    i_inner_end - x );
+        }
+        BLEND_SPAN( x, i_end );
+        FillPixels( &p_out[i_end * i_pixel], i_x_end - i_end, p_comp );
+    }
+#undef BLEND_SPAN
+}
+
+/*****************************************************************************
+ * RenderPlaneMapNearest: render columns [i_x_begin, i_x_end) of rows
+ * [i_y_begin, i_y_end) of one plane from its warp map, copying the nearest
+ * tap
+ *****************************************************************************
+ * The right or bottom tap is taken from NEAREST_HALF on, where the kernel
+ * tables switch to their middle phase: the result is the same as the
+ * direct RenderPlaneKernel() with the nearest kernel.
+ *****************************************************************************/
+#define NEAREST_HALF ( 128 - 128 / KERNEL_PHASES )
+
+static void RenderPlaneMapNearest( const warp_map_t *p_map,
+                                   const plane_t *p_src, plane_t *p_dst,
+                                   const warp_component_t *p_comp,
+                                   int i_x_begin, int i_x_end,
+                                   int i_y_begin, int i_y_end )
+{
+    const int i_width = p_map->i_dst_width;
+    const int i_src_pitch = p_map->i_src_pitch;
+    const int i_pixel = p_comp->i_pixel_size;
+    const bool b_dense = IsDense( p_comp );
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        uint8_t *p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
+        const warp_entry_t *p_line = &p_map->p_entries[(size_t)y * i_width];
+        const warp_row_t *p_row = &p_map->p_rows[y];
+        const int i_begin = VLC_CLIP( p_row->i_begin, i_x_begin, i_x_end );
+        const int i_end = VLC_CLIP( p_row->i_end, i_begin, i_x_end );
+
+        FillPixels( &p_out[i_x_begin * i_pixel], i_begin - i_x_begin,
+                    p_comp );
+        if( i_pixel == 1 )
+        {
+            /* Local copies: the byte stores may alias anything */
+            const uint8_t *p_in = p_src->p_pixels;
+            const uint8_t fill = p_comp->i_fill;
+            for( int x = i_begin; x < i_end; x++ )
+            {
+                const warp_entry_t entry = p_line[x];
+                const unsigned i_right  = entry.i_fx >= NEAREST_HALF;
+                const unsigned i_bottom = entry.i_fy >= NEAREST_HALF;
+
+                p_out[x] = entry.i_taps & ( TAP_00 << ( i_right + 2 * i_bottom ) )
+                         ? p_in[entry.i_offset + i_right + i_bottom * i_src_pitch]
+                         : fill;
+            }
+        }
+        else for( int x = i_begin; x < i_end; x++ )
+        {
+            const warp_entry_t *p_entry = &p_line[x];
+            const bool b_right  = p_entry->i_fx >= NEAREST_HALF;
+            const bool b_bottom = p_entry->i_fy >= NEAREST_HALF;
+            /* TAP_10 and TAP_01/TAP_11 are TAP_00 shifted by 1 and 2 */
+            const unsigned i_tap = TAP_00 << ( b_right + 2 * b_bottom );
+            uint8_t *p_pixel = &p_out[x * i_pixel];
+
+            if( !( p_entry->i_taps & i_tap ) )
+            {
+                FillPixels( p_pixel, 1, p_comp );
+                continue;
+            }
+
+            const uint8_t *p_in = &p_src->p_pixels[p_entry->i_offset
+                                                   + b_right * i_pixel
+                                                   + b_bottom * i_src_pitch];
+            if( i_pixel == 1 )
+                *p_pixel = *p_in;
+            else if( b_dense )
+                memcpy( p_pixel, p_in, i_pixel );
+            else
+                for( int c = 0; c < p_comp->i_channels; c++ )
+                    memcpy( &p_pixel[p_comp->pi_offset[c]],
+                            &p_in[p_comp->pi_offset[c]],
+                            p_comp->i_sample_size );
+        }
+        FillPixels( &p_out[i_end * i_pixel], i_x_end - i_end, p_comp );
+    }
+}
+
+/*****************************************************************************
+ * MapPoint: source position of a destination point of a plane
+ *****************************************************************************
+ * Plane coordinates are scaled to the Y plane on which h[] is defined.
+ * Returns the denominator of the transform.
+ *****************************************************************************/
+static double MapPoint( const double h[8], double f_scale_x, double f_scale_y,
+                        double x, double y, double *p_sx, double *p_sy )
+{
+    const double dx = x * f_scale_x, dy = y * f_scale_y;
+    const double den = h[6] * dx + h[7] * dy + 1.0;
+
+    *p_sx = ( h[0] * dx + h[1] * dy + h[2] ) / den / f_scale_x;
+    *p_sy = ( h[3] * dx + h[4] * dy + h[5] ) / den / f_scale_y;
+    return den;
+}
+
+/*****************************************************************************
+ * ToFixed: convert a source coordinate to 16.16 fixed point
+ *****************************************************************************/
+static inline int32_t ToFixed( double f )
+{
+    /* Far away points only need to stay far away (and not overflow) */
+    if( !( f > -16384. ) )
+        f = -16384.;
+    else if( f > 16384. )
+        f = 16384.;
+    return lrint( f * 65536. );
+}
+
+/*****************************************************************************
+ * GetTileStep: 16.16 source position of column x of row v of tile (tx, ty),
+ * interpolated from the corners of the tile, and its step along the row
+ *****************************************************************************
+ * The position is stepped from the left edge of the tile, wherever the row
+ * starts: BuildWarpGrid() measures the very positions that are rendered.
+ *****************************************************************************/
+static inline void GetTileStep( const warp_grid_t *p_grid, int tx, int ty,
+                                int v, int x, int32_t *p_sx, int32_t *p_sy,
+                                int32_t *p_step_x, int32_t *p_step_y )
+{
+    const int i_tile = p_grid->i_tile;
+    const int i_stride = 2 * ( p_grid->i_cols + 1 );
+
+    /* Tile edges at this row, then a constant step along x */
+    const int32_t *p = &p_grid->p_points[ty * i_stride + 2 * tx];
+    const int32_t *q = p + i_stride;
+    const int64_t lx = p[0] + (int64_t)( q[0] - p[0] ) * v / i_tile;
+    const int64_t ly = p[1] + (int64_t)( q[1] - p[1] ) * v / i_tile;
+    const int64_t rx = p[2] + (int64_t)( q[2] - p[2] ) * v / i_tile;
+    const int64_t ry = p[3] + (int64_t)( q[3] - p[3] ) * v / i_tile;
+
+    *p_step_x = ( rx - lx ) / i_tile;
+    *p_step_y = ( ry - ly ) / i_tile;
+    *p_sx = lx + (int64_t)*p_step_x * ( x - tx * i_tile );
+    *p_sy = ly + (int64_t)*p_step_y * ( x - tx * i_tile );
+}
+
+/*****************************************************************************
+ * GetTileBound: bound of the error of the bilinear interpolation of the
+ * transform over a tile, from its corners
+ *****************************************************************************
+ * t^2/8 of the largest second derivatives along each axis, which for
+ * s = ( A x + B y + C ) / ( G x + K y + 1 ) are -2 G ( A - G s ) / den^2 and
+ * -2 K ( B - K s ) / den^2. With den of one sign at the corners, it does
+ * not vanish in the tile, where |den| is smallest at a corner and the
+ * positions stay within the quad of the corners.
+ *****************************************************************************/
+static double GetTileBound( const double h[8], double f_scale_x,
+                            double f_scale_y, int i_tile, const double csx[4],
+                            const double csy[4], const double cden[4] )
+{
+    /* Coefficients in the pixels of the plane */
+    const double ax = h[0], bx = h[1] * f_scale_y / f_scale_x;
+    const double ay = h[3] * f_scale_x / f_scale_y, by = h[4];
+    const double g = h[6] * f_scale_x, k = h[7] * f_scale_y;
+    double f_den = fabs( cden[0] );
+    double f_xx = 0., f_xy = 0., f_yx = 0., f_yy = 0.;
+
+    for( int c = 0; c < 4; c++ )
+    {
+        f_den = __MIN( f_den, fabs( cden[c] ) );
+        f_xx = __MAX( f_xx, fabs( g * ( ax - g * csx[c] ) ) );
+        f_xy = __MAX( f_xy, fabs( k * ( bx - k * csx[c] ) ) );
+        f_yx = __MAX( f_yx, fabs( g * ( ay - g * csy[c] ) ) );
+        f_yy = __MAX( f_yy, fabs( k * ( by - k * csy[c] ) ) );
+    }
+    return (double)i_tile * i_tile / 4.
+         * __MAX( f_xx + f_xy, f_yx + f_yy ) / ( f_den * f_den );
+}
+
+/*****************************************************************************
+ * GetTileError: largest distance between the positions stepped through a
+ * tile and those of the transform, where either is inside the source as
+ * BlendFixed() tells it
+ *****************************************************************************
+ * Stops once it exceeds f_tolerance.
+ *****************************************************************************/
+static double GetTileError( const warp_grid_t *p_grid, const double h[8],
+                            double f_scale_x, double f_scale_y, int tx, int ty,
+                            double f_tolerance )
+{
+    const int i_src_width  = p_grid->i_src_width;
+    const int i_src_height = p_grid->i_src_height;
+    const int i_tile = p_grid->i_tile;
+    const int x0 = tx * i_tile, y0 = ty * i_tile;
+    const int x1 = __MIN( x0 + i_tile, p_grid->i_dst_width );
+    const int y1 = __MIN( y0 + i_tile, p_grid->i_dst_height );
+    const double h0_sx = h[0] * f_scale_x;
+    const double h3_sx = h[3] * f_scale_x;
+    const double h6_sx = h[6] * f_scale_x;
+    double f_err = 0.;
+
+    for( int y = y0; y < y1 && f_err <= f_tolerance; y++ )
+    {
+        int32_t ix, iy, step_x, step_y;
+        GetTileStep( p_grid, tx, ty, y - y0, x0, &ix, &iy, &step_x, &step_y );
+
+        /* MapPoint() stepped along the row */
+        const double dx = x0 * f_scale_x, dy = y * f_scale_y;
+        double num_x = h[0] * dx + h[1] * dy + h[2];
+        double num_y = h[3] * dx + h[4] * dy + h[5];
+        double den   = h[6] * dx + h[7] * dy + 1.0;
+
+        for( int x = x0; x < x1; x++ )
+        {
+            const double fx = ix / 65536., fy = iy / 65536.;
+            const double sx = num_x / den / f_scale_x;
+            const double sy = num_y / den / f_scale_y;
+            ix += step_x;
+            iy += step_y;
+            num_x += h0_sx;
+            num_y += h3_sx;
+            den   += h6_sx;
+
+            if( ( fx < -1. || fx >= i_src_width
+               || fy < -1. || fy >= i_src_height )
+             && ( sx < -1. || sx >= i_src_width
+               || sy < -1. || sy >= i_src_height ) )
+                continue;
+            const double f_dist = __MAX( fabs( fx - sx ), fabs( fy - sy ) );
+            if( !( f_dist <= f_err ) )
+                f_err = f_dist;
+        }
+    }
+    return f_err;
+}
+
+/*****************************************************************************
+ * BuildWarpGrid: sample the transform on the largest tile grid that keeps
+ * the bilinear interpolation within the tolerance
+ *****************************************************************************
+ * The error of each tile over the source is measured at each of its
+ * pixels, from the fixed point positions that RenderPlaneFast() steps
+ * through. Tiles crossing den = 0, and tiles still out of tolerance with
+ * the smallest size, are flagged to be evaluated exactly. Returns false on
+ * allocation failure.
+ *****************************************************************************/
+static bool BuildWarpGrid( warp_grid_t *p_grid, const plane_t *p_src,
+                           const plane_t *p_dst, int i_y_width, int i_y_height,
+                           const double h[8], double f_tolerance,
+                           const warp_component_t *p_comp )
+{
+    const int i_dst_width  = p_dst->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_dst_height = p_dst->i_visible_lines;
+    const int i_src_width  = p_src->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_src_height = p_src->i_visible_lines;
+
+    const double f_scale_x = (double)i_y_width / i_dst_width;
+    const double f_scale_y = (double)i_y_height / i_dst_height;
+
+    /* Sized for the smallest tiles, reused for the larger ones */
+    const int i_max_cols = ( i_dst_width + GRID_TILE_MIN - 1 ) / GRID_TILE_MIN;
+    const int i_max_rows = ( i_dst_height + GRID_TILE_MIN - 1 ) / GRID_TILE_MIN;
+    const size_t i_points = (size_t)( i_max_cols + 1 ) * ( i_max_rows + 1 );
+    const size_t i_tiles  = (size_t)i_max_cols * i_max_rows;
+
+    if( i_points > p_grid->i_points )
+    {
+        int32_t *p_points = realloc( p_grid->p_points,
+                                     i_points * 2 * sizeof( *p_points ) );
+        if( !p_points )
+            return false;
+        p_grid->p_points = p_points;
+        p_grid->i_points = i_points;
+    }
+    if( i_tiles > p_grid->i_tiles )
+    {
+        uint8_t *p_exact = realloc( p_grid->p_exact, i_tiles );
+        if( !p_exact )
+            return false;
+        p_grid->p_exact = p_exact;
+        p_grid->i_tiles = i_tiles;
+    }
+    p_grid->i_dst_width  = i_dst_width;
+    p_grid->i_dst_height = i_dst_height;
+    p_grid->i_src_width  = i_src_width;
+    p_grid->i_src_height = i_src_height;
+
+    for( int i_tile = GRID_TILE_MAX; i_tile >= GRID_TILE_MIN; i_tile /= 2 )
+    {
+        const int i_cols = ( i_dst_width + i_tile - 1 ) / i_tile;
+        const int i_rows = ( i_dst_height + i_tile - 1 ) / i_tile;
+        bool b_fits = true;
+
+        p_grid->i_tile = i_tile;
+        p_grid->i_cols = i_cols;
+        p_grid->i_rows = i_rows;
+
+        for( int ty = 0; ty <= i_rows; ty++ )
+            for( int tx = 0; tx <= i_cols; tx++ )
+            {
+                double sx, sy;
+                MapPoint( h, f_scale_x, f_scale_y,
+                          tx * i_tile, ty * i_tile, &sx, &sy );
+                int32_t *p_point = &p_grid->p_points[2 * ( ty * ( i_cols + 1 ) + tx )];
+                p_point[0] = ToFixed( sx );
+                p_point[1] = ToFixed( sy );
+            }
+
+        /* A larger size stops at its first tile out of tolerance */
+        for( int ty = 0; ty < i_rows && b_fits; ty++ )
+            for( int tx = 0; tx < i_cols && b_fits; tx++ )
+            {
+                const int x0 = tx * i_tile, y0 = ty * i_tile;
+                double csx[4], csy[4], cden[4];
+                bool b_exact = false;
+
+                for( int c = 0; c < 4; c++ )
+                    cden[c] = MapPoint( h, f_scale_x, f_scale_y,
+                                        x0 + ( c & 1 ) * i_tile,
+                                        y0 + ( c >> 1 ) * i_tile,
+                                        &csx[c], &csy[c] );
+
+                /* Interpolating across the horizon makes no sense */
+                for( int c = 1; c < 4; c++ )
+                    if( ( cden[c] > 0. ) != ( cden[0] > 0. ) )
+                        b_exact = true;
+
+                /* Otherwise the tile maps to a convex quad: if its bounding
+                 * box misses the source, both the exact and interpolated
+                 * positions do, and the whole tile is filled either way */
+                double f_min_x = csx[0], f_max_x = csx[0];
+                double f_min_y = csy[0], f_max_y = csy[0];
+                for( int c = 1; c < 4; c++ )
+                {
+                    f_min_x = __MIN( f_min_x, csx[c] );
+                    f_max_x = __MAX( f_max_x, csx[c] );
+                    f_min_y = __MIN( f_min_y, csy[c] );
+                    f_max_y = __MAX( f_max_y, csy[c] );
+                }
+                const bool b_visible = f_max_x > -2. && f_min_x < i_src_width + 1.
+                                    && f_max_y > -2. && f_min_y < i_src_height + 1.;
+
+                /* Unless bounded within the tolerance, with the fixed point
+                 * rounding of about a unit per step, measured */
+                double f_err = 0.;
+                if( !b_exact && b_visible
+                 && !( GetTileBound( h, f_scale_x, f_scale_y, i_tile,
+                                     csx, csy, cden )
+                       + ( i_tile + 4 ) / 65536. <= f_tolerance ) )
+                    f_err = GetTileError( p_grid, h, f_scale_x, f_scale_y,
+                                          tx, ty, f_tolerance );
+
+                if( f_err > f_tolerance || f_err != f_err )
+                {
+                    b_exact = true;
+                    if( i_tile > GRID_TILE_MIN )
+                        b_fits = false;
+                }
+                p_grid->p_exact[ty * i_cols + tx] = b_exact;
+            }
+
+        if( b_fits || i_tile == GRID_TILE_MIN )
+            break;
+    }
+    return true;
+}
+
+/*****************************************************************************
+ * WarpGridMatches: check that a grid was built for this plane geometry
+ *****************************************************************************/
+static bool WarpGridMatches( const warp_grid_t *p_grid, const plane_t *p_src,
+                             const plane_t *p_dst,
+                             const warp_component_t *p_comp )
+{
+    const int i_pixel = p_comp->i_pixel_size;
+
+    return p_grid->p_points != NULL
+        && p_grid->i_dst_width  == p_dst->i_visible_pitch / i_pixel
+        && p_grid->i_dst_height == p_dst->i_visible_lines
+        && p_grid->i_src_width  == p_src->i_visible_pitch / i_pixel
+        && p_grid->i_src_height == p_src->i_visible_lines;
+}
+
+/*****************************************************************************
+ * BlendFixed: edge-aware bilinear blend of one pixel at a 16.16 source
+ * position
+ *****************************************************************************/
+static inline void BlendFixed( uint8_t *p_out, const plane_t *p_src,
+                               int i_src_width, int i_src_height,
+                               int32_t sx, int32_t sy,
+                               const warp_component_t *p_comp )
+{
+    const int i_sx = sx >> 16, i_sy = sy >> 16;
+    const unsigned fill = p_comp->i_fill;
+
+    if( i_sx < -1 || i_sx >= i_src_width
+     || i_sy < -1 || i_sy >= i_src_height )
+    {
+        FillPixels( p_out, 1, p_comp );
+        return;
+    }
+
+    const unsigned i_fx = ( sx >> 8 ) & 0xff;
+    const unsigned i_fy = ( sy >> 8 ) & 0xff;
+    const int i_pixel = p_comp->i_pixel_size;
+    const int i_pitch = p_src->i_pitch;
+    const uint8_t *p_base = &p_src->p_pixels[i_sy * i_pitch + i_sx * i_pixel];
+
+    for( int c = 0; c < p_comp->i_channels; c++ )
+    {
+        const uint8_t *p_in = p_base + p_comp->pi_offset[c];
+        unsigned p00 = fill, p10 = fill, p01 = fill, p11 = fill;
+
+        if( i_sy >= 0 && i_sx >= 0 )
+            p00 = GetSample( p_in, p_comp );
+        if( i_sy >= 0 && i_sx + 1 < i_src_width )
+            p10 = GetSample( p_in + i_pixel, p_comp );
+        if( i_sy + 1 < i_src_height && i_sx >= 0 )
+            p01 = GetSample( p_in + i_pitch, p_comp );
+        if( i_sy + 1 < i_src_height && i_sx + 1 < i_src_width )
+            p11 = GetSample( p_in + i_pitch + i_pixel, p_comp );
+
+        unsigned int temp = 0;
+        temp += p00 * ( 256 - i_fy ) * ( 256 - i_fx );
+        temp += p01 * i_fy * ( 256 - i_fx );
+        temp += p11 * i_fx * i_fy;
+        temp += p10 * i_fx * ( 256 - i_fy );
+        PutSample( &p_out[p_comp->pi_offset[c]], temp >> 16, p_comp );
+    }
+}
+
+/*****************************************************************************
+ * RenderPlaneFast: render rows [i_y_begin, i_y_end) of one plane by
+ * stepping linearly through each tile of its warp grid
+ *****************************************************************************/
+static void RenderPlaneFast( const warp_grid_t *p_grid, const plane_t *p_src,
+                             plane_t *p_dst, int i_y_width, int i_y_height,
+                             const double h[8], const warp_component_t *p_comp,
+                             int i_y_begin, int i_y_end )
+{
+    const int i_dst_width  = p_grid->i_dst_width;
+    const int i_src_width  = p_grid->i_src_width;
+    const int i_src_height = p_grid->i_src_height;
+    const int i_tile = p_grid->i_tile;
+    const int i_pixel = p_comp->i_pixel_size;
+
+    const double f_scale_x = (double)i_y_width / i_dst_width;
+    const double f_scale_y = (double)i_y_height / p_grid->i_dst_height;
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        uint8_t *p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
+        const int ty = y / i_tile, v = y - ty * i_tile;
+
+        const double dy = y * f_scale_y;
+        int i_begin, i_end;
+        GetRowSpan( h[1] * dy + h[2], h[4] * dy + h[5], h[7] * dy + 1.0,
+                    h[0] * f_scale_x, h[3] * f_scale_x, h[6] * f_scale_x,
+                    1. / f_scale_x, 1. / f_scale_y,
+                    i_src_width, i_src_height, i_dst_width, 1,
+                    &i_begin, &i_end );
+
+        FillPixels( p_out, i_begin, p_comp );
+        FillPixels( &p_out[i_end * i_pixel], i_dst_width - i_end, p_comp );
+
+        for( int tx = i_begin / i_tile; tx * i_tile < i_end; tx++ )
+        {
+            const int x0 = __MAX( tx * i_tile, i_begin );
+            const int x1 = __MIN( ( tx + 1 ) * i_tile, i_end );
+
+            if( p_grid->p_exact[ty * p_grid->i_cols + tx] )
+            {
+                for( int x = x0; x < x1; x++ )
+                {
+                    double sx, sy;
+                    if( fabs( MapPoint( h, f_scale_x, f_scale_y,
+                                        x, y, &sx, &sy ) ) < 1e-12 )
+                        FillPixels( &p_out[x * i_pixel], 1, p_comp );
+                    else
+                        BlendFixed( &p_out[x * i_pixel], p_src, i_src_width,
+                                    i_src_height, ToFixed( sx ), ToFixed( sy ),
+                                    p_comp );
+                }
+                continue;
+            }
+
+            int32_t sx, sy, step_x, step_y;
+            GetTileStep( p_grid, tx, ty, v, x0, &sx, &sy, &step_x, &step_y );
+
+            /* The positions are linear along the run: when both ends have
+             * their four taps inside the source, all of them do, and 8-bit
+             * samples can be blended without any check */
+            const int64_t ex = sx + (int64_t)step_x * ( x1 - 1 - x0 );
+            const int64_t ey = sy + (int64_t)step_y * ( x1 - 1 - x0 );
+            if( i_pixel == 1
+             && __MIN( sx, ex ) >= 0 && __MIN( sy, ey ) >= 0
+             && ( __MAX( sx, ex ) >> 16 ) < i_src_width - 1
+             && ( __MAX( sy, ey ) >> 16 ) < i_src_height - 1 )
+            {
+                const int i_pitch = p_src->i_pitch;
+                for( int x = x0; x < x1; x++ )
+                {
+                    const uint8_t *p_in = &p_src->p_pixels[( sy >> 16 ) * i_pitch
+                                                          + ( sx >> 16 )];
+                    const unsigned i_fx = ( sx >> 8 ) & 0xff;
+                    const unsigned i_fy = ( sy >> 8 ) & 0xff;
+                    const unsigned top = p_in[0] * ( 256 - i_fx ) + p_in[1] * i_fx;
+                    const unsigned bot = p_in[i_pitch] * ( 256 - i_fx )
+                                       + p_in[i_pitch + 1] * i_fx;
+                    p_out[x] = ( top * ( 256 - i_fy ) + bot * i_fy ) >> 16;
+                    sx += step_x;
+                    sy += step_y;
+                }
+                continue;
+            }
+
+            for( int x = x0; x < x1; x++ )
+            {
+                BlendFixed( &p_out[x * i_pixel], p_src, i_src_width,
+                            i_src_height, sx, sy, p_comp );
+                sx += step_x;
+                sy += step_y;
+            }
+        }
+    }
+}
+
+/*****************************************************************************
+ * GetPlaneShift: whole pixel offset of a plane under a translation
+ *****************************************************************************
+ * Returns false if the translation falls between the pixels of the plane,
+ * as it does on subsampled planes for odd luma offsets.
+ *****************************************************************************/
+static bool GetPlaneShift( const double h[8], int i_y_width, int i_y_height,
+                           const plane_t *p_dst, const warp_component_t *p_comp,
+                           int *pi_dx, int *pi_dy )
+{
+    const int i_dst_width  = p_dst->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_dst_height = p_dst->i_visible_lines;
+    const double f_dx = h[2] * i_dst_width / i_y_width;
+    const double f_dy = h[5] * i_dst_height / i_y_height;
+
+    if( f_dx != floor( f_dx ) || f_dy != floor( f_dy )
+     || fabs( f_dx ) > INT_MAX / 2 || fabs( f_dy ) > INT_MAX / 2 )
+        return false;
+    *pi_dx = f_dx;
+    *pi_dy = f_dy;
+    return true;
+}
+
+/*****************************************************************************
+ * RenderPlaneTranslate: render rows [i_y_begin, i_y_end) of a plane shifted
+ * by whole pixels
+ *****************************************************************************
+ * The weights are all on the top-left tap, so rows are plain copies. Only
+ * for components owning all the bytes of their pixels.
+ *****************************************************************************/
+static void RenderPlaneTranslate( const plane_t *p_src, plane_t *p_dst,
+                                  int i_dx, int i_dy,
+                                  const warp_component_t *p_comp,
+                                  int i_y_begin, int i_y_end )
+{
+    const int i_dst_width  = p_dst->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_src_width  = p_src->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_src_height = p_src->i_visible_lines;
+    const int i_pixel = p_comp->i_pixel_size;
+
+    /* Columns whose source is inside */
+    const int i_begin = VLC_CLIP( -i_dx, 0, i_dst_width );
+    const int i_end   = VLC_CLIP( i_src_width - i_dx, i_begin, i_dst_width );
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        uint8_t *p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
+        const int i_sy = y + i_dy;
+
+        if( i_sy < 0 || i_sy >= i_src_height )
+        {
+            FillPixels( p_out, i_dst_width, p_comp );
+            continue;
+        }
+
+        FillPixels( p_out, i_begin, p_comp );
+        memcpy( &p_out[i_begin * i_pixel],
+                &p_src->p_pixels[i_sy * p_src->i_pitch
+                                 + ( i_begin + i_dx ) * i_pixel],
+                ( i_end - i_begin ) * i_pixel );
+        FillPixels( &p_out[i_end * i_pixel], i_dst_width - i_end, p_comp );
+    }
+}
+
+/*****************************************************************************
+ * BlendColumns: vertical blend of columns [i_begin, i_end) of two source
+ * rows, either of which may be outside the source
+ *****************************************************************************/
+static void BlendColumns( uint32_t *p_col, const uint8_t *p_top,
+                          const uint8_t *p_bot, bool b_top, bool b_bot,
+                          unsigned i_fy, int i_begin, int i_end,
+                          int i_src_width, const warp_component_t *p_comp )
+{
+    const int i_channels = p_comp->i_channels;
+    const unsigned fill = p_comp->i_fill;
+
+    for( int i = i_begin; i < i_end; i++ )
+    {
+        const bool b_in = i >= 0 && i < i_src_width;
+
+        for( int c = 0; c < i_channels; c++ )
+        {
+            const int i_offset = i * p_comp->i_pixel_size + p_comp->pi_offset[c];
+            const unsigned p0 = b_in && b_top
+                              ? GetSample( &p_top[i_offset], p_comp ) : fill;
+            const unsigned p1 = b_in && b_bot
+                              ? GetSample( &p_bot[i_offset], p_comp ) : fill;
+            p_col[i * i_channels + c] = p0 * ( 256 - i_fy ) + p1 * i_fy;
+        }
+    }
+}
+
+/*****************************************************************************
+ * BlendRows8: vertical blend of two rows of plain bytes
+ *****************************************************************************
+ * 255 * 256 fits 16 bits: the columns stay small enough for the cache, and
+ * 8 of them fit one vector.
+ *****************************************************************************/
+static void BlendRows8( uint16_t *p_col, const uint8_t *p_top,
+                        const uint8_t *p_bot, unsigned i_fy, int i_count )
+{
+    int i = 0;
+
+#if defined(__SSE2__)
+    const __m128i wt = _mm_set1_epi16( 256 - i_fy );
+    const __m128i wb = _mm_set1_epi16( i_fy );
+    const __m128i zero = _mm_setzero_si128();
+
+    for( ; i + 8 <= i_count; i += 8 )
+    {
+        const __m128i t = _mm_unpacklo_epi8(
+            _mm_loadl_epi64( (const __m128i *)&p_top[i] ), zero );
+        const __m128i b = _mm_unpacklo_epi8(
+            _mm_loadl_epi64( (const __m128i *)&p_bot[i] ), zero );
+        _mm_storeu_si128( (__m128i *)&p_col[i],
+                          _mm_add_epi16( _mm_mullo_epi16( t, wt ),
+                                         _mm_mullo_epi16( b, wb ) ) );
+    }
+#elif defined(__ARM_NEON)
+    const uint16_t i_wt = 256 - i_fy, i_wb = i_fy;
+
+    for( ; i + 8 <= i_count; i += 8 )
+    {
+        const uint16x8_t t = vmovl_u8( vld1_u8( &p_top[i] ) );
+        const uint16x8_t b = vmovl_u8( vld1_u8( &p_bot[i] ) );
+        vst1q_u16( &p_col[i], vmlaq_n_u16( vmulq_n_u16( t, i_wt ), b, i_wb ) );
+    }
+#endif
+
+    for( ; i < i_count; i++ )
+        p_col[i] = p_top[i] * ( 256 - i_fy ) + p_bot[i] * i_fy;
+}
+
+/*****************************************************************************
+ * ResampleRow8: horizontal pass of the byte columns of BlendRows8
+ *****************************************************************************
+ * i_sx is the 32.32 source position of the first pixel, every read must fall
+ * in the columns. The weight is in the low word of the position, which the
+ * vectors step in 32-bit lanes (modulo 2^32, so exactly).
+ *****************************************************************************/
+static void ResampleRow8( uint8_t *p_out, const uint16_t *p_col,
+                          int64_t i_sx, int64_t i_step, int i_count )
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128i c256 = _mm_set1_epi16( 256 );
+    const uint32_t i_lo = i_sx, i_lo_step = i_step;
+    __m128i w0 = _mm_setr_epi32( i_lo, i_lo + i_lo_step,
+                                 i_lo + 2 * i_lo_step, i_lo + 3 * i_lo_step );
+    __m128i w1 = _mm_add_epi32( w0, _mm_set1_epi32( 4 * i_lo_step ) );
+    const __m128i w_step = _mm_set1_epi32( 8 * i_lo_step );
+
+    for( ; x + 8 <= i_count; x += 8 )
+    {
+        /* Left and right columns of each pixel, as 32-bit pairs */
+#define LOAD_PAIR( k ) _mm_cvtsi32_si128( Load32( (const uint8_t *) \
+            &p_col[( i_sx + (k) * i_step ) >> 32] ) )
+        __m128i v0 = _mm_unpacklo_epi64(
+            _mm_unpacklo_epi32( LOAD_PAIR( 0 ), LOAD_PAIR( 1 ) ),
+            _mm_unpacklo_epi32( LOAD_PAIR( 2 ), LOAD_PAIR( 3 ) ) );
+        __m128i v1 = _mm_unpacklo_epi64(
+            _mm_unpacklo_epi32( LOAD_PAIR( 4 ), LOAD_PAIR( 5 ) ),
+            _mm_unpacklo_epi32( LOAD_PAIR( 6 ), LOAD_PAIR( 7 ) ) );
+#undef LOAD_PAIR
+        i_sx += 8 * i_step;
+        v0 = _mm_shufflelo_epi16( v0, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        v0 = _mm_shufflehi_epi16( v0, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        v0 = _mm_shuffle_epi32( v0, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        v1 = _mm_shufflelo_epi16( v1, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        v1 = _mm_shufflehi_epi16( v1, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        v1 = _mm_shuffle_epi32( v1, _MM_SHUFFLE( 3, 1, 2, 0 ) );
+        const __m128i l = _mm_unpacklo_epi64( v0, v1 );
+        const __m128i r = _mm_unpackhi_epi64( v0, v1 );
+
+        const __m128i fx = _mm_packs_epi32( _mm_srli_epi32( w0, 24 ),
+                                            _mm_srli_epi32( w1, 24 ) );
+        const __m128i fx0 = _mm_sub_epi16( c256, fx );
+        w0 = _mm_add_epi32( w0, w_step );
+        w1 = _mm_add_epi32( w1, w_step );
+
+        /* 16x16 -> 32-bit products */
+        const __m128i ll = _mm_mullo_epi16( l, fx0 );
+        const __m128i lh = _mm_mulhi_epu16( l, fx0 );
+        const __m128i rl = _mm_mullo_epi16( r, fx );
+        const __m128i rh = _mm_mulhi_epu16( r, fx );
+        const __m128i s0 = _mm_add_epi32( _mm_unpacklo_epi16( ll, lh ),
+                                          _mm_unpacklo_epi16( rl, rh ) );
+        const __m128i s1 = _mm_add_epi32( _mm_unpackhi_epi16( ll, lh ),
+                                          _mm_unpackhi_epi16( rl, rh ) );
+
+        const __m128i v = _mm_packs_epi32( _mm_srli_epi32( s0, 16 ),
+                                           _mm_srli_epi32( s1, 16 ) );
+        _mm_storel_epi64( (__m128i *)&p_out[x], _mm_packus_epi16( v, v ) );
+    }
+#elif defined(__ARM_NEON)
+    const uint32_t i_lo = i_sx, i_lo_step = i_step;
+    const uint32_t pi_w[4] = { i_lo, i_lo + i_lo_step,
+                               i_lo + 2 * i_lo_step, i_lo + 3 * i_lo_step };
+    uint32x4_t w0 = vld1q_u32( pi_w );
+    uint32x4_t w1 = vaddq_u32( w0, vdupq_n_u32( 4 * i_lo_step ) );
+    const uint32x4_t w_step = vdupq_n_u32( 8 * i_lo_step );
+
+    for( ; x + 8 <= i_count; x += 8 )
+    {
+        /* Left and right columns of each pixel, as 32-bit pairs */
+        uint32x4_t v0 = vdupq_n_u32( 0 ), v1 = vdupq_n_u32( 0 );
+#define LOAD_PAIR( v, k, l ) v = vsetq_lane_u32( Load32( (const uint8_t *) \
+            &p_col[( i_sx + (k) * i_step ) >> 32] ), v, l )
+        LOAD_PAIR( v0, 0, 0 ); LOAD_PAIR( v0, 1, 1 );
+        LOAD_PAIR( v0, 2, 2 ); LOAD_PAIR( v0, 3, 3 );
+        LOAD_PAIR( v1, 4, 0 ); LOAD_PAIR( v1, 5, 1 );
+        LOAD_PAIR( v1, 6, 2 ); LOAD_PAIR( v1, 7, 3 );
+#undef LOAD_PAIR
+        i_sx += 8 * i_step;
+        const uint16x8x2_t lr = vuzpq_u16( vreinterpretq_u16_u32( v0 ),
+                                           vreinterpretq_u16_u32( v1 ) );
+
+        const uint16x8_t fx = vcombine_u16( vmovn_u32( vshrq_n_u32( w0, 24 ) ),
+                                            vmovn_u32( vshrq_n_u32( w1, 24 ) ) );
+        const uint16x8_t fx0 = vsubq_u16( vdupq_n_u16( 256 ), fx );
+        w0 = vaddq_u32( w0, w_step );
+        w1 = vaddq_u32( w1, w_step );
+
+        const uint32x4_t s0 = vmlal_u16( vmull_u16( vget_low_u16( lr.val[0] ),
+                                                    vget_low_u16( fx0 ) ),
+                                         vget_low_u16( lr.val[1] ),
+                                         vget_low_u16( fx ) );
+        const uint32x4_t s1 = vmlal_u16( vmull_u16( vget_high_u16( lr.val[0] ),
+                                                    vget_high_u16( fx0 ) ),
+                                         vget_high_u16( lr.val[1] ),
+                                         vget_high_u16( fx ) );
+        const uint16x8_t v = vcombine_u16( vshrn_n_u32( s0, 16 ),
+                                           vshrn_n_u32( s1, 16 ) );
+        vst1_u8( &p_out[x], vmovn_u16( v ) );
+    }
+#endif
+
+    for( ; x < i_count; x++, i_sx += i_step )
+    {
+        const uint16_t *p_in = &p_col[i_sx >> 32];
+        const unsigned i_fx = ( i_sx >> 24 ) & 0xff;
+
+        p_out[x] = ( p_in[0] * ( 256 - i_fx ) + p_in[1] * i_fx ) >> 16;
+    }
+}
+
+/*****************************************************************************
+ * RenderPlaneRows: render rows [i_y_begin, i_y_end) of a plane whose rows
+ * each map to a single source row pair (h3 = h6 = 0)
+ *****************************************************************************
+ * The vertical keystone of a projector. The two source rows are blended
+ * once over the columns in use, then resampled horizontally: the position
+ * along the row is affine, so it needs no divide either.
+ *****************************************************************************/
+static void RenderPlaneRows( const plane_t *p_src, plane_t *p_dst,
+                             int i_y_width, int i_y_height,
+                             const double h[8], const warp_component_t *p_comp,
+                             uint32_t *p_blend, int i_y_begin, int i_y_end )
+{
+    const int i_dst_width  = p_dst->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_dst_height = p_dst->i_visible_lines;
+    const int i_src_width  = p_src->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_src_height = p_src->i_visible_lines;
+    const int i_pixel = p_comp->i_pixel_size;
+    const int i_channels = p_comp->i_channels;
+    const unsigned fill = p_comp->i_fill;
+    /* Plain bytes: 16-bit columns, no sample accessors */
+    const bool b_bytes = p_comp->i_sample_size == 1 && i_pixel == 1;
+
+    const double f_scale_x = (double)i_y_width / i_dst_width;
+    const double f_scale_y = (double)i_y_height / i_dst_height;
+    const double f_inv_scale_x = (double)i_dst_width / i_y_width;
+    const double f_inv_scale_y = (double)i_dst_height / i_y_height;
+    const double h0_sx = h[0] * f_scale_x;
+
+    /* Vertical blends of columns -1 to i_src_width, by channel, in the
+     * (i_src_width + 2) * i_channels samples of p_blend */
+    uint16_t *p_col8 = (uint16_t *)p_blend + 1;         /* Column 0 */
+    uint32_t *p_col  = p_blend + i_channels;
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        uint8_t *p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
+
+        const double dy = y * f_scale_y;
+        const double num_x = h[1] * dy + h[2];
+        const double num_y = h[4] * dy + h[5];
+        const double den   = h[7] * dy + 1.0;
+
+        int i_begin = 0, i_end = 0;
+        double sy = 0.;
+        int i_sy = -2;
+        if( fabs( den ) >= 1e-12 )
+        {
+            sy = ( num_y / den ) * f_inv_scale_y;
+            i_sy = (int)( sy >= 0 ? sy : sy - 1 );
+        }
+        if( i_sy >= -1 && i_sy < i_src_height )
+            GetRowSpan( num_x, num_y, den, h0_sx, 0., 0.,
+                        f_inv_scale_x, f_inv_scale_y,
+                        i_src_width, i_src_height, i_dst_width, 1,
+                        &i_begin, &i_end );
+
+        FillPixels( p_out, i_begin, p_comp );
+        FillPixels( &p_out[i_end * i_pixel], i_dst_width - i_end, p_comp );
+        if( i_begin >= i_end )
+            continue;
+
+        const unsigned i_fy = (int)( ( sy - i_sy ) * 256.0 );
+
+        /* sx = f_a + x * f_b, stepped in 32.32 fixed point: over a row, the
+         * error of the step stays far below the 1/256 of the weights */
+        const double f_a = num_x / den * f_inv_scale_x;
+        const double f_b = h0_sx / den * f_inv_scale_x;
+        int64_t i_sx = llrint( ( f_a + i_begin * f_b ) * 4294967296.0 );
+        const int64_t i_step = i_end - i_begin > 1
+                             ? llrint( f_b * 4294967296.0 ) : 0;
+
+        /* The span is conservative: trim the ends that still miss the
+         * columns, the positions being monotonic along the row */
+        while( i_begin < i_end
+            && ( i_sx >> 32 < -1 || i_sx >> 32 >= i_src_width ) )
+        {
+            FillPixels( &p_out[i_begin * i_pixel], 1, p_comp );
+            i_begin++;
+            i_sx += i_step;
+        }
+        while( i_end > i_begin )
+        {
+            const int i_last = ( i_sx + ( i_end - 1 - i_begin ) * i_step ) >> 32;
+            if( i_last >= -1 && i_last < i_src_width )
+                break;
+            i_end--;
+            FillPixels( &p_out[i_end * i_pixel], 1, p_comp );
+        }
+        if( i_begin >= i_end )
+            continue;
+
+        /* Source columns read by the span */
+        const int i_s0 = i_sx >> 32;
+        const int i_s1 = ( i_sx + ( i_end - 1 - i_begin ) * i_step ) >> 32;
+        const int i_lo = __MIN( i_s0, i_s1 );
+        const int i_hi = __MAX( i_s0, i_s1 );
+
+        const uint8_t *p_top = &p_src->p_pixels[i_sy * p_src->i_pitch];
+        const uint8_t *p_bot = p_top + p_src->i_pitch;
+        const bool b_top = i_sy >= 0, b_bot = i_sy + 1 < i_src_height;
+
+        if( b_bytes )
+        {
+            /* Columns with both taps inside, blended straight from the rows */
+            int i_inner_begin = i_hi + 2, i_inner_end = i_hi + 2;
+            if( b_top && b_bot )
+            {
+                i_inner_begin = __MAX( i_lo, 0 );
+                i_inner_end = __MAX( __MIN( i_hi + 2, i_src_width ),
+                                     i_inner_begin );
+                BlendRows8( &p_col8[i_inner_begin], &p_top[i_inner_begin],
+                            &p_bot[i_inner_begin], i_fy,
+                            i_inner_end - i_inner_begin );
+            }
+            for( int i = i_lo; i < i_hi + 2; i++ )
+            {
+                if( i == i_inner_begin )
+                    i = i_inner_end;
+                if( i >= i_hi + 2 )
+                    break;
+                const bool b_in = i >= 0 && i < i_src_width;
+                const unsigned p0 = b_in && b_top ? p_top[i] : fill;
+                const unsigned p1 = b_in && b_bot ? p_bot[i] : fill;
+                p_col8[i] = p0 * ( 256 - i_fy ) + p1 * i_fy;
+            }
+
+            ResampleRow8( &p_out[i_begin], p_col8, i_sx, i_step,
+                          i_end - i_begin );
+            continue;
+        }
+
+        BlendColumns( p_col, p_top, p_bot, b_top, b_bot, i_fy,
+                      i_lo, i_hi + 2, i_src_width, p_comp );
+
+        for( int x = i_begin; x < i_end; x++, i_sx += i_step )
+        {
+            const uint32_t *p_in = &p_col[( i_sx >> 32 ) * i_channels];
+            const unsigned i_fx = ( i_sx >> 24 ) & 0xff;
+
+            for( int c = 0; c < i_channels; c++ )
+                PutSample( &p_out[x * i_pixel + p_comp->pi_offset[c]],
+                           ( p_in[c] * ( 256 - i_fx )
+                             + p_in[i_channels + c] * i_fx ) >> 16,
+                           p_comp );
+        }
+    }
+}
+
+/*****************************************************************************
+ * BuildKernel: weight tables of a separable interpolation kernel
+ *****************************************************************************/
+static double Sinc( double x )
+{
+    if( fabs( x ) < 1e-9 )
+        return 1.;
+    return sin( M_PI * x ) / ( M_PI * x );
+}
+
+static void BuildKernel( warp_kernel_t *p_kernel, int i_interp )
+{
+    switch( i_interp )
+    {
+        case INTERP_BICUBIC:
+            p_kernel->i_taps = 4;
+            break;
+        case INTERP_LANCZOS:
+            p_kernel->i_taps = 6;
+            break;
+        default:
+            p_kernel->i_taps = 2;
+            break;
+    }
+
+    const int i_taps = p_kernel->i_taps;
+    for( int i_phase = 0; i_phase < KERNEL_PHASES; i_phase++ )
+    {
+        const double t = (double)i_phase / KERNEL_PHASES;
+        double pf_weights[KERNEL_MAX_TAPS];
+        int i_sum = 0, i_peak = 0;
+
+        for( int k = 0; k < i_taps; k++ )
+        {
+            /* Distance from the sampled position to the tap */
+            const double d = fabs( k + 1 - i_taps / 2 - t );
+
+            if( i_interp == INTERP_BICUBIC )
+            {
+                /* Keys cubic convolution, a = -0.5 (Catmull-Rom) */
+                const double a = -0.5;
+                pf_weights[k] = d <= 1. ? ( ( a + 2. ) * d - ( a + 3. ) ) * d * d + 1.
+                              : d < 2. ? ( ( a * d - 5. * a ) * d + 8. * a ) * d - 4. * a
+                              : 0.;
+            }
+            else if( i_interp == INTERP_LANCZOS )
+                pf_weights[k] = d < 3. ? Sinc( d ) * Sinc( d / 3. ) : 0.;
+            else
+                /* Nearest: the closest of the two taps, ties to the right */
+                pf_weights[k] = ( k == 0 ) == ( 2 * i_phase < KERNEL_PHASES );
+        }
+
+        /* Lanczos is not normalized */
+        double f_total = 0.;
+        for( int k = 0; k < i_taps; k++ )
+            f_total += pf_weights[k];
+
+        for( int k = 0; k < i_taps; k++ )
+        {
+            const int i_weight = lround( pf_weights[k] / f_total
+                                         * ( 1 << KERNEL_BITS ) );
+            p_kernel->pi_weights[i_phase][k] = i_weight;
+            i_sum += i_weight;
+            if( i_weight > p_kernel->pi_weights[i_phase][i_peak] )
+                i_peak = k;
+        }
+        /* The rounding error goes to the largest weight */
+        p_kernel->pi_weights[i_phase][i_peak] += ( 1 << KERNEL_BITS ) - i_sum;
+        for( int k = i_taps; k < KERNEL_MAX_TAPS; k++ )
+            p_kernel->pi_weights[i_phase][k] = 0;
+    }
+}
+
+/*****************************************************************************
+ * GetKernelWindow: taps of the kernel for a source position
+ *****************************************************************************
+ * The position is rounded to the nearest phase. Returns false when no tap
+ * of the window is inside the source.
+ *****************************************************************************/
+static bool GetKernelWindow( double sx, double sy, int i_taps,
+                             int i_src_width, int i_src_height,
+                             int *pi_left, int *pi_top,
+                             int *pi_phase_x, int *pi_phase_y )
+{
+    /* Also bounds the conversions below */
+    if( !( sx > -i_taps / 2 - 1 && sx < i_src_width + i_taps / 2
+        && sy > -i_taps / 2 - 1 && sy < i_src_height + i_taps / 2 ) )
+        return false;
+
+    const int i_px = (int)floor( sx * KERNEL_PHASES + .5 );
+    const int i_py = (int)floor( sy * KERNEL_PHASES + .5 );
+    const int i_sx = (int)floor( (double)i_px / KERNEL_PHASES );
+    const int i_sy = (int)floor( (double)i_py / KERNEL_PHASES );
+
+    *pi_left = i_sx + 1 - i_taps / 2;
+    *pi_top  = i_sy + 1 - i_taps / 2;
+    *pi_phase_x = i_px - i_sx * KERNEL_PHASES;
+    *pi_phase_y = i_py - i_sy * KERNEL_PHASES;
+
+    return *pi_left < i_src_width && *pi_left + i_taps > 0
+        && *pi_top < i_src_height && *pi_top + i_taps > 0;
+}
+
+/*****************************************************************************
+ * KernelSample: filter one sample from a tap window
+ *****************************************************************************
+ * Each tap row is filtered horizontally, keeping KERNEL_EXTRA bits of
+ * fraction, then the rows are filtered vertically. The taps outside of the
+ * source count as the fill value. The window is given by its first tap, at
+ * (i_left, i_top); p_in points to the sample of the channel at (0, 0).
+ *****************************************************************************/
+static unsigned KernelSample( const uint8_t *p_in, int i_src_pitch,
+                              int i_src_width, int i_src_height,
+                              const warp_component_t *p_comp, int i_taps,
+                              int i_left, int i_top,
+                              const int16_t *p_wx, const int16_t *p_wy )
+{
+    const int i_pixel = p_comp->i_pixel_size;
+    const int fill = p_comp->i_fill;
+    int32_t i_sum = 0;
+
+    for( int j = 0; j < i_taps; j++ )
+    {
+        const int i_row = i_top + j;
+        int32_t i_value = 0;
+
+        if( i_row < 0 || i_row >= i_src_height )
+            i_value = fill << KERNEL_BITS;
+        else
+            for( int k = 0; k < i_taps; k++ )
+            {
+                const int i_col = i_left + k;
+                const int i_sample = i_col >= 0 && i_col < i_src_width
+                    ? (int)GetSample( &p_in[i_row * i_src_pitch
+                                            + i_col * i_pixel], p_comp )
+                    : fill;
+                i_value += p_wx[k] * i_sample;
+            }
+        i_value = ( i_value + ( 1 << ( KERNEL_BITS - KERNEL_EXTRA - 1 ) ) )
+                  >> ( KERNEL_BITS - KERNEL_EXTRA );
+        i_sum += p_wy[j] * i_value;
+    }
+
+    i_sum = ( i_sum + ( 1 << ( KERNEL_BITS + KERNEL_EXTRA - 1 ) ) )
+            >> ( KERNEL_BITS + KERNEL_EXTRA );
+    return VLC_CLIP( i_sum, 0, ( 1 << p_comp->i_bits ) - 1 );
+}
+
+/* KernelSample() for a window inside the source, p_in pointing to its first
+ * tap; inlined with constant taps and sample sizes */
+static inline unsigned KernelSampleInside( const uint8_t *p_in,
+                                           int i_src_pitch, int i_pixel,
+                                           const warp_component_t *p_comp,
+                                           int i_taps, int i_sample_size,
+                                           const int16_t *p_wx,
+                                           const int16_t *p_wy )
+{
+    int32_t i_sum = 0;
+
+    for( int j = 0; j < i_taps; j++, p_in += i_src_pitch )
+    {
+        int32_t i_value = 0;
+        for( int k = 0; k < i_taps; k++ )
+            i_value += p_wx[k] * (int)( i_sample_size == 1
+                                        ? p_in[k * i_pixel]
+                                        : GetSample( &p_in[k * i_pixel],
+                                                     p_comp ) );
+        i_value = ( i_value + ( 1 << ( KERNEL_BITS - KERNEL_EXTRA - 1 ) ) )
+                  >> ( KERNEL_BITS - KERNEL_EXTRA );
+        i_sum += p_wy[j] * i_value;
+    }
+
+    i_sum = ( i_sum + ( 1 << ( KERNEL_BITS + KERNEL_EXTRA - 1 ) ) )
+            >> ( KERNEL_BITS + KERNEL_EXTRA );
+    return VLC_CLIP( i_sum, 0, ( 1 << p_comp->i_bits ) - 1 );
+}
+
+/*****************************************************************************
+ * RenderPlaneKernel: apply perspective transform to rows [i_y_begin,
+ * i_y_end) of one picture plane with a separable kernel, without a map
+ *****************************************************************************/
+static void RenderPlaneKernel( const plane_t *p_src, plane_t *p_dst,
+                               int i_y_width, int i_y_height,
+                               const double h[8],
+                               const warp_component_t *p_comp,
+                               const warp_kernel_t *p_kernel,
+                               int i_y_begin, int i_y_end )
+{
+    const int i_dst_width  = p_dst->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_dst_height = p_dst->i_visible_lines;
+    const int i_src_width  = p_src->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_src_height = p_src->i_visible_lines;
+    const int i_pixel = p_comp->i_pixel_size;
+    const int i_taps = p_kernel->i_taps;
+
+    const double f_scale_x = (double)i_y_width / i_dst_width;
+    const double f_scale_y = (double)i_y_height / i_dst_height;
+    const double f_inv_scale_x = (double)i_dst_width / i_y_width;
+    const double f_inv_scale_y = (double)i_dst_height / i_y_height;
+    const bool b_affine = h[6] == 0. && h[7] == 0.;
+
+    const double h0_sx = h[0] * f_scale_x;
+    const double h3_sx = h[3] * f_scale_x;
+    const double h6_sx = h[6] * f_scale_x;
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        uint8_t *p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
+
+        const double dy = y * f_scale_y;
+
+        double num_x = h[1] * dy + h[2];
+        double num_y = h[4] * dy + h[5];
+        double den   = h[7] * dy + 1.0;
+
+        int i_begin, i_end;
+        GetRowSpan( num_x, num_y, den, h0_sx, h3_sx, h6_sx,
+                    f_inv_scale_x, f_inv_scale_y,
+                    i_src_width, i_src_height, i_dst_width, i_taps / 2,
+                    &i_begin, &i_end );
+
+        FillPixels( p_out, i_begin, p_comp );
+        FillPixels( &p_out[i_end * i_pixel], i_dst_width - i_end, p_comp );
+
+        for( int x = 0; x < i_begin; x++ )
+        {
+            num_x += h0_sx;
+            num_y += h3_sx;
+            den   += h6_sx;
+        }
+
+        for( int x = i_begin; x < i_end; x++ )
+        {
+            uint8_t *p_pixel = &p_out[x * i_pixel];
+            int i_left, i_top, i_phase_x, i_phase_y;
+
+            if( fabs( den ) < 1e-12
+             || !GetKernelWindow( ( b_affine ? num_x : num_x / den )
+                                  * f_inv_scale_x,
+                                  ( b_affine ? num_y : num_y / den )
+                                  * f_inv_scale_y,
+                                  i_taps, i_src_width, i_src_height,
+                                  &i_left, &i_top, &i_phase_x, &i_phase_y ) )
+                FillPixels( p_pixel, 1, p_comp );
+            else
+                for( int c = 0; c < p_comp->i_channels; c++ )
+                    PutSample( &p_pixel[p_comp->pi_offset[c]],
+                               KernelSample( &p_src->p_pixels[p_comp->pi_offset[c]],
+                                             p_src->i_pitch,
+                                             i_src_width, i_src_height,
+                                             p_comp, i_taps, i_left, i_top,
+                                             p_kernel->pi_weights[i_phase_x],
+                                             p_kernel->pi_weights[i_phase_y] ),
+                               p_comp );
+
+            num_x += h0_sx;
+            num_y += h3_sx;
+            den   += h6_sx;
+        }
+    }
+}
+
+/*****************************************************************************
+ * SetKernelEntry: tap window of the destination pixel sampling (sx, sy),
+ * encoded as described for BuildKernelMap()
+ *****************************************************************************
+ * The entry is left alone for windows outside of the source, whose taps
+ * the caller cleared.
+ *****************************************************************************/
+static void SetKernelEntry( const warp_map_t *p_map, warp_entry_t *p_entry,
+                            int i_taps, double sx, double sy )
+{
+    const int i_src_width  = p_map->i_src_width;
+    const int i_src_height = p_map->i_src_height;
+    int i_left, i_top, i_phase_x, i_phase_y;
+
+    if( !GetKernelWindow( sx, sy, i_taps, i_src_width, i_src_height,
+                          &i_left, &i_top, &i_phase_x, &i_phase_y ) )
+        return;
+
+    p_entry->i_fx = i_phase_x;
+    p_entry->i_fy = i_phase_y;
+    if( i_left >= 0 && i_left + i_taps <= i_src_width
+     && i_top >= 0 && i_top + i_taps <= i_src_height )
+    {
+        p_entry->i_offset = i_top * p_map->i_src_pitch
+                          + i_left * p_map->i_pixel_size;
+        p_entry->i_taps = TAP_ALL;
+    }
+    else
+    {
+        p_entry->i_offset = ( i_left + KERNEL_MAX_TAPS )
+                          + ( ( i_top + KERNEL_MAX_TAPS ) << 16 );
+        p_entry->i_taps = TAP_00;
+    }
+}
+
+/*****************************************************************************
+ * BuildKernelMap: precompute the tap windows of rows [i_y_begin, i_y_end)
+ * of a prepared warp map, for a wider kernel
+ *****************************************************************************
+ * Walks the destination like RenderPlaneKernel(). The entries are then:
+ *  - i_fx, i_fy: the kernel phases
+ *  - i_taps: TAP_ALL for windows inside the source, i_offset being the byte
+ *    offset of their first tap; 0 for pixels outside of the source; TAP_00
+ *    for windows across its edges, i_offset then holding the position of
+ *    their first tap, as ( left + KERNEL_MAX_TAPS ) + ( top +
+ *    KERNEL_MAX_TAPS ) << 16
+ *****************************************************************************/
+static void BuildKernelMap( warp_map_t *p_map, int i_y_width, int i_y_height,
+                            const double h[8], const warp_kernel_t *p_kernel,
+                            int i_y_begin, int i_y_end )
+{
+    const int i_dst_width  = p_map->i_dst_width;
+    const int i_dst_height = p_map->i_dst_height;
+    const int i_src_width  = p_map->i_src_width;
+    const int i_src_height = p_map->i_src_height;
+    const int i_taps = p_kernel->i_taps;
+    const bool b_affine = h[6] == 0. && h[7] == 0.;
+
+    const double f_scale_x = (double)i_y_width / i_dst_width;
+    const double f_scale_y = (double)i_y_height / i_dst_height;
+    const double f_inv_scale_x = (double)i_dst_width / i_y_width;
+    const double f_inv_scale_y = (double)i_dst_height / i_y_height;
+
+    const double h0_sx = h[0] * f_scale_x;
+    const double h3_sx = h[3] * f_scale_x;
+    const double h6_sx = h[6] * f_scale_x;
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        warp_entry_t *p_entry = &p_map->p_entries[(size_t)y * i_dst_width];
+
+        const double dy = y * f_scale_y;
+
+        double num_x = h[1] * dy + h[2];
+        double num_y = h[4] * dy + h[5];
+        double den   = h[7] * dy + 1.0;
+
+        warp_row_t *p_row = &p_map->p_rows[y];
+        GetRowSpan( num_x, num_y, den, h0_sx, h3_sx, h6_sx,
+                    f_inv_scale_x, f_inv_scale_y,
+                    i_src_width, i_src_height, i_dst_width, i_taps / 2,
+                    &p_row->i_begin, &p_row->i_end );
+
+        for( int x = 0; x < p_row->i_begin; x++ )
+        {
+            num_x += h0_sx;
+            num_y += h3_sx;
+            den   += h6_sx;
+        }
+        p_entry += p_row->i_begin;
+
+        /* Longest run of windows inside the source */
+        int i_run_begin = p_row->i_begin;
+        int i_best_begin = i_run_begin, i_best_end = i_run_begin;
+
+        for( int x = p_row->i_begin; x < p_row->i_end; x++, p_entry++ )
+        {
+            p_entry->i_taps = 0;
+            if( fabs( den ) >= 1e-12 )
+                SetKernelEntry( p_map, p_entry, i_taps,
+                                ( b_affine ? num_x : num_x / den )
+                                * f_inv_scale_x,
+                                ( b_affine ? num_y : num_y / den )
+                                * f_inv_scale_y );
+
+            if( p_entry->i_taps != TAP_ALL )
+                i_run_begin = x + 1;
+            else if( x + 1 - i_run_begin > i_best_end - i_best_begin )
+            {
+                i_best_begin = i_run_begin;
+                i_best_end   = x + 1;
+            }
+
+            num_x += h0_sx;
+            num_y += h3_sx;
+            den   += h6_sx;
+        }
+
+        p_row->i_inner_begin = i_best_begin;
+        p_row->i_inner_end   = i_best_end;
+    }
+}
+
+/*****************************************************************************
+ * InvertBilinear: coordinates (u, v) of a point in the bilinear patch of the
+ * quad a, b, c, d (top-left, top-right, bottom-right, bottom-left)
+ *****************************************************************************
+ * The patch is a + (b - a) u + (d - a) v + (a - b + c - d) u v, for u and v
+ * in the ranges pf_range[0..1] and pf_range[2..3] ([0, 1] inside the quad).
+ * Solves its quadratic in v; returns false if the point is outside. Points
+ * on the edges, within rounding, are inside: neighbouring patches leave no
+ * gap.
+ *****************************************************************************/
+static bool InvertBilinear( const double a[2], const double b[2],
+                            const double c[2], const double d[2],
+                            const double pf_range[4],
+                            double x, double y, double *pu, double *pv )
+{
+    const double f_eps = 1e-9;
+    const double ex = b[0] - a[0], ey = b[1] - a[1];
+    const double fx = d[0] - a[0], fy = d[1] - a[1];
+    const double gx = a[0] - b[0] + c[0] - d[0];
+    const double gy = a[1] - b[1] + c[1] - d[1];
+    const double hx = x - a[0], hy = y - a[1];
+
+    const double k2 = gx * fy - gy * fx;
+    const double k1 = ex * fy - ey * fx + hx * gy - hy * gx;
+    const double k0 = hx * ey - hy * ex;
+
+    double pf_v[2];
+    int i_roots = 0;
+    if( k2 == 0. )
+    {
+        /* Parallel opposite edges: linear */
+        if( k1 != 0. )
+            pf_v[i_roots++] = -k0 / k1;
+    }
+    else
+    {
+        const double f_disc = k1 * k1 - 4. * k0 * k2;
+        if( f_disc < 0. )
+            return false;
+        /* Without the cancellation of -k1 + sqrt(...) for small k2 */
+        const double q = -.5 * ( k1 + copysign( sqrt( f_disc ), k1 ) );
+        if( q != 0. )
+            pf_v[i_roots++] = k0 / q;
+        pf_v[i_roots++] = q / k2;
+    }
+
+    for( int r = 0; r < i_roots; r++ )
+    {
+        const double v = pf_v[r];
+        if( !( v >= pf_range[2] - f_eps && v <= pf_range[3] + f_eps ) )
+            continue;
+
+        /* u from the better conditioned axis */
+        const double f_den_x = ex + gx * v, f_den_y = ey + gy * v;
+        double u;
+        if( fabs( f_den_x ) >= fabs( f_den_y ) && f_den_x != 0. )
+            u = ( hx - fx * v ) / f_den_x;
+        else if( f_den_y != 0. )
+            u = ( hy - fy * v ) / f_den_y;
+        else
+            continue;
+        if( !( u >= pf_range[0] - f_eps && u <= pf_range[1] + f_eps ) )
+            continue;
+
+        *pu = VLC_CLIP( u, pf_range[0], pf_range[1] );
+        *pv = VLC_CLIP( v, pf_range[2], pf_range[3] );
+        return true;
+    }
+    return false;
+}
+
+/*****************************************************************************
+ * BuildMeshMap: precompute rows [i_y_begin, i_y_end) of a prepared warp
+ * map through the cells of a mesh, as a kernel map with p_kernel
+ *****************************************************************************
+ * Each cell is the bilinear patch of its four points, inverted at every
+ * destination pixel it covers: the position in the patch gives the source
+ * in the matching cell of a regular grid of the picture. The cells of the
+ * edges extend past them for the taps of the kernel that still fall in the
+ * source, blended with the fill value as in the other maps. Pixels covered
+ * by no cell are outside; where folded cells overlap, the first one wins.
+ *****************************************************************************/
+static void BuildMeshMap( warp_map_t *p_map, int i_y_width, int i_y_height,
+                          int i_src_y_width, int i_src_y_height,
+                          const double *pf_points, int i_cols, int i_rows,
+                          const warp_kernel_t *p_kernel,
+                          int i_y_begin, int i_y_end )
+{
+    const int i_dst_width  = p_map->i_dst_width;
+    const int i_dst_height = p_map->i_dst_height;
+    const int i_src_pitch  = p_map->i_src_pitch;
+    /* Widest load of the interior kernels, as in SetWarpEntry() */
+    const int i_load_size  = __MAX( 4, 2 * p_map->i_pixel_size );
+
+    const double f_scale_x = (double)i_y_width / i_dst_width;
+    const double f_scale_y = (double)i_y_height / i_dst_height;
+    const double f_inv_scale_x = (double)i_dst_width / i_y_width;
+    const double f_inv_scale_y = (double)i_dst_height / i_y_height;
+
+    /* Size of the cells in the source, in Y plane pixels */
+    const double f_cell_width  = (double)( i_src_y_width - 1 ) / ( i_cols - 1 );
+    const double f_cell_height = (double)( i_src_y_height - 1 )
+                               / ( i_rows - 1 );
+
+    /* Reach of the edge taps past the edges, in cells: the entries then
+     * drop the positions without any tap in the source */
+    const int i_margin = p_kernel ? p_kernel->i_taps / 2 + 1 : 1;
+    const double f_margin_x = ( i_margin + 1 ) * f_scale_x / f_cell_width;
+    const double f_margin_y = ( i_margin + 1 ) * f_scale_y / f_cell_height;
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        warp_entry_t *p_line = &p_map->p_entries[(size_t)y * i_dst_width];
+        const double dy = y * f_scale_y;
+
+        for( int x = 0; x < i_dst_width; x++ )
+            p_line[x].i_taps = 0;
+
+        for( int j = 0; j < i_rows - 1; j++ )
+            for( int i = 0; i < i_cols - 1; i++ )
+            {
+                const double *a = &pf_points[2 * ( j * i_cols + i )];
+                const double *b = a + 2;
+                const double *d = a + 2 * i_cols;
+                const double *c = d + 2;
+                const double pf_range[4] = {
+                    i == 0 ? -f_margin_x : 0.,
+                    i == i_cols - 2 ? 1. + f_margin_x : 1.,
+                    j == 0 ? -f_margin_y : 0.,
+                    j == i_rows - 2 ? 1. + f_margin_y : 1.,
+                };
+
+                /* Bounding box of the patch over the range: its corners */
+                double f_left = INFINITY, f_right = -INFINITY;
+                double f_top = INFINITY, f_bottom = -INFINITY;
+                for( int k = 0; k < 4; k++ )
+                {
+                    const double u = pf_range[k & 1], v = pf_range[2 + k / 2];
+                    const double px = a[0] + ( b[0] - a[0] ) * u
+                                    + ( d[0] - a[0] ) * v
+                                    + ( a[0] - b[0] + c[0] - d[0] ) * u * v;
+                    const double py = a[1] + ( b[1] - a[1] ) * u
+                                    + ( d[1] - a[1] ) * v
+                                    + ( a[1] - b[1] + c[1] - d[1] ) * u * v;
+                    f_left = __MIN( f_left, px ); f_right = __MAX( f_right, px );
+                    f_top = __MIN( f_top, py ); f_bottom = __MAX( f_bottom, py );
+                }
+                if( dy < f_top || dy > f_bottom )
+                    continue;
+
+                /* Columns of the box, clamped before conversion */
+                const int i_left = ceil( VLC_CLIP( f_left / f_scale_x,
+                                                   0., i_dst_width ) );
+                const int i_right = floor( VLC_CLIP( f_right / f_scale_x,
+                                                     -1., i_dst_width - 1 ) );
+
+                for( int x = i_left; x <= i_right; x++ )
+                {
+                    double u, v;
+                    if( p_line[x].i_taps
+                     || !InvertBilinear( a, b, c, d, pf_range,
+                                         x * f_scale_x, dy, &u, &v ) )
+                        continue;
+
+                    const double sx = ( i + u ) * f_cell_width * f_inv_scale_x;
+                    const double sy = ( j + v ) * f_cell_height * f_inv_scale_y;
+                    if( p_kernel )
+                        SetKernelEntry( p_map, &p_line[x], p_kernel->i_taps,
+                                        sx, sy );
+                    else
+                        SetWarpEntry( p_map, &p_line[x], sx, sy );
+                }
+            }
+
+        /* Span of the covered pixels, and its longest run of pixels for
+         * the interior kernels */
+        warp_row_t *p_row = &p_map->p_rows[y];
+        int i_begin = 0, i_end = i_dst_width;
+        while( i_begin < i_end && !p_line[i_begin].i_taps )
+            i_begin++;
+        while( i_end > i_begin && !p_line[i_end - 1].i_taps )
+            i_end--;
+
+        int i_run_begin = i_begin;
+        int i_best_begin = i_begin, i_best_end = i_begin;
+        for( int x = i_begin; x < i_end; x++ )
+        {
+            const warp_entry_t *p_entry = &p_line[x];
+            /* Bilinear taps start i_offset % i_src_pitch into their row */
+            const bool b_inner = p_entry->i_taps == TAP_ALL
+                && ( p_kernel || p_entry->i_offset % i_src_pitch
+                                 + i_load_size <= i_src_pitch );
+            if( !b_inner )
+                i_run_begin = x + 1;
+            else if( x + 1 - i_run_begin > i_best_end - i_best_begin )
+            {
+                i_best_begin = i_run_begin;
+                i_best_end   = x + 1;
+            }
+        }
+
+        p_row->i_begin = i_begin;
+        p_row->i_end   = i_end;
+        p_row->i_inner_begin = i_best_begin;
+        p_row->i_inner_end   = i_best_end;
+    }
+}
+
+/*****************************************************************************
+ * KernelSpan: edge-aware kernel sampling of a run of kernel map entries
+ *****************************************************************************/
+static void KernelSpan( uint8_t *p_out, const plane_t *p_src,
+                        const warp_entry_t *p_entry, int i_count,
+                        const warp_component_t *p_comp,
+                        const warp_kernel_t *p_kernel )
+{
+    const int i_pixel = p_comp->i_pixel_size;
+    const int i_src_width  = p_src->i_visible_pitch / i_pixel;
+    const int i_src_height = p_src->i_visible_lines;
+
+    for( int x = 0; x < i_count; x++, p_entry++, p_out += i_pixel )
+    {
+        if( !p_entry->i_taps )
+        {
+            FillPixels( p_out, 1, p_comp );
+            continue;
+        }
+
+        const int16_t *p_wx = p_kernel->pi_weights[p_entry->i_fx];
+        const int16_t *p_wy = p_kernel->pi_weights[p_entry->i_fy];
+        for( int c = 0; c < p_comp->i_channels; c++ )
+        {
+            const uint8_t *p_in = &p_src->p_pixels[p_comp->pi_offset[c]];
+            unsigned i_value;
+
+            if( p_entry->i_taps == TAP_ALL )
+                i_value = KernelSampleInside( &p_in[p_entry->i_offset],
+                                              p_src->i_pitch, i_pixel, p_comp,
+                                              p_kernel->i_taps,
+                                              p_comp->i_sample_size,
+                                              p_wx, p_wy );
+            else
+                i_value = KernelSample( p_in, p_src->i_pitch,
+                                        i_src_width, i_src_height, p_comp,
+                                        p_kernel->i_taps,
+                                        ( p_entry->i_offset & 0xffff )
+                                        - KERNEL_MAX_TAPS,
+                                        ( p_entry->i_offset >> 16 )
+                                        - KERNEL_MAX_TAPS,
+                                        p_wx, p_wy );
+            PutSample( &p_out[p_comp->pi_offset[c]], i_value, p_comp );
+        }
+    }
+}
+
+/* Windows inside the source of a single 8-bit channel: the bulk of the
+ * work, with the kernel size known to the compiler */
+#define KERNEL_INTERIOR( taps ) \
+    for( int x = 0; x < i_count; x++ ) \
+        p_out[x] = KernelSampleInside( &p_in[p_entry[x].i_offset], \
+                                       i_src_pitch, 1, p_comp, taps, 1, \
+                                       pi_weights[p_entry[x].i_fx], \
+                                       pi_weights[p_entry[x].i_fy] )
+
+static void KernelInterior8( uint8_t *p_out, const uint8_t *p_in,
+                             int i_src_pitch, const warp_entry_t *p_entry,
+                             int i_count, const warp_component_t *p_comp,
+                             const warp_kernel_t *p_kernel )
+{
+    const int16_t (*pi_weights)[KERNEL_MAX_TAPS] = p_kernel->pi_weights;
+
+    if( p_kernel->i_taps == 4 )
+        KERNEL_INTERIOR( 4 );
+    else if( p_kernel->i_taps == 6 )
+        KERNEL_INTERIOR( 6 );
+    else
+        KERNEL_INTERIOR( p_kernel->i_taps );
+}
+#undef KERNEL_INTERIOR
+
+/*****************************************************************************
+ * RenderPlaneKernelMap: render columns [i_x_begin, i_x_end) of rows
+ * [i_y_begin, i_y_end) of one plane from its kernel map
+ *****************************************************************************/
+static void RenderPlaneKernelMap( const warp_map_t *p_map,
+                                  const plane_t *p_src, plane_t *p_dst,
+                                  const warp_component_t *p_comp,
+                                  const warp_kernel_t *p_kernel,
+                                  int i_x_begin, int i_x_end,
+                                  int i_y_begin, int i_y_end )
+{
+    const int i_width = p_map->i_dst_width;
+    const int i_pixel = p_comp->i_pixel_size;
+    const bool b_interior = i_pixel == 1;
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        uint8_t *p_out = &p_dst->p_pixels[y * p_dst->i_pitch];
+        const warp_entry_t *p_line = &p_map->p_entries[(size_t)y * i_width];
+        const warp_row_t *p_row = &p_map->p_rows[y];
+        const int i_begin = VLC_CLIP( p_row->i_begin, i_x_begin, i_x_end );
+        const int i_end = VLC_CLIP( p_row->i_end, i_begin, i_x_end );
+        int x = i_begin;
+
+        FillPixels( &p_out[i_x_begin * i_pixel], i_begin - i_x_begin,
+                    p_comp );
+        if( b_interior )
+        {
+            const int i_inner_begin = VLC_CLIP( p_row->i_inner_begin,
+                                                i_begin, i_end );
+            const int i_inner_end = VLC_CLIP( p_row->i_inner_end,
+                                              i_inner_begin, i_end );
+            KernelSpan( &p_out[x], p_src, &p_line[x],
+                        i_inner_begin - x, p_comp, p_kernel );
+            x = i_inner_begin;
+            KernelInterior8( &p_out[x], p_src->p_pixels, p_src->i_pitch,
+                             &p_line[x], i_inner_end - x,
+                             p_comp, p_kernel );
+            x = i_inner_end;
+        }
+        KernelSpan( &p_out[x * i_pixel], p_src, &p_line[x],
+                    i_end - x, p_comp, p_kernel );
+        FillPixels( &p_out[i_end * i_pixel], i_x_end - i_end, p_comp );
+    }
+}
+
+/*****************************************************************************
+ * RenderMapRect: render a rectangle of one plane from its map, with the
+ * renderer of the interpolation
+ *****************************************************************************/
+static void RenderMapRect( const warp_map_t *p_map, const plane_t *p_src,
+                           plane_t *p_dst, const warp_component_t *p_comp,
+                           int i_interp, const warp_kernel_t *p_kernel,
+                           int i_x_begin, int i_x_end,
+                           int i_y_begin, int i_y_end )
+{
+    if( i_interp == INTERP_NEAREST )
+        RenderPlaneMapNearest( p_map, p_src, p_dst, p_comp,
+                               i_x_begin, i_x_end, i_y_begin, i_y_end );
+    else if( i_interp == INTERP_BILINEAR )
+        RenderPlaneMap( p_map, p_src, p_dst, p_comp,
+                        i_x_begin, i_x_end, i_y_begin, i_y_end );
+    else
+        RenderPlaneKernelMap( p_map, p_src, p_dst, p_comp, p_kernel,
+                              i_x_begin, i_x_end, i_y_begin, i_y_end );
+}
+
+/*****************************************************************************
+ * PrefetchTile: bring what a destination tile reads and writes into the
+ * cache
+ *****************************************************************************
+ * The rows of the tile in the map and in the destination are short runs
+ * out of long rows, that the hardware prefetchers do not follow. The
+ * straight edges of the tile map to straight lines, so its source window
+ * is the bounding box of the taps of its corners, when all of them have
+ * their taps inside the source; it is skipped when too large to be worth
+ * it.
+ *****************************************************************************/
+static void PrefetchTile( const warp_map_t *p_map, const plane_t *p_src,
+                          const plane_t *p_dst,
+                          const warp_component_t *p_comp, int i_taps,
+                          int i_x_begin, int i_x_end,
+                          int i_y_begin, int i_y_end )
+{
+    const int i_width = p_map->i_dst_width;
+    const int i_pixel = p_comp->i_pixel_size;
+    const int i_pitch = p_map->i_src_pitch;
+    int i_row_min = INT_MAX, i_row_max = INT_MIN;
+    int i_col_min = INT_MAX, i_col_max = INT_MIN;
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        const warp_entry_t *p_line = &p_map->p_entries[(size_t)y * i_width];
+        for( int x = i_x_begin; x < i_x_end;
+             x += CACHE_LINE / sizeof( warp_entry_t ) )
+            PREFETCH( &p_line[x], 0 );
+        for( int x = i_x_begin * i_pixel; x < i_x_end * i_pixel;
+             x += CACHE_LINE )
+            PREFETCH( &p_dst->p_pixels[y * p_dst->i_pitch + x], 1 );
+    }
+
+    for( int i = 0; i < 4; i++ )
+    {
+        const int x = i & 1 ? i_x_end - 1 : i_x_begin;
+        const int y = i & 2 ? i_y_end - 1 : i_y_begin;
+        const warp_entry_t *p_entry =
+            &p_map->p_entries[(size_t)y * i_width + x];
+        if( p_entry->i_taps != TAP_ALL )
+            return;
+
+        i_row_min = __MIN( i_row_min, p_entry->i_offset / i_pitch );
+        i_row_max = __MAX( i_row_max, p_entry->i_offset / i_pitch );
+        i_col_min = __MIN( i_col_min, p_entry->i_offset % i_pitch );
+        i_col_max = __MAX( i_col_max, p_entry->i_offset % i_pitch );
+    }
+    i_row_max = __MIN( i_row_max + i_taps - 1, p_src->i_lines - 1 );
+    i_col_min &= ~( CACHE_LINE - 1 );
+    i_col_max = __MIN( i_col_max + i_taps * i_pixel, i_pitch - 1 );
+    if( ( i_row_max - i_row_min + 1 )
+        * ( ( i_col_max - i_col_min ) / CACHE_LINE + 1 ) > TILE_PREFETCH )
+        return;
+
+    for( int y = i_row_min; y <= i_row_max; y++ )
+        for( int x = i_col_min; x <= i_col_max; x += CACHE_LINE )
+            PREFETCH( &p_src->p_pixels[y * i_pitch + x], 0 );
+}
+
+/*****************************************************************************
+ * RenderPlaneMapTiles: render rows [i_y_begin, i_y_end) of one plane from
+ * its map, in tiles of TILE_WIDTH x TILE_LINES pixels
+ *****************************************************************************
+ * When the warp is steep, a destination row crosses many source rows, and
+ * by the time the next one comes back to them, they left the first level
+ * cache. The source window of a tile is small enough to stay there for all
+ * of its rows, and is prefetched while the previous tile is rendered. The
+ * pixels are the same as in row order.
+ *
+ * Planes of packed pixels measured slower this way at 8K (more bytes per
+ * source row, and a generic blend with a larger cost per run), and stay in
+ * row order.
+ *****************************************************************************/
+static void RenderPlaneMapTiles( const warp_map_t *p_map,
+                                 const plane_t *p_src, plane_t *p_dst,
+                                 const warp_component_t *p_comp,
+                                 int i_interp, const warp_kernel_t *p_kernel,
+                                 int i_y_begin, int i_y_end )
+{
+    const int i_width = p_map->i_dst_width;
+    const int i_taps = i_interp > INTERP_BILINEAR ? p_kernel->i_taps : 2;
+
+    for( int y = i_y_begin; y < i_y_end; y += TILE_LINES )
+    {
+        const int y_end = __MIN( y + TILE_LINES, i_y_end );
+
+        PrefetchTile( p_map, p_src, p_dst, p_comp, i_taps,
+                      0, __MIN( TILE_WIDTH, i_width ), y, y_end );
+        for( int x = 0; x < i_width; x += TILE_WIDTH )
+        {
+            const int x_end = __MIN( x + TILE_WIDTH, i_width );
+
+            if( x_end < i_width )
+                PrefetchTile( p_map, p_src, p_dst, p_comp, i_taps, x_end,
+                              __MIN( x_end + TILE_WIDTH, i_width ),
+                              y, y_end );
+            RenderMapRect( p_map, p_src, p_dst, p_comp, i_interp, p_kernel,
+                           x, x_end, y, y_end );
+        }
+    }
+}
+
+/*****************************************************************************
+ * IsSteep: whether a destination row of a warp crosses too many source
+ * rows to be rendered in row order
+ *****************************************************************************
+ * Sampled on the first, middle and last rows of the output Y plane.
+ *****************************************************************************/
+static bool IsSteep( const double h[8], int i_width, int i_height )
+{
+    for( int i = 0; i < 3; i++ )
+    {
+        const double y = ( i_height - 1 ) * i / 2.;
+        double sx, sy0, sy1;
+
+        MapPoint( h, 1., 1., 0., y, &sx, &sy0 );
+        MapPoint( h, 1., 1., i_width - 1, y, &sx, &sy1 );
+        if( fabs( sy1 - sy0 ) > TILE_STEEP_ROWS )
+            return true;
+    }
+    return false;
+}
+
+/*****************************************************************************
+ * LoadCorners: consistent copy of the corner offsets, and of those of the
+ * mesh points (2 * i_mesh_cols * i_mesh_rows values)
+ *****************************************************************************
+ * Returns the sequence count they were read at: when it did not change,
+ * neither did they.
+ *****************************************************************************/
+static unsigned LoadCorners( filter_sys_t *p_sys, float pf_corners[8],
+                             float *pf_mesh )
+{
+    const int i_mesh = 2 * p_sys->i_mesh_cols * p_sys->i_mesh_rows;
+
+    for( ;; )
+    {
+        const unsigned i_seq = atomic_load( &p_sys->i_corners_seq );
+        if( i_seq & 1 )
+            continue;   /* Being written, for the time of a few stores */
+
+        for( int i = 0; i < 8; i++ )
+            pf_corners[i] = vlc_atomic_load_float( &p_sys->pf_corners[i] );
+        for( int i = 0; i < i_mesh; i++ )
+            pf_mesh[i] = vlc_atomic_load_float( &p_sys->pf_mesh[i] );
+        if( atomic_load( &p_sys->i_corners_seq ) == i_seq )
+            return i_seq;
+    }
+}
+
+/*****************************************************************************
+ * LockCorners, UnlockCorners: bracket writes of the corner offsets
+ *****************************************************************************
+ * In between, the writer may also read them directly.
+ *****************************************************************************/
+static void LockCorners( filter_sys_t *p_sys )
+{
+    vlc_mutex_lock( &p_sys->corners_lock );
+    atomic_fetch_add( &p_sys->i_corners_seq, 1 );
+}
+
+static void UnlockCorners( filter_sys_t *p_sys )
+{
+    atomic_fetch_add( &p_sys->i_corners_seq, 1 );
+    vlc_mutex_unlock( &p_sys->corners_lock );
+}
+
+/*****************************************************************************
+ * GetMeshCorner: index of the mesh point on a corner (0=TL, 1=TR, 2=BL, 3=BR)
+ *****************************************************************************/
+static int GetMeshCorner( int i_cols, int i_rows, int i_corner )
+{
+    return ( ( i_corner & 1 ) ? i_cols - 1 : 0 )
+         + ( ( i_corner & 2 ) ? ( i_rows - 1 ) * i_cols : 0 );
+}
+
+/*****************************************************************************
+ * GetMeshPoints: destination of the mesh points, in Y plane pixels
+ *****************************************************************************
+ * Each point goes where the corner keystone takes its place on a regular
+ * grid of the picture, moved by its offset: without offsets, every cell
+ * is a piece of the keystone. Returns false if the corners are degenerate.
+ *****************************************************************************/
+static bool GetMeshPoints( double *pf_points, int i_cols, int i_rows,
+                           const float pf_corners[8], const float *pf_mesh,
+                           int i_width, int i_height )
+{
+    double pf_dst[8], hf[8];
+
+    /* Corners, where the user places them */
+    for( int c = 0; c < 4; c++ )
+    {
+        pf_dst[2 * c]     = ( ( c & 1 ) ? i_width - 1 : 0 )
+                          + pf_corners[2 * c] * i_width;
+        pf_dst[2 * c + 1] = ( ( c & 2 ) ? i_height - 1 : 0 )
+                          + pf_corners[2 * c + 1] * i_height;
+    }
+
+    /* Forward transform, from the picture to the corners */
+    if( !ComputeHomography( hf,
+            pf_dst[0], pf_dst[1], 0., 0.,
+            pf_dst[2], pf_dst[3], i_width - 1, 0.,
+            pf_dst[4], pf_dst[5], 0., i_height - 1,
+            pf_dst[6], pf_dst[7], i_width - 1, i_height - 1 ) )
+        return false;
+
+    for( int j = 0; j < i_rows; j++ )
+        for( int i = 0; i < i_cols; i++ )
+        {
+            const int k = j * i_cols + i;
+            const double u = (double)i * ( i_width - 1 ) / ( i_cols - 1 );
+            const double v = (double)j * ( i_height - 1 ) / ( i_rows - 1 );
+            const double den = hf[6] * u + hf[7] * v + 1.;
+
+            if( fabs( den ) < 1e-12 )
+                return false;
+            pf_points[2 * k]     = ( hf[0] * u + hf[1] * v + hf[2] ) / den
+                                 + pf_mesh[2 * k] * i_width;
+            pf_points[2 * k + 1] = ( hf[3] * u + hf[4] * v + hf[5] ) / den
+                                 + pf_mesh[2 * k + 1] * i_height;
+        }
+
+    /* The corner points exactly on the corners */
+    for( int c = 0; c < 4; c++ )
+    {
+        const int k = GetMeshCorner( i_cols, i_rows, c );
+        pf_points[2 * k]     = pf_dst[2 * c];
+        pf_points[2 * k + 1] = pf_dst[2 * c + 1];
+    }
+    return true;
+}
+
+/*****************************************************************************
+ * HashWords: FNV-1a over the 64-bit words of a buffer, i_size being a
+ * multiple of 8
+ *****************************************************************************/
+#define HASH_INIT UINT64_C(0xcbf29ce484222325)
+
+static uint64_t HashWords( uint64_t i_hash, const void *p_data, size_t i_size )
+{
+    const uint8_t *p = p_data;
+
+    for( size_t i = 0; i < i_size; i += 8 )
+    {
+        uint64_t i_word;
+        memcpy( &i_word, &p[i], 8 );
+        i_hash = ( i_hash ^ i_word ) * UINT64_C(0x100000001b3);
+    }
+    return i_hash;
+}
+
+/*****************************************************************************
+ * GetProfileParams: parameters of a profile, from corner and mesh offsets
+ *****************************************************************************/
+static void GetProfileParams( profile_params_t *p_params,
+                              const float pf_corners[8], const float *pf_mesh,
+                              int i_cols, int i_rows )
+{
+    memset( p_params, 0, sizeof( *p_params ) );
+    memcpy( p_params->pf_corners, pf_corners, sizeof( p_params->pf_corners ) );
+    p_params->i_mesh_cols = i_cols;
+    p_params->i_mesh_rows = i_rows;
+    if( i_cols )
+        memcpy( p_params->pf_mesh, pf_mesh,
+                2 * i_cols * i_rows * sizeof( *pf_mesh ) );
+}
+
+/*****************************************************************************
+ * GetProfileMapKey: key of the map of a component for the render cache
+ *****************************************************************************
+ * The map only depends on the parameters (their hash), and on the chroma,
+ * interpolation and picture sizes it was built with. The plane geometry
+ * is checked by WarpMapMatches() when rendering.
+ *****************************************************************************/
+static uint64_t GetProfileMapKey( const filter_sys_t *p_sys, uint64_t i_hash,
+                                  int i_component )
+{
+    const uint32_t pi_key[8] = {
+        p_sys->i_chroma, p_sys->i_interp, i_component, PROFILE_VERSION,
+        p_sys->i_cache_width, p_sys->i_cache_height,
+        p_sys->i_cache_src_width, p_sys->i_cache_src_height,
+    };
+    return HashWords( i_hash, pi_key, sizeof( pi_key ) );
+}
+
+/*****************************************************************************
+ * AttachProfileMaps: use the maps of the profile built for the cache key
+ *****************************************************************************
+ * They are read in place, from the file mapping: PrepareWarpMap() detaches
+ * them again if the pictures have another geometry.
+ *****************************************************************************/
+static void AttachProfileMaps( filter_sys_t *p_sys )
+{
+    const profile_t *p_profile = &p_sys->profile;
+    if( !p_profile->p_data || !p_profile->p_header->i_maps )
+        return;
+
+    profile_params_t params;
+    GetProfileParams( &params, p_sys->pf_cache_corners, p_sys->pf_cache_mesh,
+                      p_sys->i_mesh_cols, p_sys->i_mesh_rows );
+    const uint64_t i_hash = HashWords( HASH_INIT, &params, sizeof( params ) );
+    if( i_hash != p_profile->p_header->i_hash )
+        return;
+
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        const uint64_t i_key = GetProfileMapKey( p_sys, i_hash, i );
+
+        for( unsigned m = 0; m < p_profile->p_header->i_maps; m++ )
+        {
+            const profile_map_t *p_record = &p_profile->p_maps[m];
+            if( p_record->i_key != i_key
+             || ( p_profile->i_bad_maps & ( 1u << m ) )
+             || p_record->i_taps != ( p_sys->i_interp > INTERP_BILINEAR
+                                      ? p_sys->kernel.i_taps : 0 ) )
+                continue;
+
+            warp_map_t *p_map = &p_sys->maps[i];
+            if( !p_map->b_mapped )
+            {
+                free( p_map->p_entries );
+                free( p_map->p_rows );
+            }
+            uint8_t *p_entries = p_profile->p_data + p_record->i_offset;
+            *p_map = (warp_map_t) {
+                .i_dst_width  = p_record->i_dst_width,
+                .i_dst_height = p_record->i_dst_height,
+                .i_src_width  = p_record->i_src_width,
+                .i_src_height = p_record->i_src_height,
+                .i_src_pitch  = p_record->i_src_pitch,
+                .i_pixel_size = p_record->i_pixel_size,
+                .p_entries = (warp_entry_t *)p_entries,
+                .p_rows = (warp_row_t *)( p_entries
+                        + (size_t)p_record->i_dst_width
+                        * p_record->i_dst_height * sizeof( warp_entry_t ) ),
+                .b_mapped = true,
+            };
+            break;
+        }
+    }
+}
+
+/*****************************************************************************
+ * PrepareColumns: grow the column buffers of RenderPlaneRows() to the
+ * source width, one per thread
+ *****************************************************************************
+ * Without memory for them, RenderPicture() picks another renderer.
+ *****************************************************************************/
+static void PrepareColumns( filter_sys_t *p_sys, int i_src_width )
+{
+    int i_channels = 1;
+    for( int i = 0; i < p_sys->i_components; i++ )
+        i_channels = __MAX( i_channels, p_sys->components[i].i_channels );
+
+    const size_t i_columns = (size_t)( i_src_width + 2 ) * i_channels;
+    if( i_columns <= p_sys->i_columns )
+        return;
+
+    uint32_t *p_columns = realloc( p_sys->p_columns, i_columns
+                                   * ( p_sys->i_workers + 1 )
+                                   * sizeof( *p_columns ) );
+    if( !p_columns )
+        return;
+    p_sys->p_columns = p_columns;
+    p_sys->i_columns = i_columns;
+}
+
+/*****************************************************************************
+ * UpdateRenderCache: recompute the homography when the corners or the
+ * picture sizes changed, and invalidate the warp maps accordingly
+ *****************************************************************************
+ * i_width x i_height is the output picture, where the corners are placed,
+ * and i_src_width x i_src_height the source: a different size rescales the
+ * picture within the same homography.
+ *****************************************************************************/
+static void UpdateRenderCache( filter_sys_t *p_sys, const float pf_corners[8],
+                               const float *pf_mesh, int i_width, int i_height,
+                               int i_src_width, int i_src_height )
+{
+    const int i_mesh = 2 * p_sys->i_mesh_cols * p_sys->i_mesh_rows;
+
+    if( p_sys->b_cache_valid
+     && p_sys->i_cache_width == i_width && p_sys->i_cache_height == i_height
+     && p_sys->i_cache_src_width == i_src_width
+     && p_sys->i_cache_src_height == i_src_height
+     && !memcmp( p_sys->pf_cache_corners, pf_corners,
+                 sizeof( p_sys->pf_cache_corners ) )
+     && ( !i_mesh || !memcmp( p_sys->pf_cache_mesh, pf_mesh,
+                              i_mesh * sizeof( *pf_mesh ) ) ) )
+        return;
+
+    /* Destination corners (where the user places them) */
+    double dx0 = pf_corners[0] * i_width;
+    double dy0 = pf_corners[1] * i_height;
+    double dx1 = (double)( i_width - 1 ) + pf_corners[2] * i_width;
+    double dy1 = pf_corners[3] * i_height;
+    double dx2 = pf_corners[4] * i_width;
+    double dy2 = (double)( i_height - 1 ) + pf_corners[5] * i_height;
+    double dx3 = (double)( i_width - 1 ) + pf_corners[6] * i_width;
+    double dy3 = (double)( i_height - 1 ) + pf_corners[7] * i_height;
+
+    /* Source corners (original rectangle) */
+    double sx0 = 0.0,                         sy0 = 0.0;
+    double sx1 = (double)( i_src_width - 1 ), sy1 = 0.0;
+    double sx2 = 0.0,                         sy2 = (double)( i_src_height - 1 );
+    double sx3 = (double)( i_src_width - 1 ), sy3 = (double)( i_src_height - 1 );
+
+    p_sys->b_homography = ComputeHomography( p_sys->h,
+            sx0, sy0, dx0, dy0,
+            sx1, sy1, dx1, dy1,
+            sx2, sy2, dx2, dy2,
+            sx3, sy3, dx3, dy3 );
+
+    /* Recognize the simpler shapes, and clear the rounding residue of the
+     * solver from the terms they cancel, so the renderers can rely on it */
+    double *h = p_sys->h;
+    const bool b_rows = pf_corners[1] == pf_corners[3]
+                     && pf_corners[5] == pf_corners[7];
+    const bool b_affine = dx0 + dx3 == dx1 + dx2 && dy0 + dy3 == dy1 + dy2;
+
+    if( !p_sys->b_homography )
+        p_sys->i_transform = TRANSFORM_PERSPECTIVE;
+    else if( pf_corners[0] == pf_corners[2] && pf_corners[0] == pf_corners[4]
+          && pf_corners[0] == pf_corners[6] && b_rows
+          && pf_corners[1] == pf_corners[5]
+          && i_width == i_src_width && i_height == i_src_height )
+    {
+        p_sys->i_transform = TRANSFORM_TRANSLATE;
+        h[0] = 1.; h[1] = 0.; h[2] = -dx0;
+        h[3] = 0.; h[4] = 1.; h[5] = -dy0;
+        h[6] = 0.; h[7] = 0.;
+    }
+    else if( b_rows || b_affine )
+    {
+        if( b_rows )
+            h[3] = h[6] = 0.;
+        if( b_affine )
+            h[6] = h[7] = 0.;
+        p_sys->i_transform = b_rows ? TRANSFORM_ROWS : TRANSFORM_AFFINE;
+    }
+    else
+        p_sys->i_transform = TRANSFORM_PERSPECTIVE;
+
+    /* Moved mesh points: the keystone only places the mesh */
+    bool b_mesh = false;
+    for( int i = 0; i < i_mesh; i++ )
+        if( pf_mesh[i] != 0.f )
+            b_mesh = true;
+    if( b_mesh && p_sys->b_homography )
+    {
+        p_sys->i_transform = TRANSFORM_MESH;
+        p_sys->b_homography = GetMeshPoints( p_sys->pf_mesh_points,
+                                             p_sys->i_mesh_cols,
+                                             p_sys->i_mesh_rows,
+                                             pf_corners, pf_mesh,
+                                             i_width, i_height );
+    }
+
+    /* Degenerate corners or mesh: the picture is not warped, only rescaled
+     * to an output of another size (Filter() passes it through else) */
+    if( !p_sys->b_homography )
+    {
+        h[0] = i_width > 1 ? (double)( i_src_width - 1 ) / ( i_width - 1 )
+                           : 0.;
+        h[1] = 0.; h[2] = 0.;
+        h[3] = 0.;
+        h[4] = i_height > 1 ? (double)( i_src_height - 1 ) / ( i_height - 1 )
+                            : 0.;
+        h[5] = 0.;
+        h[6] = 0.; h[7] = 0.;
+        p_sys->i_transform = TRANSFORM_ROWS;
+    }
+
+    p_sys->b_tiled = p_sys->b_homography
+                  && IsSteep( p_sys->h, i_width, i_height );
+
+    /* Keep the allocations, only force the maps to be rebuilt */
+    for( int i = 0; i < PICTURE_PLANE_MAX; i++ )
+    {
+        p_sys->maps[i].i_dst_width = 0;
+        p_sys->grids[i].i_dst_width = 0;
+    }
+
+    memcpy( p_sys->pf_cache_corners, pf_corners,
+            sizeof( p_sys->pf_cache_corners ) );
+    if( i_mesh )
+        memcpy( p_sys->pf_cache_mesh, pf_mesh, i_mesh * sizeof( *pf_mesh ) );
+    p_sys->i_cache_width  = i_width;
+    p_sys->i_cache_height = i_height;
+    p_sys->i_cache_src_width  = i_src_width;
+    p_sys->i_cache_src_height = i_src_height;
+    p_sys->b_cache_valid  = true;
+    p_sys->b_cache_new    = true;
+
+    PrepareColumns( p_sys, i_src_width );
+    AttachProfileMaps( p_sys );
+}
+
+/*****************************************************************************
+ * GetEdgeLight: light of a position of the picture, from 0 to 1, at f in
+ * [0, 1] along an axis with soft edges of widths f_low and f_high
+ *****************************************************************************
+ * Smoothstep ramps: the ramp of the neighbouring projector over the same
+ * overlap is the mirror one, and both add up to one everywhere.
+ *****************************************************************************/
+static double GetEdgeLight( double f, double f_low, double f_high )
+{
+    double f_light = 1.;
+
+    if( f < f_low )
+    {
+        const double t = f / f_low;
+        f_light *= t * t * ( 3. - 2. * t );
+    }
+    if( f > 1. - f_high )
+    {
+        const double t = ( 1. - f ) / f_high;
+        f_light *= t * t * ( 3. - 2. * t );
+    }
+    return f_light;
+}
+
+/*****************************************************************************
+ * PrepareSoftEdge: (re)build the soft edge gains of a component for the
+ * output plane
+ *****************************************************************************
+ * The light is faded, not the samples: the gains are the ramps raised to
+ * 1 / gamma. Returns false, without gains, if out of memory.
+ *****************************************************************************/
+static bool PrepareSoftEdge( soft_edge_t *p_edge, const filter_sys_t *p_sys,
+                             const warp_component_t *p_comp,
+                             const plane_t *p_dst )
+{
+    const int i_width  = p_dst->i_visible_pitch / p_comp->i_pixel_size;
+    const int i_height = p_dst->i_visible_lines;
+    const unsigned i_unit = 1u << EDGE_BITS;
+    const double f_exponent = 1. / p_sys->f_edge_gamma;
+
+    if( p_edge->pi_gains && p_edge->i_width == i_width
+     && p_edge->i_height == i_height )
+        return true;
+
+    free( p_edge->pi_gains );
+    p_edge->pi_gains = malloc( (size_t)( i_width + i_height )
+                               * sizeof( *p_edge->pi_gains ) );
+    if( !p_edge->pi_gains )
+        return false;
+    p_edge->i_width  = i_width;
+    p_edge->i_height = i_height;
+
+    uint16_t *pi_column = p_edge->pi_gains, *pi_row = pi_column + i_width;
+    for( int x = 0; x < i_width; x++ )
+        pi_column[x] = lround( i_unit * pow( GetEdgeLight(
+            ( x + .5 ) / i_width, p_sys->pf_edge[0], p_sys->pf_edge[1] ),
+            f_exponent ) );
+    for( int y = 0; y < i_height; y++ )
+        pi_row[y] = lround( i_unit * pow( GetEdgeLight(
+            ( y + .5 ) / i_height, p_sys->pf_edge[2], p_sys->pf_edge[3] ),
+            f_exponent ) );
+
+    p_edge->i_left = 0;
+    while( p_edge->i_left < i_width && pi_column[p_edge->i_left] != i_unit )
+        p_edge->i_left++;
+    p_edge->i_right = i_width;
+    while( p_edge->i_right > p_edge->i_left
+        && pi_column[p_edge->i_right - 1] != i_unit )
+        p_edge->i_right--;
+
+    /* Alpha is kept, chroma fades to neutral without being raised */
+    p_edge->i_lift = lround( p_sys->f_edge_black
+                             * ( ( 1u << p_comp->i_bits ) - 1 ) );
+    p_edge->b_lift_all = p_edge->i_lift > 0 && IsDense( p_comp );
+    for( int c = 0; c < p_comp->i_channels; c++ )
+    {
+        const int i_channel = p_comp->pi_channel[c];
+
+        p_edge->pb_scale[c] = p_sys->b_rgb ? i_channel != RGB_A
+                                           : i_channel != A_PLANE;
+        p_edge->pb_lift[c] = p_edge->i_lift > 0
+                          && ( p_sys->b_rgb ? i_channel != RGB_A
+                                            : i_channel == Y_PLANE );
+        p_edge->b_lift_all &= p_edge->pb_lift[c];
+    }
+    bool b_lift = false;
+    for( int c = 0; c < p_comp->i_channels; c++ )
+        b_lift |= p_edge->pb_lift[c];
+    if( !b_lift )
+        p_edge->i_lift = 0;
+    return true;
+}
+
+/*****************************************************************************
+ * FadeRow8/LiftRow8: soft edge of a row of planar 8-bit samples
+ *****************************************************************************
+ * The gain of each sample is that of its column times i_row_gain. The
+ * products of the vectors are exact, so they match the C code bit for bit.
+ *****************************************************************************/
+static void FadeRow8( uint8_t *p, const uint16_t *pi_column,
+                      unsigned i_row_gain, unsigned i_fill, int i_count )
+{
+    const unsigned i_unit = 1u << EDGE_BITS, i_half = i_unit >> 1;
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i row = _mm_set1_epi32( i_row_gain );
+    const __m128i half = _mm_set1_epi32( i_half );
+    const __m128i unit = _mm_set1_epi32( i_unit );
+    const __m128i fill = _mm_set1_epi32( i_fill << 16 );
+
+    for( ; x + 8 <= i_count; x += 8 )
+    {
+        const __m128i col = _mm_loadu_si128( (const __m128i *)&pi_column[x] );
+        const __m128i v = _mm_unpacklo_epi8(
+            _mm_loadl_epi64( (const __m128i *)&p[x] ), zero );
+        __m128i out[2];
+
+        for( int k = 0; k < 2; k++ )
+        {
+            /* 16-bit pairs (gain, 0) * (row, 0), then (v, fill) weighted by
+             * (gain, unit - gain) */
+            const __m128i c = k ? _mm_unpackhi_epi16( col, zero )
+                                : _mm_unpacklo_epi16( col, zero );
+            const __m128i g = _mm_srli_epi32( _mm_add_epi32(
+                _mm_madd_epi16( c, row ), half ), EDGE_BITS );
+            const __m128i w = _mm_or_si128( g, _mm_slli_epi32(
+                _mm_sub_epi32( unit, g ), 16 ) );
+            const __m128i s = _mm_or_si128( fill, k
+                ? _mm_unpackhi_epi16( v, zero )
+                : _mm_unpacklo_epi16( v, zero ) );
+            out[k] = _mm_srli_epi32( _mm_add_epi32(
+                _mm_madd_epi16( s, w ), half ), EDGE_BITS );
+        }
+        _mm_storel_epi64( (__m128i *)&p[x], _mm_packus_epi16(
+            _mm_packs_epi32( out[0], out[1] ), zero ) );
+    }
+#elif defined(__ARM_NEON)
+    const uint16x4_t fill = vdup_n_u16( i_fill );
+    const uint32x4_t unit = vdupq_n_u32( i_unit );
+
+    for( ; x + 8 <= i_count; x += 8 )
+    {
+        const uint16x8_t col = vld1q_u16( &pi_column[x] );
+        const uint16x8_t v = vmovl_u8( vld1_u8( &p[x] ) );
+        uint16x4_t out[2];
+
+        for( int k = 0; k < 2; k++ )
+        {
+            const uint32x4_t g = vrshrq_n_u32( vmull_n_u16(
+                k ? vget_high_u16( col ) : vget_low_u16( col ),
+                i_row_gain ), EDGE_BITS );
+            const uint32x4_t s = vmlal_u16(
+                vmull_u16( k ? vget_high_u16( v ) : vget_low_u16( v ),
+                           vmovn_u32( g ) ),
+                fill, vmovn_u32( vsubq_u32( unit, g ) ) );
+            out[k] = vmovn_u32( vrshrq_n_u32( s, EDGE_BITS ) );
+        }
+        vst1_u8( &p[x], vmovn_u16( vcombine_u16( out[0], out[1] ) ) );
+    }
+#endif
+
+    for( ; x < i_count; x++ )
+    {
+        const unsigned i_gain = ( pi_column[x] * i_row_gain + i_half )
+                                >> EDGE_BITS;
+        p[x] = ( p[x] * i_gain + i_fill * ( i_unit - i_gain ) + i_half )
+               >> EDGE_BITS;
+    }
+}
+
+static void LiftRow8( uint8_t *p, unsigned i_lift, int i_count )
+{
+    int x = 0;
+
+#if defined(__SSE2__)
+    const __m128i lift = _mm_set1_epi8( i_lift );
+    for( ; x + 16 <= i_count; x += 16 )
+        _mm_storeu_si128( (__m128i *)&p[x], _mm_adds_epu8(
+            _mm_loadu_si128( (const __m128i *)&p[x] ), lift ) );
+#elif defined(__ARM_NEON)
+    const uint8x16_t lift = vdupq_n_u8( i_lift );
+    for( ; x + 16 <= i_count; x += 16 )
+        vst1q_u8( &p[x], vqaddq_u8( vld1q_u8( &p[x] ), lift ) );
+#endif
+
+    for( ; x < i_count; x++ )
+    {
+        const unsigned v = p[x] + i_lift;
+        p[x] = v > 255 ? 255 : v;
+    }
+}
+
+/*****************************************************************************
+ * ApplySoftEdge: fade rows [i_y_begin, i_y_end) of a rendered plane over
+ * the soft edges, and raise the black level elsewhere
+ *****************************************************************************/
+static void ApplySoftEdge( const soft_edge_t *p_edge,
+                           const warp_component_t *p_comp, plane_t *p_dst,
+                           int i_y_begin, int i_y_end )
+{
+    const uint16_t *pi_column = p_edge->pi_gains;
+    const uint16_t *pi_row = pi_column + p_edge->i_width;
+    const unsigned i_unit = 1u << EDGE_BITS;
+    const unsigned i_max = ( 1u << p_comp->i_bits ) - 1;
+    const int i_pixel_size = p_comp->i_pixel_size;
+    const unsigned i_lift = p_edge->i_lift;
+    /* Planar 8-bit samples, not alpha */
+    const bool b_bytes = i_pixel_size == 1 && p_edge->pb_scale[0];
+
+    for( int y = i_y_begin; y < i_y_end; y++ )
+    {
+        uint8_t *p_line = &p_dst->p_pixels[y * p_dst->i_pitch];
+
+        /* Rows at full gain only fade their side columns */
+        const unsigned i_row_gain = pi_row[y];
+        int i_left = p_edge->i_width, i_right = p_edge->i_width;
+        if( i_row_gain == i_unit )
+        {
+            i_left  = p_edge->i_left;
+            i_right = p_edge->i_right;
+        }
+
+        if( b_bytes )
+        {
+            /* The sides, or the whole row */
+            const int i_end = i_left < i_right ? i_left : p_edge->i_width;
+            FadeRow8( p_line, pi_column, i_row_gain, p_comp->i_fill, i_end );
+            if( i_end < p_edge->i_width )
+                FadeRow8( &p_line[i_right], &pi_column[i_right], i_row_gain,
+                          p_comp->i_fill, p_edge->i_width - i_right );
+        }
+        else for( int x = 0; x < p_edge->i_width; x++ )
+        {
+            if( x == i_left && i_left < i_right )
+            {
+                x = i_right - 1;
+                continue;
+            }
+
+            const unsigned i_gain = ( pi_column[x] * i_row_gain
+                                    + ( i_unit >> 1 ) ) >> EDGE_BITS;
+            uint8_t *p = &p_line[x * i_pixel_size];
+            for( int c = 0; c < p_comp->i_channels; c++ )
+            {
+                if( !p_edge->pb_scale[c] )
+                    continue;
+                uint8_t *p_sample = &p[p_comp->pi_offset[c]];
+                const unsigned v = GetSample( p_sample, p_comp );
+                PutSample( p_sample, ( v * i_gain
+                                     + p_comp->i_fill * ( i_unit - i_gain )
+                                     + ( i_unit >> 1 ) ) >> EDGE_BITS,
+                           p_comp );
+            }
+        }
+
+        if( !i_lift || i_left >= i_right )
+            continue;
+        if( p_edge->b_lift_all && p_comp->i_sample_size == 1 )
+        {
+            /* Whole bytes */
+            LiftRow8( &p_line[i_left * i_pixel_size], i_lift,
+                      ( i_right - i_left ) * i_pixel_size );
+            continue;
+        }
+        for( int x = i_left; x < i_right; x++ )
+            for( int c = 0; c < p_comp->i_channels; c++ )
+            {
+                if( !p_edge->pb_lift[c] )
+                    continue;
+                uint8_t *p_sample = &p_line[x * i_pixel_size
+                                            + p_comp->pi_offset[c]];
+                const unsigned v = GetSample( p_sample, p_comp ) + i_lift;
+                PutSample( p_sample, __MIN( v, i_max ), p_comp );
+            }
+    }
+}
+
+/*****************************************************************************
+ * RenderBand: render rows [i_y_begin, i_y_end) of component i of the
+ * current picture
+ *****************************************************************************/
+static void RenderBand( filter_sys_t *p_sys, int i, int i_thread,
+                        int i_y_begin, int i_y_end )
+{
+    const warp_component_t *p_comp = &p_sys->components[i];
+    const plane_t *p_src = &p_sys->p_job_src->p[p_comp->i_plane];
+    plane_t *p_dst = &p_sys->p_job_dst->p[p_comp->i_plane];
+    warp_map_t *p_map = &p_sys->maps[i];
+
+    switch( p_sys->pi_mode[i] )
+    {
+        case RENDER_BUILD_MAP:
+            if( p_sys->i_transform == TRANSFORM_MESH )
+                BuildMeshMap( p_map, p_sys->i_cache_width,
+                              p_sys->i_cache_height, p_sys->i_cache_src_width,
+                              p_sys->i_cache_src_height, p_sys->pf_mesh_points,
+                              p_sys->i_mesh_cols, p_sys->i_mesh_rows,
+                              p_sys->i_interp > INTERP_BILINEAR
+                              ? &p_sys->kernel : NULL,
+                              i_y_begin, i_y_end );
+            else if( p_sys->i_interp > INTERP_BILINEAR )
+                BuildKernelMap( p_map, p_sys->i_cache_width,
+                                p_sys->i_cache_height, p_sys->h,
+                                &p_sys->kernel,
+                                i_y_begin, i_y_end );
+            else
+                BuildWarpMap( p_map, p_sys->i_cache_width,
+                              p_sys->i_cache_height, p_sys->h,
+                              i_y_begin, i_y_end );
+            /* fall through */
+        case RENDER_MAP:
+            if( p_sys->b_tiled && p_comp->i_pixel_size == 1 )
+                RenderPlaneMapTiles( p_map, p_src, p_dst, p_comp,
+                                     p_sys->i_interp, &p_sys->kernel,
+                                     i_y_begin, i_y_end );
+            else
+                RenderMapRect( p_map, p_src, p_dst, p_comp,
+                               p_sys->i_interp, &p_sys->kernel,
+                               0, p_map->i_dst_width, i_y_begin, i_y_end );
+            break;
+        case RENDER_TRANSLATE:
+        {
+            int i_dx, i_dy;
+            GetPlaneShift( p_sys->h, p_sys->i_cache_width,
+                           p_sys->i_cache_height, p_dst, p_comp,
+                           &i_dx, &i_dy );
+            RenderPlaneTranslate( p_src, p_dst, i_dx, i_dy, p_comp,
+                                  i_y_begin, i_y_end );
+            break;
+        }
+        case RENDER_ROWS:
+            RenderPlaneRows( p_src, p_dst,
+                             p_sys->i_cache_width, p_sys->i_cache_height,
+                             p_sys->h, p_comp,
+                             &p_sys->p_columns[i_thread * p_sys->i_columns],
+                             i_y_begin, i_y_end );
+            break;
+        case RENDER_FAST:
+            RenderPlaneFast( &p_sys->grids[i], p_src, p_dst,
+                             p_sys->i_cache_width, p_sys->i_cache_height,
+                             p_sys->h, p_comp, i_y_begin, i_y_end );
+            break;
+        case RENDER_KERNEL:
+            RenderPlaneKernel( p_src, p_dst,
+                               p_sys->i_cache_width, p_sys->i_cache_height,
+                               p_sys->h, p_comp, &p_sys->kernel,
+                               i_y_begin, i_y_end );
+            break;
+        default:
+            RenderPlane( p_src, p_dst,
+                         p_sys->i_cache_width, p_sys->i_cache_height,
+                         p_sys->h, p_comp, i_y_begin, i_y_end );
+            break;
+    }
+}
+
+/*****************************************************************************
+ * RunJob: render one band of the current picture
+ *****************************************************************************
+ * With soft edges, the band is rendered a few rows at a time, faded while
+ * they are still in the cache: the output only goes to memory once.
+ *****************************************************************************/
+static void RunJob( filter_sys_t *p_sys, const render_job_t *p_job,
+                    int i_thread )
+{
+    const int i = p_job->i_component;
+    const soft_edge_t *p_edge = &p_sys->edges[i];
+
+    if( !p_edge->pi_gains )
+    {
+        RenderBand( p_sys, i, i_thread, p_job->i_y_begin, p_job->i_y_end );
+        return;
+    }
+
+    const warp_component_t *p_comp = &p_sys->components[i];
+    plane_t *p_dst = &p_sys->p_job_dst->p[p_comp->i_plane];
+    const int i_lines = __MAX( EDGE_CHUNK / p_dst->i_pitch, 1 );
+    for( int y = p_job->i_y_begin, y_end; y < p_job->i_y_end; y = y_end )
+    {
+        y_end = __MIN( y + i_lines, p_job->i_y_end );
+        RenderBand( p_sys, i, i_thread, y, y_end );
+        ApplySoftEdge( p_edge, p_comp, p_dst, y, y_end );
+    }
+}
+
+/*****************************************************************************
+ * WorkLocked: run queued jobs until none is left (pool_lock held)
+ *****************************************************************************/
+static void WorkLocked( filter_sys_t *p_sys, int i_thread )
+{
+    while( p_sys->i_next_job < p_sys->i_jobs )
+    {
+        render_job_t *p_job = &p_sys->jobs[p_sys->i_next_job++];
+
+        vlc_mutex_unlock( &p_sys->pool_lock );
+        if( p_sys->p_stats )
+        {
+            p_job->i_start = mdate();
+            RunJob( p_sys, p_job, i_thread );
+            p_job->i_end = mdate();
+            p_job->i_thread = i_thread;
+        }
+        else
+            RunJob( p_sys, p_job, i_thread );
+        vlc_mutex_lock( &p_sys->pool_lock );
+
+        if( ++p_sys->i_jobs_done == p_sys->i_jobs )
+            vlc_cond_signal( &p_sys->pool_done );
+    }
+}
+
+/*****************************************************************************
+ * Worker: rendering thread of the pool
+ *****************************************************************************/
+static void *Worker( void *p_data )
+{
+    filter_sys_t *p_sys = p_data;
+    unsigned i_generation = 0;
+
+    vlc_mutex_lock( &p_sys->pool_lock );
+    const int i_thread = ++p_sys->i_worker_ids;
+    while( !p_sys->b_exit )
+    {
+        if( p_sys->i_generation == i_generation )
+        {
+            vlc_cond_wait( &p_sys->pool_work, &p_sys->pool_lock );
+            continue;
+        }
+        i_generation = p_sys->i_generation;
+        WorkLocked( p_sys, i_thread );
+    }
+    vlc_mutex_unlock( &p_sys->pool_lock );
+
+    return NULL;
+}
+
+/*****************************************************************************
+ * StartWorkers/StopWorkers: manage the rendering thread pool
+ *****************************************************************************/
+static void StartWorkers( filter_t *p_filter, int i_threads )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    vlc_mutex_init( &p_sys->pool_lock );
+    vlc_cond_init( &p_sys->pool_work );
+    vlc_cond_init( &p_sys->pool_done );
+    p_sys->i_generation = 0;
+    p_sys->b_exit = false;
+    p_sys->i_jobs = p_sys->i_next_job = p_sys->i_jobs_done = 0;
+
+    p_sys->p_columns = NULL;
+    p_sys->i_columns = 0;
+    p_sys->i_workers = p_sys->i_worker_ids = 0;
+    for( int i = 0; i < i_threads - 1; i++ )
+    {
+        if( vlc_clone( &p_sys->workers[i], Worker, p_sys,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+        {
+            msg_Warn( p_filter, "cannot start rendering thread %d", i + 1 );
+            break;
+        }
+        p_sys->i_workers++;
+    }
+
+    /* A few bands per thread balance planes of uneven cost */
+    p_sys->i_bands = p_sys->i_workers > 0 ? 2 * ( p_sys->i_workers + 1 ) : 1;
+
+    msg_Dbg( p_filter, "rendering with %d thread(s)", p_sys->i_workers + 1 );
+}
+
+static void StopWorkers( filter_sys_t *p_sys )
+{
+    vlc_mutex_lock( &p_sys->pool_lock );
+    p_sys->b_exit = true;
+    vlc_cond_broadcast( &p_sys->pool_work );
+    vlc_mutex_unlock( &p_sys->pool_lock );
+
+    for( int i = 0; i < p_sys->i_workers; i++ )
+        vlc_join( p_sys->workers[i], NULL );
+
+    vlc_cond_destroy( &p_sys->pool_done );
+    vlc_cond_destroy( &p_sys->pool_work );
+    vlc_mutex_destroy( &p_sys->pool_lock );
+    free( p_sys->p_columns );
+}
+
+/*****************************************************************************
+ * RenderPicture: warp all the components, split in bands over the pool
+ *****************************************************************************/
+static void RenderPicture( filter_sys_t *p_sys, const picture_t *p_src,
+                           picture_t *p_dst )
+{
+    int i_jobs = 0;
+
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        const warp_component_t *p_comp = &p_sys->components[i];
+        const int i_plane = p_comp->i_plane;
+        const plane_t *p_src_plane = &p_src->p[i_plane];
+        const plane_t *p_dst_plane = &p_dst->p[i_plane];
+        warp_map_t *p_map = &p_sys->maps[i];
+        warp_grid_t *p_grid = &p_sys->grids[i];
+
+        /* Dedicated renderers for the simpler transforms, then the maps,
+         * (re)allocated here so the bands only fill rows. Whole pixel
+         * shifts are copies whatever the kernel, the other specialized
+         * renderers are bilinear. A mesh is only rendered from maps, or
+         * as the keystone of its corners without memory for them.
+         * Only the rows of bytes beat the maps: the other samples use the
+         * rows, or the grid in fast quality, just while the corners move,
+         * and build the maps once they stay. */
+        const bool b_bilinear = p_sys->i_interp == INTERP_BILINEAR;
+        const bool b_bytes = p_comp->i_sample_size == 1
+                          && p_comp->i_pixel_size == 1;
+        const bool b_rows = p_sys->i_transform <= TRANSFORM_ROWS && b_bilinear
+              && (size_t)( p_src_plane->i_visible_pitch / p_comp->i_pixel_size
+                           + 2 ) * p_comp->i_channels <= p_sys->i_columns;
+        const bool b_grid = p_sys->b_fast && b_bilinear
+                         && p_sys->i_transform != TRANSFORM_MESH;
+        int i_dx, i_dy;
+        if( p_sys->i_transform == TRANSFORM_TRANSLATE && IsDense( p_comp )
+         && GetPlaneShift( p_sys->h, p_sys->i_cache_width,
+                           p_sys->i_cache_height, p_dst_plane, p_comp,
+                           &i_dx, &i_dy ) )
+            p_sys->pi_mode[i] = RENDER_TRANSLATE;
+        else if( b_rows && b_bytes )
+            p_sys->pi_mode[i] = RENDER_ROWS;
+        else if( WarpMapMatches( p_map, p_src_plane, p_dst_plane, p_comp ) )
+            p_sys->pi_mode[i] = RENDER_MAP;
+        else if( b_rows && p_sys->b_cache_new )
+            p_sys->pi_mode[i] = RENDER_ROWS;
+        else if( b_grid && p_sys->b_cache_new )
+            p_sys->pi_mode[i] =
+                WarpGridMatches( p_grid, p_src_plane, p_dst_plane, p_comp )
+             || BuildWarpGrid( p_grid, p_src_plane, p_dst_plane,
+                               p_sys->i_cache_width, p_sys->i_cache_height,
+                               p_sys->h, p_sys->f_tolerance, p_comp )
+                ? RENDER_FAST : RENDER_DIRECT;
+        else if( PrepareWarpMap( p_map, p_src_plane, p_dst_plane, p_comp ) )
+            p_sys->pi_mode[i] = RENDER_BUILD_MAP;
+        else if( b_rows )                       /* Out of memory */
+            p_sys->pi_mode[i] = RENDER_ROWS;
+        else if( b_grid
+              && WarpGridMatches( p_grid, p_src_plane, p_dst_plane, p_comp ) )
+            p_sys->pi_mode[i] = RENDER_FAST;
+        else
+            p_sys->pi_mode[i] = b_bilinear ? RENDER_DIRECT : RENDER_KERNEL;
+
+        /* Without memory for them, the edges are left sharp */
+        if( p_sys->b_soft_edge )
+            PrepareSoftEdge( &p_sys->edges[i], p_sys, p_comp, p_dst_plane );
+
+        const int i_lines = p_dst_plane->i_visible_lines;
+        int i_bands = __MIN( p_sys->i_bands,
+                             ( i_lines + BAND_MIN_LINES - 1 ) / BAND_MIN_LINES );
+        if( i_bands < 1 )
+            i_bands = 1;
+
+        for( int b = 0; b < i_bands; b++ )
+        {
+            render_job_t *p_job = &p_sys->jobs[i_jobs++];
+            p_job->i_component = i;
+            p_job->i_y_begin   = i_lines * b / i_bands;
+            p_job->i_y_end     = i_lines * ( b + 1 ) / i_bands;
+        }
+    }
+
+    vlc_mutex_lock( &p_sys->pool_lock );
+    p_sys->p_job_src   = p_src;
+    p_sys->p_job_dst   = p_dst;
+    p_sys->i_jobs      = i_jobs;
+    p_sys->i_next_job  = 0;
+    p_sys->i_jobs_done = 0;
+    p_sys->i_generation++;
+    if( p_sys->i_workers > 0 )
+        vlc_cond_broadcast( &p_sys->pool_work );
+
+    WorkLocked( p_sys, 0 );
+    while( p_sys->i_jobs_done < p_sys->i_jobs )
+        vlc_cond_wait( &p_sys->pool_done, &p_sys->pool_lock );
+    vlc_mutex_unlock( &p_sys->pool_lock );
+}
+
+/*****************************************************************************
+ * GetCornerPixelPos: compute the pixel position of a corner on the output
+ *****************************************************************************/
+static void GetCornerPixelPos( int i_corner, int i_width, int i_height,
+                               float f_tl_x, float f_tl_y,
+                               float f_tr_x, float f_tr_y,
+                               float f_bl_x, float f_bl_y,
+                               float f_br_x, float f_br_y,
+                               int *pi_x, int *pi_y )
+{
+    switch( i_corner )
+    {
+        case 0: /* TL */
+            *pi_x = (int)( f_tl_x * i_width );
+            *pi_y = (int)( f_tl_y * i_height );
+            break;
+        case 1: /* TR */
+            *pi_x = ( i_width - 1 ) + (int)( f_tr_x * i_width );
+            *pi_y = (int)( f_tr_y * i_height );
+            break;
+        case 2: /* BL */
+            *pi_x = (int)( f_bl_x * i_width );
+            *pi_y = ( i_height - 1 ) + (int)( f_bl_y * i_height );
+            break;
+        case 3: /* BR */
+            *pi_x = ( i_width - 1 ) + (int)( f_br_x * i_width );
+            *pi_y = ( i_height - 1 ) + (int)( f_br_y * i_height );
+            break;
+        default:
+            *pi_x = 0;
+            *pi_y = 0;
+            break;
+    }
+}
+
+/*****************************************************************************
+ * GetHandles: pixel positions of the handles on the output
+ *****************************************************************************
+ * The corners, then with a mesh all of its points, those of the corners
+ * included (at the corners). Returns the number of handles.
+ *****************************************************************************/
+static int GetHandles( const filter_sys_t *p_sys, const float pf_corners[8],
+                       const float *pf_mesh, int i_width, int i_height,
+                       int pi_x[MAX_HANDLES], int pi_y[MAX_HANDLES] )
+{
+    for( int c = 0; c < 4; c++ )
+        GetCornerPixelPos( c, i_width, i_height,
+                           pf_corners[0], pf_corners[1],
+                           pf_corners[2], pf_corners[3],
+                           pf_corners[4], pf_corners[5],
+                           pf_corners[6], pf_corners[7],
+                           &pi_x[c], &pi_y[c] );
+
+    const int i_points = p_sys->i_mesh_cols * p_sys->i_mesh_rows;
+    double pf_points[2 * MESH_POINTS];
+    if( !i_points
+     || !GetMeshPoints( pf_points, p_sys->i_mesh_cols, p_sys->i_mesh_rows,
+                        pf_corners, pf_mesh, i_width, i_height ) )
+        return 4;
+
+    for( int k = 0; k < i_points; k++ )
+    {
+        /* Bounds the conversions */
+        pi_x[4 + k] = VLC_CLIP( pf_points[2 * k], -2 * i_width, 3 * i_width );
+        pi_y[4 + k] = VLC_CLIP( pf_points[2 * k + 1],
+                                -2 * i_height, 3 * i_height );
+    }
+    for( int c = 0; c < 4; c++ )
+    {
+        const int k = GetMeshCorner( p_sys->i_mesh_cols, p_sys->i_mesh_rows,
+                                     c );
+        pi_x[4 + k] = pi_x[c];
+        pi_y[4 + k] = pi_y[c];
+    }
+    return 4 + i_points;
+}
+
+/*****************************************************************************
+ * DrawOverlayLine: draw a 2 pixel wide segment on a palettized picture
+ *****************************************************************************/
+static void DrawOverlayLine( plane_t *p, int i_width, int i_height,
+                             int x0, int y0, int x1, int y1, uint8_t i_index )
+{
+    const int dx = abs( x1 - x0 ), sx = x0 < x1 ? 1 : -1;
+    const int dy = -abs( y1 - y0 ), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+
+    for( ;; )
+    {
+        for( int y = __MAX( y0, 0 ); y < __MIN( y0 + 2, i_height ); y++ )
+            for( int x = __MAX( x0, 0 ); x < __MIN( x0 + 2, i_width ); x++ )
+                p->p_pixels[y * p->i_pitch + x] = i_index;
+
+        if( x0 == x1 && y0 == y1 )
+            break;
+        const int e2 = 2 * err;
+        if( e2 >= dy ) { err += dy; x0 += sx; }
+        if( e2 <= dx ) { err += dx; y0 += sy; }
+    }
+}
+
+/*****************************************************************************
+ * UpdateOverlay: show the handle and the outline, if they changed
+ *****************************************************************************
+ * They are drawn by the video output over the filtered pictures, from a
+ * palettized region covering them: the pictures themselves are never
+ * painted, and the overlay follows the mouse without any warp.
+ *****************************************************************************/
+static void UpdateOverlay( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    if( !p_sys->p_vout )
+        return;
+
+    const int i_width  = p_filter->fmt_out.video.i_visible_width;
+    const int i_height = p_filter->fmt_out.video.i_visible_height;
+    float pf_corners[8], pf_mesh[2 * MESH_POINTS];
+    const unsigned i_seq = LoadCorners( p_sys, pf_corners, pf_mesh );
+    int pi_x[MAX_HANDLES], pi_y[MAX_HANDLES];
+    const int i_handles = GetHandles( p_sys, pf_corners, pf_mesh,
+                                      i_width, i_height, pi_x, pi_y );
+
+    /* Handle for the hovered or dragged point only, drag taking priority */
+    int i_show = -1;
+    bool b_active = false;
+    if( atomic_load( &p_sys->b_show_handles ) )
+    {
+        int drag  = atomic_load( &p_sys->i_drag_corner );
+        int hover = atomic_load( &p_sys->i_hover_corner );
+
+        i_show = ( drag >= 0 ) ? drag : hover;
+        b_active = drag >= 0;
+        if( i_show >= i_handles )
+            i_show = -1;
+    }
+
+    const bool b_visible = ( i_show >= 0 || p_sys->b_show_outline )
+                        && i_width > 0 && i_height > 0;
+    if( b_visible == p_sys->b_overlay
+     && ( !b_visible
+       || ( i_show == p_sys->i_overlay_corner
+         && b_active == p_sys->b_overlay_active
+         && i_width == p_sys->i_overlay_width
+         && i_height == p_sys->i_overlay_height
+         && i_seq == p_sys->i_overlay_seq ) ) )
+        return;
+
+    /* The channel only holds the current overlay */
+    vout_FlushSubpictureChannel( p_sys->p_vout, p_sys->i_spu_channel );
+    p_sys->b_overlay = false;
+    if( !b_visible )
+        return;
+
+    /* Area covered, within the picture */
+    int x0 = i_width, y0 = i_height, x1 = 0, y1 = 0;
+    int hx = 0, hy = 0;
+    if( p_sys->b_show_outline )
+        for( int c = 0; c < i_handles; c++ )
+        {
+            x0 = __MIN( x0, pi_x[c] );     y0 = __MIN( y0, pi_y[c] );
+            x1 = __MAX( x1, pi_x[c] + 2 ); y1 = __MAX( y1, pi_y[c] + 2 );
+        }
+    if( i_show >= 0 )
+    {
+        /* Clamp to visible area */
+        hx = VLC_CLIP( pi_x[i_show], 0, i_width - 1 );
+        hy = VLC_CLIP( pi_y[i_show], 0, i_height - 1 );
+        x0 = __MIN( x0, hx - HANDLE_SIZE ); y0 = __MIN( y0, hy - HANDLE_SIZE );
+        x1 = __MAX( x1, hx + HANDLE_SIZE ); y1 = __MAX( y1, hy + HANDLE_SIZE );
+    }
+    x0 = __MAX( x0, 0 ); x1 = __MIN( x1, i_width );
+    y0 = __MAX( y0, 0 ); y1 = __MIN( y1, i_height );
+    if( x0 >= x1 || y0 >= y1 )
+        return;
+
+    video_palette_t palette = {
+        .i_entries = 4,
+        .palette = {
+            { 0, 128, 128, 0x00 },                      /* Transparent */
+            { HANDLE_Y, HANDLE_U, HANDLE_V, 0xff },     /* Outline */
+            { HOVER_Y, HOVER_U, HOVER_V, 0xff },
+            { ACTIVE_Y, ACTIVE_U, ACTIVE_V, 0xff },
+        },
+    };
+    video_format_t fmt;
+    video_format_Init( &fmt, VLC_CODEC_YUVP );
+    fmt.i_width  = fmt.i_visible_width  = x1 - x0;
+    fmt.i_height = fmt.i_visible_height = y1 - y0;
+    fmt.i_sar_num = fmt.i_sar_den = 1;
+    fmt.p_palette = &palette;
+
+    subpicture_t *p_spu = subpicture_New( NULL );
+    subpicture_region_t *p_region = subpicture_region_New( &fmt );
+    if( !p_spu || !p_region )
+    {
+        if( p_region )
+            subpicture_region_Delete( p_region );
+        if( p_spu )
+            subpicture_Delete( p_spu );
+        return;
+    }
+
+    plane_t *p = &p_region->p_picture->p[0];
+    for( int y = 0; y < y1 - y0; y++ )
+        memset( &p->p_pixels[y * p->i_pitch], 0, x1 - x0 );
+    if( p_sys->b_show_outline && i_handles > 4 )
+    {
+        /* Every edge of the cells of the mesh */
+        const int i_cols = p_sys->i_mesh_cols, i_rows = p_sys->i_mesh_rows;
+        for( int k = 0; k < i_cols * i_rows; k++ )
+        {
+            const int a = 4 + k;
+            if( k % i_cols < i_cols - 1 )
+                DrawOverlayLine( p, x1 - x0, y1 - y0,
+                                 pi_x[a] - x0, pi_y[a] - y0,
+                                 pi_x[a + 1] - x0, pi_y[a + 1] - y0, 1 );
+            if( k / i_cols < i_rows - 1 )
+                DrawOverlayLine( p, x1 - x0, y1 - y0,
+                                 pi_x[a] - x0, pi_y[a] - y0,
+                                 pi_x[a + i_cols] - x0,
+                                 pi_y[a + i_cols] - y0, 1 );
+        }
+    }
+    else if( p_sys->b_show_outline )
+    {
+        static const int pi_edges[4][2] = { { 0, 1 }, { 1, 3 },
+                                            { 3, 2 }, { 2, 0 } };
+        for( int e = 0; e < 4; e++ )
+        {
+            const int a = pi_edges[e][0], b = pi_edges[e][1];
+            DrawOverlayLine( p, x1 - x0, y1 - y0,
+                             pi_x[a] - x0, pi_y[a] - y0,
+                             pi_x[b] - x0, pi_y[b] - y0, 1 );
+        }
+    }
+    if( i_show >= 0 )
+    {
+        const int i_left  = __MAX( hx - HANDLE_SIZE, x0 );
+        const int i_right = __MIN( hx + HANDLE_SIZE, x1 );
+        for( int y = __MAX( hy - HANDLE_SIZE, y0 );
+             y < __MIN( hy + HANDLE_SIZE, y1 ); y++ )
+            memset( &p->p_pixels[( y - y0 ) * p->i_pitch + i_left - x0],
+                    b_active ? 3 : 2, i_right - i_left );
+    }
+
+    p_region->i_x = x0;
+    p_region->i_y = y0;
+    p_region->i_align = SUBPICTURE_ALIGN_TOP | SUBPICTURE_ALIGN_LEFT;
+
+    /* Shown over every picture until flushed, in picture coordinates */
+    p_spu->p_region = p_region;
+    p_spu->i_channel = p_sys->i_spu_channel;
+    p_spu->i_start = VLC_TS_0;
+    p_spu->i_stop = 0;
+    p_spu->b_ephemer = true;
+    p_spu->b_absolute = true;
+    p_spu->b_subtitle = false;
+    p_spu->i_original_picture_width  = i_width;
+    p_spu->i_original_picture_height = i_height;
+
+    vout_PutSubpicture( p_sys->p_vout, p_spu );
+
+    p_sys->b_overlay = true;
+    p_sys->i_overlay_corner = i_show;
+    p_sys->b_overlay_active = b_active;
+    p_sys->i_overlay_width  = i_width;
+    p_sys->i_overlay_height = i_height;
+    p_sys->i_overlay_seq    = i_seq;
+}
+
+/*****************************************************************************
+ * SetupComponents: describe the planes to warp for an accepted chroma
+ *****************************************************************************/
+static void SetupComponents( filter_sys_t *p_sys, const video_format_t *p_fmt )
+{
+    const vlc_fourcc_t i_chroma = p_fmt->i_chroma;
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( i_chroma );
+    bool b_big_endian;
+
+    switch( i_chroma )
+    {
+        case VLC_CODEC_I420_10B:
+        case VLC_CODEC_I444_10B:
+        case VLC_CODEC_I420_9B:
+        case VLC_CODEC_I444_9B:
+            b_big_endian = true;
+            break;
+        default:
+            b_big_endian = false;
+            break;
+    }
+
+    video_format_t fmt = *p_fmt;
+    int i_r_index, i_g_index, i_b_index;
+    video_format_FixRgb( &fmt );
+    p_sys->b_rgb = GetPackedRgbIndexes( &fmt, &i_r_index, &i_g_index,
+                                        &i_b_index ) == VLC_SUCCESS;
+    if( i_chroma == VLC_CODEC_RGBA )
+    {
+        p_sys->b_rgb = true;
+        i_r_index = 0;
+        i_g_index = 1;
+        i_b_index = 2;
+    }
+
+    int i_y_offset, i_u_offset, i_v_offset;
+    if( p_sys->b_rgb )
+    {
+        /* Packed RGB: all the samples of a pixel in one component, the
+         * padding byte of RGB32 included. Zero is opaque black, and
+         * transparent for RGBA. */
+        warp_component_t *p_comp = &p_sys->components[0];
+
+        p_sys->i_components = 1;
+        *p_comp = (warp_component_t) {
+            .i_plane = 0, .i_channels = p_dsc->pixel_size,
+            .i_pixel_size = p_dsc->pixel_size,
+            .i_sample_size = 1, .i_bits = 8, .i_fill = 0,
+        };
+        for( int c = 0; c < p_comp->i_channels; c++ )
+        {
+            p_comp->pi_offset[c] = c;
+            p_comp->pi_channel[c] = c == i_r_index ? RGB_R
+                                  : c == i_g_index ? RGB_G
+                                  : c == i_b_index ? RGB_B : RGB_A;
+        }
+    }
+    else if( GetPackedYuvOffsets( i_chroma, &i_y_offset, &i_u_offset,
+                                  &i_v_offset ) == VLC_SUCCESS )
+    {
+        /* Packed 4:2:2: luma per pixel, chroma per macropixel, both in the
+         * single plane */
+        warp_component_t *p_luma = &p_sys->components[0];
+        warp_component_t *p_chroma = &p_sys->components[1];
+
+        p_sys->i_components = 2;
+        *p_luma = (warp_component_t) {
+            .i_plane = 0, .i_channels = 1, .i_pixel_size = 2,
+            .pi_channel = { Y_PLANE }, .pi_offset = { i_y_offset },
+            .i_sample_size = 1, .i_bits = 8, .i_fill = 0,
+        };
+        *p_chroma = (warp_component_t) {
+            .i_plane = 0, .i_channels = 2, .i_pixel_size = 4,
+            .pi_channel = { U_PLANE, V_PLANE },
+            .pi_offset = { i_u_offset, i_v_offset },
+            .i_sample_size = 1, .i_bits = 8, .i_fill = 0x80,
+        };
+    }
+    else
+    {
+        p_sys->i_components = p_dsc->plane_count;
+        for( int i = 0; i < p_sys->i_components; i++ )
+        {
+            warp_component_t *p_comp = &p_sys->components[i];
+
+            p_comp->i_plane       = i;
+            p_comp->i_channels    = 1;
+            p_comp->pi_channel[0] = i;
+            p_comp->i_sample_size = p_dsc->pixel_size;
+            p_comp->i_bits        = p_dsc->pixel_bits;
+            p_comp->b_big_endian  = b_big_endian;
+            /* Black, neutral chroma, and transparent alpha */
+            p_comp->i_fill = ( i == U_PLANE || i == V_PLANE )
+                           ? 1u << ( p_comp->i_bits - 1 ) : 0;
+        }
+
+        /* Semi-planar: interleaved CbCr samples share the taps of their
+         * pixel */
+        if( i_chroma == VLC_CODEC_NV12 || i_chroma == VLC_CODEC_NV21 )
+        {
+            warp_component_t *p_comp = &p_sys->components[1];
+
+            p_comp->i_channels = 2;
+            p_comp->pi_channel[0] = i_chroma == VLC_CODEC_NV12 ? U_PLANE
+                                                               : V_PLANE;
+            p_comp->pi_channel[1] = i_chroma == VLC_CODEC_NV12 ? V_PLANE
+                                                               : U_PLANE;
+            p_comp->i_fill = 1u << ( p_comp->i_bits - 1 );
+        }
+
+        for( int i = 0; i < p_sys->i_components; i++ )
+        {
+            warp_component_t *p_comp = &p_sys->components[i];
+
+            p_comp->i_pixel_size = p_comp->i_channels * p_comp->i_sample_size;
+            for( int c = 0; c < p_comp->i_channels; c++ )
+                p_comp->pi_offset[c] = c * p_comp->i_sample_size;
+        }
+    }
+
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        warp_component_t *p_comp = &p_sys->components[i];
+
+        p_comp->pf_blend_interior = GetBlendInterior( p_comp, p_sys->i_isa );
+    }
+}
+
+/*****************************************************************************
+ * OpenStats: set up the timing statistics and the trace, if enabled
+ *****************************************************************************
+ * The statistics are variables of the filter object, refreshed every
+ * STATS_PERIOD pictures: keystone-stats-frames and -passthrough count the
+ * warped and the untouched pictures, keystone-stats-<stage>-mean, -p95
+ * and -max give the times of each stage over the last STATS_WINDOW warped
+ * pictures, in ms. Only the filter sets them: VLC has no read-only
+ * variables, another value would just be overwritten.
+ *****************************************************************************/
+static void OpenStats( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    p_sys->p_stats = NULL;
+    const bool b_stats = var_CreateGetBoolCommand( p_filter,
+                                                   FILTER_PREFIX "stats" );
+    char *psz_trace = var_CreateGetStringCommand( p_filter,
+                                                  FILTER_PREFIX "trace-file" );
+    if( !b_stats && ( !psz_trace || !*psz_trace ) )
+    {
+        free( psz_trace );
+        return;
+    }
+
+    filter_stats_t *p_stats = calloc( 1, sizeof( *p_stats ) );
+    if( !p_stats )
+    {
+        free( psz_trace );
+        return;
+    }
+    p_stats->i_stages = STAGE_PLANE + p_sys->i_components;
+
+    var_Create( p_filter, FILTER_PREFIX "stats-frames", VLC_VAR_INTEGER );
+    var_Create( p_filter, FILTER_PREFIX "stats-passthrough", VLC_VAR_INTEGER );
+    for( int i = 0; i < p_stats->i_stages; i++ )
+        for( size_t j = 0; j < ARRAY_SIZE( ppsz_stat_names ); j++ )
+        {
+            char psz_name[64];
+            snprintf( psz_name, sizeof( psz_name ), FILTER_PREFIX "stats-%s-%s",
+                      ppsz_stage_names[i], ppsz_stat_names[j] );
+            var_Create( p_filter, psz_name, VLC_VAR_FLOAT );
+        }
+
+    /* JSON array format: the closing bracket is optional, the trace stays
+     * readable if VLC does not exit cleanly */
+    if( psz_trace && *psz_trace )
+    {
+        p_stats->p_trace = vlc_fopen( psz_trace, "wt" );
+        if( p_stats->p_trace )
+        {
+            p_stats->i_trace_origin = mdate();
+            fprintf( p_stats->p_trace,
+                     "[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                     "\"args\":{\"name\":\"keystone\"}},\n"
+                     "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                     "\"tid\":0,\"args\":{\"name\":\"video\"}}" );
+            for( int i = 1; i <= p_sys->i_workers; i++ )
+                fprintf( p_stats->p_trace,
+                         ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                         "\"tid\":%d,\"args\":{\"name\":\"render %d\"}}", i, i );
+            msg_Dbg( p_filter, "tracing to %s", psz_trace );
+        }
+        else
+            msg_Err( p_filter, "cannot create trace file %s: %m", psz_trace );
+    }
+    free( psz_trace );
+
+    p_sys->p_stats = p_stats;
+}
+
+static void CloseStats( filter_sys_t *p_sys )
+{
+    filter_stats_t *p_stats = p_sys->p_stats;
+    if( !p_stats )
+        return;
+
+    if( p_stats->p_trace )
+    {
+        fputs( "\n]\n", p_stats->p_trace );
+        fclose( p_stats->p_trace );
+    }
+    free( p_stats );
+}
+
+/*****************************************************************************
+ * PublishStats: set the statistics variables
+ *****************************************************************************/
+static int CompareFloat( const void *p_a, const void *p_b )
+{
+    const float f_a = *(const float *)p_a, f_b = *(const float *)p_b;
+    return ( f_a > f_b ) - ( f_a < f_b );
+}
+
+static void PublishStats( filter_t *p_filter, filter_stats_t *p_stats )
+{
+    var_SetInteger( p_filter, FILTER_PREFIX "stats-frames", p_stats->i_frames );
+    var_SetInteger( p_filter, FILTER_PREFIX "stats-passthrough",
+                    p_stats->i_passthrough );
+    if( p_stats->p_trace )
+        fflush( p_stats->p_trace );
+
+    /* The window is filled from its start */
+    const int i_count = p_stats->i_window_count;
+    if( i_count == 0 )
+        return;
+
+    for( int i = 0; i < p_stats->i_stages; i++ )
+    {
+        float pf_sorted[STATS_WINDOW];
+        memcpy( pf_sorted, p_stats->pf_window[i], i_count * sizeof( float ) );
+        qsort( pf_sorted, i_count, sizeof( float ), CompareFloat );
+
+        double f_sum = 0.;
+        for( int k = 0; k < i_count; k++ )
+            f_sum += pf_sorted[k];
+
+        const float pf_values[] = {
+            f_sum / i_count,
+            pf_sorted[( 95 * i_count + 99 ) / 100 - 1],    /* Nearest rank */
+            pf_sorted[i_count - 1],
+        };
+        for( size_t j = 0; j < ARRAY_SIZE( ppsz_stat_names ); j++ )
+        {
+            char psz_name[64];
+            snprintf( psz_name, sizeof( psz_name ), FILTER_PREFIX "stats-%s-%s",
+                      ppsz_stage_names[i], ppsz_stat_names[j] );
+            var_SetFloat( p_filter, psz_name, pf_values[j] );
+        }
+    }
+}
+
+/*****************************************************************************
+ * TraceSpan: write a complete event to the trace
+ *****************************************************************************/
+static void TraceSpan( filter_stats_t *p_stats, const char *psz_name,
+                       int i_thread, mtime_t i_start, mtime_t i_end,
+                       const char *psz_args )
+{
+    fprintf( p_stats->p_trace,
+             ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+             "\"ts\":%"PRId64",\"dur\":%"PRId64"%s%s%s}",
+             psz_name, i_thread, i_start - p_stats->i_trace_origin,
+             i_end - i_start, psz_args ? ",\"args\":{" : "",
+             psz_args ? psz_args : "", psz_args ? "}" : "" );
+}
+
+/*****************************************************************************
+ * RecordStats: account for a picture, from the instants of its stages
+ *****************************************************************************
+ * A picture passed through only has MARK_BEGIN to MARK_HOMOGRAPHY. The
+ * bands of a warped one are read from the jobs, still in place.
+ *****************************************************************************/
+static void RecordStats( filter_t *p_filter, const mtime_t pi_marks[MARK_COUNT],
+                         bool b_warped )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    filter_stats_t *p_stats = p_sys->p_stats;
+    char psz_args[64];
+
+    if( b_warped )
+    {
+        mtime_t pi_time[STAGE_COUNT] = { 0 };
+        pi_time[STAGE_TOTAL] = pi_marks[MARK_END] - pi_marks[MARK_BEGIN];
+        pi_time[STAGE_OVERLAY] = pi_marks[MARK_OVERLAY] - pi_marks[MARK_BEGIN];
+        pi_time[STAGE_HOMOGRAPHY] = pi_marks[MARK_HOMOGRAPHY]
+                                  - pi_marks[MARK_OVERLAY];
+        pi_time[STAGE_RENDER] = pi_marks[MARK_RENDER] - pi_marks[MARK_PICTURE];
+        pi_time[STAGE_COPY] = pi_marks[MARK_PICTURE] - pi_marks[MARK_HOMOGRAPHY]
+                            + pi_marks[MARK_END] - pi_marks[MARK_RENDER];
+        for( int i = 0; i < p_sys->i_jobs; i++ )
+        {
+            const render_job_t *p_job = &p_sys->jobs[i];
+            pi_time[STAGE_PLANE + p_job->i_component] += p_job->i_end
+                                                       - p_job->i_start;
+        }
+
+        for( int i = 0; i < p_stats->i_stages; i++ )
+            p_stats->pf_window[i][p_stats->i_window_pos] = pi_time[i] / 1000.f;
+        p_stats->i_window_pos = ( p_stats->i_window_pos + 1 ) % STATS_WINDOW;
+        if( p_stats->i_window_count < STATS_WINDOW )
+            p_stats->i_window_count++;
+        p_stats->i_frames++;
+    }
+    else
+        p_stats->i_passthrough++;
+
+    if( p_stats->p_trace )
+    {
+        snprintf( psz_args, sizeof( psz_args ), "\"frame\":%"PRIu64,
+                  p_stats->i_frames + p_stats->i_passthrough );
+        TraceSpan( p_stats, b_warped ? "frame" : "passthrough", 0,
+                   pi_marks[MARK_BEGIN],
+                   pi_marks[b_warped ? MARK_END : MARK_HOMOGRAPHY], psz_args );
+        TraceSpan( p_stats, "overlay", 0, pi_marks[MARK_BEGIN],
+                   pi_marks[MARK_OVERLAY], NULL );
+        TraceSpan( p_stats, "homography", 0, pi_marks[MARK_OVERLAY],
+                   pi_marks[MARK_HOMOGRAPHY], NULL );
+        if( b_warped )
+        {
+            TraceSpan( p_stats, "copy", 0, pi_marks[MARK_HOMOGRAPHY],
+                       pi_marks[MARK_PICTURE], NULL );
+            TraceSpan( p_stats, "render", 0, pi_marks[MARK_PICTURE],
+                       pi_marks[MARK_RENDER], NULL );
+            for( int i = 0; i < p_sys->i_jobs; i++ )
+            {
+                const render_job_t *p_job = &p_sys->jobs[i];
+                snprintf( psz_args, sizeof( psz_args ),
+                          "\"lines\":\"%d-%d\"", p_job->i_y_begin,
+                          p_job->i_y_end - 1 );
+                TraceSpan( p_stats,
+                           ppsz_stage_names[STAGE_PLANE + p_job->i_component],
+                           p_job->i_thread, p_job->i_start, p_job->i_end,
+                           psz_args );
+            }
+            TraceSpan( p_stats, "copy", 0, pi_marks[MARK_RENDER],
+                       pi_marks[MARK_END], NULL );
+        }
+    }
+
+    if( ++p_stats->i_period == STATS_PERIOD )
+    {
+        p_stats->i_period = 0;
+        PublishStats( p_filter, p_stats );
+    }
+}
+
+/*****************************************************************************
+ * ParseMesh: read the mesh point offsets of a keystone-mesh-points value
+ *****************************************************************************
+ * Returns false, with all the offsets at 0, unless it holds exactly one
+ * pair per point. Those of the corner points are then ignored.
+ *****************************************************************************/
+static bool ParseMesh( float *pf_mesh, int i_cols, int i_rows,
+                       const char *psz )
+{
+    const int i_count = 2 * i_cols * i_rows;
+    int i = 0;
+
+    memset( pf_mesh, 0, i_count * sizeof( *pf_mesh ) );
+    while( psz && i >= 0 )
+    {
+        psz += strspn( psz, " \t,;" );
+        if( !*psz )
+            break;
+
+        char *psz_end;
+        const float f = us_strtof( psz, &psz_end );
+        if( psz_end == psz || i == i_count || !isfinite( f ) )
+            i = -1;
+        else
+            pf_mesh[i++] = VLC_CLIP( f, -1.f, 1.f );
+        psz = psz_end;
+    }
+    if( i != i_count )
+    {
+        memset( pf_mesh, 0, i_count * sizeof( *pf_mesh ) );
+        return false;
+    }
+
+    for( int c = 0; c < 4; c++ )
+    {
+        const int k = GetMeshCorner( i_cols, i_rows, c );
+        pf_mesh[2 * k] = pf_mesh[2 * k + 1] = 0.f;
+    }
+    return true;
+}
+
+/*****************************************************************************
+ * FormatMesh: keystone-mesh-points value of mesh point offsets
+ *****************************************************************************/
+static char *FormatMesh( const float *pf_mesh, int i_count )
+{
+    /* The offsets are within -1..1: "-1.000000" and a separator */
+    char *psz = malloc( i_count * 10 + 1 );
+    if( !psz )
+        return NULL;
+
+    char *p = psz;
+    *p = '\0';
+    for( int i = 0; i < i_count; i++ )
+    {
+        char *psz_value;
+        if( us_asprintf( &psz_value, "%s%.6f", i == 0 ? "" : i & 1 ? "," : " ",
+                         VLC_CLIP( pf_mesh[i], -1.f, 1.f ) ) < 0 )
+        {
+            free( psz );
+            return NULL;
+        }
+        strcpy( p, psz_value );
+        p += strlen( psz_value );
+        free( psz_value );
+    }
+    return psz;
+}
+
+/*****************************************************************************
+ * PersistCorners: write the corners changed by a drag to the parent
+ *****************************************************************************/
+static void PersistCorners( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_mesh = 2 * p_sys->i_mesh_cols * p_sys->i_mesh_rows;
+    float pf_corners[8], pf_mesh[2 * MESH_POINTS];
+
+    LoadCorners( p_sys, pf_corners, pf_mesh );
+    for( int i = 0; i < 8; i++ )
+        if( pf_corners[i] != p_sys->pf_persisted[i] )
+        {
+            var_SetFloat( p_filter->obj.parent, ppsz_corner_vars[i],
+                          pf_corners[i] );
+            p_sys->pf_persisted[i] = pf_corners[i];
+        }
+
+    if( i_mesh && memcmp( pf_mesh, p_sys->pf_persisted_mesh,
+                          i_mesh * sizeof( *pf_mesh ) ) )
+    {
+        char *psz_points = FormatMesh( pf_mesh, i_mesh );
+        if( psz_points )
+        {
+            var_SetString( p_filter->obj.parent, FILTER_PREFIX "mesh-points",
+                           psz_points );
+            free( psz_points );
+            memcpy( p_sys->pf_persisted_mesh, pf_mesh,
+                    i_mesh * sizeof( *pf_mesh ) );
+        }
+    }
+    p_sys->b_persist = false;
+}
+
+/*****************************************************************************
+ * MapProfileFile, UnmapProfileFile: read-only view of a profile file
+ *****************************************************************************
+ * Mapped where possible, the maps being then paged in as they are first
+ * read, with the read-ahead started right away; read whole otherwise.
+ *****************************************************************************/
+static uint8_t *MapProfileFile( int fd, size_t i_size )
+{
+#ifndef _WIN32
+    void *p_data = mmap( NULL, i_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if( p_data == MAP_FAILED )
+        return NULL;
+    posix_madvise( p_data, i_size, POSIX_MADV_WILLNEED );
+    return p_data;
+#else
+    uint8_t *p_data = malloc( i_size );
+    if( !p_data )
+        return NULL;
+    for( size_t i_done = 0; i_done < i_size; )
+    {
+        const int i_read = read( fd, &p_data[i_done],
+                                 __MIN( i_size - i_done, INT_MAX ) );
+        if( i_read <= 0 )
+        {
+            free( p_data );
+            return NULL;
+        }
+        i_done += i_read;
+    }
+    return p_data;
+#endif
+}
+
+static void UnmapProfileFile( profile_t *p_profile )
+{
+    if( !p_profile->p_data )
+        return;
+#ifndef _WIN32
+    munmap( p_profile->p_data, p_profile->i_size );
+#else
+    free( p_profile->p_data );
+#endif
+    memset( p_profile, 0, sizeof( *p_profile ) );
+}
+
+/*****************************************************************************
+ * CheckProfileMap: check that a map of the profile only reads its source
+ *****************************************************************************
+ * Each row must be ordered within the destination width, and the taps of
+ * its entries within the i_src_pitch * i_src_height bytes of the source,
+ * those of the inner runs without the bound checks of the edges: the
+ * checksum only catches accidents, not a map built for another picture.
+ *****************************************************************************/
+static bool CheckProfileMap( const profile_map_t *p_record,
+                             const uint8_t *p_data )
+{
+    const int i_width = p_record->i_dst_width;
+    const int64_t i_pitch = p_record->i_src_pitch;
+    const int i_lines = p_record->i_src_height;
+    const int i_pixel = p_record->i_pixel_size;
+    const int64_t i_size = i_pitch * i_lines;
+    const int i_taps = p_record->i_taps;
+    /* Widest load of the interior kernels, as SetWarpEntry() */
+    const int i_load_size = __MAX( 4, 2 * i_pixel );
+
+    if( i_taps && ( i_taps < 2 || i_taps > KERNEL_MAX_TAPS ) )
+        return false;
+
+    const warp_entry_t *p_entries = (const void *)( p_data
+                                                    + p_record->i_offset );
+    const warp_row_t *p_rows = (const void *)( p_entries
+        + (size_t)i_width * p_record->i_dst_height );
+
+    for( int y = 0; y < p_record->i_dst_height; y++ )
+    {
+        const warp_row_t *p_row = &p_rows[y];
+        if( p_row->i_begin < 0 || p_row->i_begin > p_row->i_inner_begin
+         || p_row->i_inner_begin > p_row->i_inner_end
+         || p_row->i_inner_end > p_row->i_end || p_row->i_end > i_width )
+            return false;
+
+        const warp_entry_t *p_line = &p_entries[(size_t)y * i_width];
+        for( int x = p_row->i_begin; x < p_row->i_end; x++ )
+        {
+            const warp_entry_t *p_entry = &p_line[x];
+            const bool b_inner = x >= p_row->i_inner_begin
+                              && x < p_row->i_inner_end;
+            const int64_t i_offset = p_entry->i_offset;
+
+            if( !p_entry->i_taps )
+            {
+                if( b_inner )
+                    return false;
+                continue;
+            }
+
+            if( i_taps )
+            {
+                /* Kernel windows across the edges hold their position,
+                 * KernelSample() checks each of their taps */
+                if( p_entry->i_fx >= KERNEL_PHASES
+                 || p_entry->i_fy >= KERNEL_PHASES
+                 || ( b_inner && p_entry->i_taps != TAP_ALL ) )
+                    return false;
+                if( p_entry->i_taps == TAP_ALL
+                 && ( i_offset < 0
+                   || i_offset / i_pitch + i_taps > i_lines
+                   || i_offset % i_pitch + i_taps * i_pixel > i_pitch ) )
+                    return false;
+                continue;
+            }
+
+            if( b_inner )
+            {
+                if( p_entry->i_taps != TAP_ALL || i_offset < 0
+                 || i_offset / i_pitch + 2 > i_lines
+                 || i_offset % i_pitch + i_load_size > i_pitch )
+                    return false;
+                continue;
+            }
+            for( int i = 0; i < 4; i++ )
+            {
+                const int64_t i_tap = i_offset + ( i & 1 ? i_pixel : 0 )
+                                               + ( i & 2 ? i_pitch : 0 );
+                if( ( p_entry->i_taps & ( TAP_00 << i ) )
+                 && ( i_tap < 0 || i_tap + i_pixel > i_size ) )
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*****************************************************************************
+ * CheckProfile: validate a profile file read in memory
+ *****************************************************************************
+ * The parameters must match their hash, and the records of the maps fit in
+ * the file. A map that does not fit, does not match its checksum or would
+ * read outside of its source is only dropped: the parameters are still the
+ * calibration.
+ *****************************************************************************/
+static bool CheckProfile( profile_t *p_profile )
+{
+    const size_t i_size = p_profile->i_size;
+    if( i_size < sizeof( profile_header_t ) )
+        return false;
+
+    const profile_header_t *p_header = (const void *)p_profile->p_data;
+    const profile_params_t *p_params = &p_header->params;
+    if( memcmp( p_header->psz_magic, PROFILE_MAGIC, 8 )
+     || p_header->i_version != PROFILE_VERSION
+     || p_header->i_hash != HashWords( HASH_INIT, p_params,
+                                       sizeof( *p_params ) ) )
+        return false;
+
+    const unsigned i_cols = p_params->i_mesh_cols;
+    const unsigned i_rows = p_params->i_mesh_rows;
+    if( ( i_cols || i_rows )
+     && ( i_cols < 2 || i_cols > MESH_MAX
+       || i_rows < 2 || i_rows > MESH_MAX ) )
+        return false;
+    for( int i = 0; i < 8; i++ )
+        if( !( fabsf( p_params->pf_corners[i] ) <= 1.f ) )
+            return false;
+    for( int i = 0; i < 2 * MESH_POINTS; i++ )
+        if( !( fabsf( p_params->pf_mesh[i] ) <= 1.f ) )
+            return false;
+
+    const unsigned i_maps = p_header->i_maps;
+    if( i_maps > PICTURE_PLANE_MAX
+     || ( i_size - sizeof( *p_header ) ) / sizeof( profile_map_t ) < i_maps )
+        return false;
+    const profile_map_t *p_maps = (const void *)( p_header + 1 );
+
+    for( unsigned m = 0; m < i_maps; m++ )
+    {
+        const profile_map_t *p_record = &p_maps[m];
+        if( p_record->i_dst_width < 1 || p_record->i_dst_width > OUTPUT_MAX
+         || p_record->i_dst_height < 1 || p_record->i_dst_height > OUTPUT_MAX
+         || p_record->i_src_width < 1 || p_record->i_src_height < 1
+         || p_record->i_pixel_size < 1 || p_record->i_pixel_size > 8
+         || p_record->i_src_pitch / p_record->i_pixel_size
+            < p_record->i_src_width
+         || p_record->i_offset % PROFILE_ALIGN )
+        {
+            p_profile->i_bad_maps |= 1u << m;
+            continue;
+        }
+
+        const uint64_t i_bytes = (uint64_t)p_record->i_dst_width
+                               * p_record->i_dst_height
+                               * sizeof( warp_entry_t )
+                               + (uint64_t)p_record->i_dst_height
+                               * sizeof( warp_row_t );
+        if( p_record->i_offset > i_size
+         || i_bytes > i_size - p_record->i_offset
+         || p_record->i_check != HashWords( HASH_INIT, p_profile->p_data
+                                            + p_record->i_offset, i_bytes )
+         || !CheckProfileMap( p_record, p_profile->p_data ) )
+            p_profile->i_bad_maps |= 1u << m;
+    }
+
+    p_profile->p_header = p_header;
+    p_profile->p_maps = p_maps;
+    return true;
+}
+
+/*****************************************************************************
+ * LoadProfile: read the calibration profile, if it exists yet
+ *****************************************************************************/
+static void LoadProfile( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    profile_t *p_profile = &p_sys->profile;
+    const char *psz_path = p_sys->psz_profile;
+
+    int fd = vlc_open( psz_path, O_RDONLY );
+    if( fd == -1 )
+    {
+        msg_Dbg( p_filter, "no profile %s yet", psz_path );
+        return;
+    }
+
+    struct stat st;
+    if( fstat( fd, &st ) == 0 && st.st_size > 0
+     && (uintmax_t)st.st_size <= SIZE_MAX )
+    {
+        p_profile->i_size = st.st_size;
+        p_profile->p_data = MapProfileFile( fd, p_profile->i_size );
+    }
+    vlc_close( fd );
+
+    if( !p_profile->p_data || !CheckProfile( p_profile ) )
+    {
+        msg_Warn( p_filter, "ignoring the invalid profile %s", psz_path );
+        UnmapProfileFile( p_profile );
+        p_sys->b_profile_invalid = true;
+        return;
+    }
+    msg_Dbg( p_filter, "profile %s, with %u warp maps", psz_path,
+             p_profile->p_header->i_maps );
+    if( p_profile->i_bad_maps )
+        msg_Warn( p_filter, "ignoring damaged or inconsistent warp maps "
+                  "of %s, they will be rebuilt", psz_path );
+}
+
+/*****************************************************************************
+ * SaveProfile: write the calibration profile, if it changed
+ *****************************************************************************
+ * With keystone-profile-maps, the warp maps go with it if the last picture
+ * was rendered with these parameters. The file is replaced in one go, so
+ * that it is never found half written.
+ *****************************************************************************/
+static void SaveProfile( filter_t *p_filter )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const profile_t *p_profile = &p_sys->profile;
+    const int i_mesh = 2 * p_sys->i_mesh_cols * p_sys->i_mesh_rows;
+    float pf_corners[8], pf_mesh[2 * MESH_POINTS];
+
+    profile_header_t header;
+    memset( &header, 0, sizeof( header ) );
+    memcpy( header.psz_magic, PROFILE_MAGIC, 8 );
+    header.i_version = PROFILE_VERSION;
+    LoadCorners( p_sys, pf_corners, pf_mesh );
+    GetProfileParams( &header.params, pf_corners, pf_mesh,
+                      p_sys->i_mesh_cols, p_sys->i_mesh_rows );
+    header.i_hash = HashWords( HASH_INIT, &header.params,
+                               sizeof( header.params ) );
+
+    /* Maps built for the same corners by the last picture */
+    profile_map_t records[PICTURE_PLANE_MAX];
+    const warp_map_t *pp_maps[PICTURE_PLANE_MAX];
+    bool b_new_maps = false;
+    if( p_sys->b_profile_maps && p_sys->b_cache_valid
+     && !memcmp( p_sys->pf_cache_corners, pf_corners, sizeof( pf_corners ) )
+     && ( !i_mesh || !memcmp( p_sys->pf_cache_mesh, pf_mesh,
+                              i_mesh * sizeof( *pf_mesh ) ) ) )
+        for( int i = 0; i < p_sys->i_components; i++ )
+        {
+            const warp_map_t *p_map = &p_sys->maps[i];
+            if( !p_map->i_dst_width || !p_map->p_entries )
+                continue;
+
+            const size_t i_entries = (size_t)p_map->i_dst_width
+                                   * p_map->i_dst_height;
+            uint64_t i_check = HashWords( HASH_INIT, p_map->p_entries,
+                                          i_entries * sizeof( warp_entry_t ) );
+            i_check = HashWords( i_check, p_map->p_rows,
+                                 p_map->i_dst_height * sizeof( warp_row_t ) );
+            pp_maps[header.i_maps] = p_map;
+            records[header.i_maps++] = (profile_map_t) {
+                .i_key = GetProfileMapKey( p_sys, header.i_hash, i ),
+                .i_check = i_check,
+                .i_dst_width  = p_map->i_dst_width,
+                .i_dst_height = p_map->i_dst_height,
+                .i_src_width  = p_map->i_src_width,
+                .i_src_height = p_map->i_src_height,
+                .i_src_pitch  = p_map->i_src_pitch,
+                .i_pixel_size = p_map->i_pixel_size,
+                .i_taps = p_sys->i_interp > INTERP_BILINEAR
+                        ? p_sys->kernel.i_taps : 0,
+            };
+            b_new_maps |= !p_map->b_mapped;
+        }
+    if( p_profile->p_data && p_profile->p_header->i_hash == header.i_hash
+     && !b_new_maps )
+        return;
+
+    uint64_t i_offset = sizeof( header ) + header.i_maps * sizeof( *records );
+    for( unsigned m = 0; m < header.i_maps; m++ )
+    {
+        i_offset = ( i_offset + PROFILE_ALIGN - 1 )
+                 & ~(uint64_t)( PROFILE_ALIGN - 1 );
+        records[m].i_offset = i_offset;
+        i_offset += (uint64_t)records[m].i_dst_width * records[m].i_dst_height
+                  * sizeof( warp_entry_t )
+                  + records[m].i_dst_height * sizeof( warp_row_t );
+    }
+
+    /* The file that could not be read may still be a calibration worth
+     * recovering: keep it aside rather than replace it */
+    if( p_sys->b_profile_invalid )
+    {
+        char *psz_bad;
+        if( asprintf( &psz_bad, "%s.bad", p_sys->psz_profile ) == -1 )
+            return;
+        const bool b_moved = !vlc_rename( p_sys->psz_profile, psz_bad );
+        if( b_moved )
+            msg_Warn( p_filter, "moved the invalid profile %s to %s",
+                      p_sys->psz_profile, psz_bad );
+        else
+            msg_Warn( p_filter, "not overwriting the invalid profile %s",
+                      p_sys->psz_profile );
+        free( psz_bad );
+        if( !b_moved )
+            return;
+    }
+
+    char *psz_temp;
+    if( asprintf( &psz_temp, "%s.tmp", p_sys->psz_profile ) == -1 )
+        return;
+    FILE *p_file = vlc_fopen( psz_temp, "wb" );
+    bool b_ok = p_file
+             && fwrite( &header, sizeof( header ), 1, p_file ) == 1
+             && fwrite( records, sizeof( *records ), header.i_maps,
+                        p_file ) == header.i_maps;
+    for( unsigned m = 0; b_ok && m < header.i_maps; m++ )
+    {
+        static const uint8_t p_zero[PROFILE_ALIGN];
+        const warp_map_t *p_map = pp_maps[m];
+        const size_t i_entries = (size_t)p_map->i_dst_width
+                               * p_map->i_dst_height;
+        const long i_pad = records[m].i_offset - ftell( p_file );
+
+        b_ok = i_pad >= 0 && i_pad < PROFILE_ALIGN
+            && fwrite( p_zero, 1, i_pad, p_file ) == (size_t)i_pad
+            && fwrite( p_map->p_entries, sizeof( warp_entry_t ), i_entries,
+                       p_file ) == i_entries
+            && fwrite( p_map->p_rows, sizeof( warp_row_t ),
+                       p_map->i_dst_height,
+                       p_file ) == (size_t)p_map->i_dst_height;
+    }
+    if( p_file && fclose( p_file ) )
+        b_ok = false;
+#ifdef _WIN32
+    /* No replacing rename: the file is not mapped there */
+    if( b_ok )
+        vlc_unlink( p_sys->psz_profile );
+#endif
+    if( b_ok && vlc_rename( psz_temp, p_sys->psz_profile ) )
+        b_ok = false;
+
+    if( b_ok )
+        msg_Dbg( p_filter, "saved the profile %s, with %u warp maps",
+                 p_sys->psz_profile, header.i_maps );
+    else
+    {
+        msg_Warn( p_filter, "cannot save the profile %s",
+                  p_sys->psz_profile );
+        vlc_unlink( psz_temp );
+    }
+    free( psz_temp );
+}
+
+/*****************************************************************************
+ * SetOutputSize: size the output format, keeping the display aspect ratio
+ *****************************************************************************/
+static void SetOutputSize( video_format_t *p_out, const video_format_t *p_in,
+                           unsigned i_width, unsigned i_height )
+{
+    /* Whole 4:2:x chroma samples in YUV */
+    if( p_in->i_chroma != VLC_CODEC_RGB24 && p_in->i_chroma != VLC_CODEC_RGB32
+     && p_in->i_chroma != VLC_CODEC_RGBA )
+    {
+        i_width  &= ~1u;
+        i_height &= ~1u;
+    }
+
+    p_out->i_width  = p_out->i_visible_width  = i_width;
+    p_out->i_height = p_out->i_visible_height = i_height;
+    p_out->i_x_offset = p_out->i_y_offset = 0;
+    if( p_in->i_sar_num && p_in->i_sar_den
+     && p_in->i_visible_width && p_in->i_visible_height )
+        vlc_ureduce( &p_out->i_sar_num, &p_out->i_sar_den,
+                     (uint64_t)p_in->i_sar_num * p_in->i_visible_width
+                     * i_height,
+                     (uint64_t)p_in->i_sar_den * p_in->i_visible_height
+                     * i_width, 0 );
+}
+
+/*****************************************************************************
+ * Create: allocate and initialize keystone filter
+ *****************************************************************************/
+static int Create( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    if( p_filter->fmt_in.video.i_chroma != p_filter->fmt_out.video.i_chroma )
+    {
+        msg_Err( p_filter, "Input and output chromas don't match" );
+        return VLC_EGENERIC;
+    }
+
+    /* Only accept planar, semi-planar and packed 4:2:2 YUV chromas, and
+     * packed RGB, that we can process pixel-by-pixel.
+     * On Windows, use --avcodec-hw=none to force software decoding so the
+     * decoder produces planar YUV instead of D3D11 opaque textures. */
+    switch( p_filter->fmt_in.video.i_chroma )
+    {
+        CASE_PLANAR_YUV
+        CASE_PLANAR_YUV10
+        CASE_PLANAR_YUV9
+        case VLC_CODEC_NV12:
+        case VLC_CODEC_NV21:
+        CASE_PACKED_YUV_422
+        case VLC_CODEC_RGB24:
+        case VLC_CODEC_RGB32:
+        case VLC_CODEC_RGBA:
+            break;
+        default:
+            msg_Dbg( p_filter, "Unsupported chroma (%4.4s), need YUV or RGB",
+                     (char *)&p_filter->fmt_in.video.i_chroma );
+            return VLC_EGENERIC;
+    }
+
+    filter_sys_t *p_sys = malloc( sizeof( *p_sys ) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+    p_filter->p_sys = p_sys;
+
+    config_ChainParse( p_filter, FILTER_PREFIX, ppsz_filter_options,
+                       p_filter->p_cfg );
+
+    /* Output size: the option, else the one the filter chain asked for */
+    char *psz_size = var_CreateGetStringCommand( p_filter,
+                                                 FILTER_PREFIX "output-size" );
+    if( psz_size && *psz_size )
+    {
+        unsigned i_out_width, i_out_height;
+        if( sscanf( psz_size, "%ux%u", &i_out_width, &i_out_height ) != 2
+         || i_out_width < 2 || i_out_width > OUTPUT_MAX
+         || i_out_height < 2 || i_out_height > OUTPUT_MAX )
+            msg_Warn( p_filter, "invalid output size \"%s\", need width x "
+                      "height from 2x2 to %dx%d", psz_size, OUTPUT_MAX,
+                      OUTPUT_MAX );
+        else
+            SetOutputSize( &p_filter->fmt_out.video, &p_filter->fmt_in.video,
+                           i_out_width, i_out_height );
+    }
+    free( psz_size );
+    if( !p_filter->fmt_out.video.i_visible_width
+     || !p_filter->fmt_out.video.i_visible_height )
+    {
+        msg_Err( p_filter, "Invalid output size %ux%u",
+                 p_filter->fmt_out.video.i_visible_width,
+                 p_filter->fmt_out.video.i_visible_height );
+        free( p_sys );
+        return VLC_EGENERIC;
+    }
+
+    /* Calibration profile: its corners and mesh replace the options */
+    memset( &p_sys->profile, 0, sizeof( p_sys->profile ) );
+    p_sys->b_profile_invalid = false;
+    p_sys->psz_profile = var_CreateGetStringCommand( p_filter,
+                                                     FILTER_PREFIX "profile" );
+    if( p_sys->psz_profile && !*p_sys->psz_profile )
+    {
+        free( p_sys->psz_profile );
+        p_sys->psz_profile = NULL;
+    }
+    if( p_sys->psz_profile )
+        LoadProfile( p_filter );
+    const profile_params_t *p_profile = p_sys->profile.p_header
+                                      ? &p_sys->profile.p_header->params
+                                      : NULL;
+    p_sys->b_profile_maps = var_CreateGetBoolCommand( p_filter,
+                                              FILTER_PREFIX "profile-maps" );
+    p_sys->i_chroma = p_filter->fmt_in.video.i_chroma;
 
     /* Create persistent variables on the parent object so values survive
      * filter recreation (e.g., playlist loop). Pattern from ci_filters.m. */
-    vlc_atomic_float *pf_all[] = {
-        &p_sys->f_tl_x, &p_sys->f_tl_y, &p_sys->f_tr_x, &p_sys->f_tr_y,
-        &p_sys->f_bl_x, &p_sys->f_bl_y, &p_sys->f_br_x, &p_sys->f_br_y,
-    };
+    vlc_mutex_init( &p_sys->corners_lock );
+    atomic_init( &p_sys->i_corners_seq, 0 );
     for( int i = 0; i < 8; i++ )
     {
         const char *name = ppsz_corner_vars[i];
@@ -479,26 +6389,176 @@ static int Create( vlc_object_t *p_this )
 
         /* Priority for initial value:
          * 1. Parent variable (persisted across filter recreation)
-         * 2. Config/CLI value */
+         * 2. Calibration profile
+         * 3. Config/CLI value */
         float parent_val = var_GetFloat( p_filter->obj.parent, name );
         float val;
         if( parent_val != 0.f )
             val = parent_val;
+        else if( p_profile )
+            val = p_profile->pf_corners[i];
         else
             val = var_CreateGetFloatCommand( p_filter, name );
-        vlc_atomic_init_float( pf_all[i], val );
+        vlc_atomic_init_float( &p_sys->pf_corners[i], val );
 
         /* Persist to parent for filter recreation */
         var_SetFloat( p_filter->obj.parent, name, val );
+        p_sys->pf_persisted[i] = val;
+
+        var_AddCallback( p_filter, name, KeystoneCallback, p_sys );
+    }
+
+    /* Mesh, 2x2 being the corners alone */
+    p_sys->i_mesh_cols = p_sys->i_mesh_rows = 0;
+    char *psz_mesh = var_CreateGetStringCommand( p_filter,
+                                                 FILTER_PREFIX "mesh" );
+    if( psz_mesh && *psz_mesh )
+    {
+        int i_cols, i_rows;
+        if( sscanf( psz_mesh, "%dx%d", &i_cols, &i_rows ) != 2
+         || i_cols < 2 || i_cols > MESH_MAX
+         || i_rows < 2 || i_rows > MESH_MAX )
+            msg_Warn( p_filter, "invalid mesh \"%s\", need columns x rows "
+                      "from 2x2 to %dx%d", psz_mesh, MESH_MAX, MESH_MAX );
+        else if( i_cols > 2 || i_rows > 2 )
+        {
+            p_sys->i_mesh_cols = i_cols;
+            p_sys->i_mesh_rows = i_rows;
+        }
+    }
+    free( psz_mesh );
+    if( p_profile )
+    {
+        if( p_sys->i_mesh_cols != (int)p_profile->i_mesh_cols
+         || p_sys->i_mesh_rows != (int)p_profile->i_mesh_rows )
+            msg_Warn( p_filter, "the mesh of the profile %s (%ux%u) "
+                      "replaces the %s option (%dx%d)", p_sys->psz_profile,
+                      __MAX( p_profile->i_mesh_cols, 2 ),
+                      __MAX( p_profile->i_mesh_rows, 2 ),
+                      FILTER_PREFIX "mesh", __MAX( p_sys->i_mesh_cols, 2 ),
+                      __MAX( p_sys->i_mesh_rows, 2 ) );
+        p_sys->i_mesh_cols = p_profile->i_mesh_cols;
+        p_sys->i_mesh_rows = p_profile->i_mesh_rows;
+    }
+
+    /* Offsets of its points, persistent like the corners */
+    float pf_mesh[2 * MESH_POINTS] = { 0.f };
+    if( p_sys->i_mesh_cols )
+    {
+        const char *name = FILTER_PREFIX "mesh-points";
+        const int i_mesh = 2 * p_sys->i_mesh_cols * p_sys->i_mesh_rows;
+
+        var_Create( p_filter->obj.parent, name, VLC_VAR_STRING );
+        char *psz_points = var_GetString( p_filter->obj.parent, name );
+        char *psz_option = var_CreateGetStringCommand( p_filter, name );
+        const bool b_parent = psz_points && *psz_points;
+        if( !b_parent )
+        {
+            free( psz_points );
+            psz_points = psz_option;
+        }
+        else
+            free( psz_option );
+
+        if( !b_parent && p_profile )
+            memcpy( pf_mesh, p_profile->pf_mesh, i_mesh * sizeof( *pf_mesh ) );
+        else if( !ParseMesh( pf_mesh, p_sys->i_mesh_cols, p_sys->i_mesh_rows,
+                             psz_points ) && psz_points && *psz_points )
+            msg_Warn( p_filter, "ignoring the mesh points, need %d offsets",
+                      i_mesh );
+        free( psz_points );
+
+        /* Persist to parent for filter recreation */
+        psz_points = FormatMesh( pf_mesh, i_mesh );
+        if( psz_points )
+            var_SetString( p_filter->obj.parent, name, psz_points );
+        free( psz_points );
+        memcpy( p_sys->pf_persisted_mesh, pf_mesh,
+                i_mesh * sizeof( *pf_mesh ) );
 
         var_AddCallback( p_filter, name, KeystoneCallback, p_sys );
     }
+    for( int i = 0; i < 2 * MESH_POINTS; i++ )
+        vlc_atomic_init_float( &p_sys->pf_mesh[i], pf_mesh[i] );
 
+    p_sys->b_persist = false;
     atomic_init( &p_sys->i_drag_corner, -1 );
     atomic_init( &p_sys->i_hover_corner, -1 );
     atomic_init( &p_sys->b_show_handles,
                  var_CreateGetBoolCommand( p_filter,
                                            FILTER_PREFIX "show-handles" ) );
+    p_sys->b_show_outline = var_CreateGetBoolCommand( p_filter,
+                                              FILTER_PREFIX "show-outline" );
+
+    /* The overlay needs a video output to draw it: there is none when
+     * filtering for the stream output, which is then left clean */
+    p_sys->p_vout = NULL;
+    p_sys->b_overlay = false;
+    if( p_filter->obj.parent->obj.object_type
+     && !strcmp( p_filter->obj.parent->obj.object_type, "video output" ) )
+    {
+        p_sys->p_vout = (vout_thread_t *)p_filter->obj.parent;
+        p_sys->i_spu_channel = vout_RegisterSubpictureChannel( p_sys->p_vout );
+    }
+    else
+        msg_Dbg( p_filter, "not in a video output, no handles" );
+
+    p_sys->b_cache_valid = false;
+    p_sys->b_cache_new = false;
+    p_sys->b_cache_seq = false;
+    memset( p_sys->maps, 0, sizeof( p_sys->maps ) );
+    memset( p_sys->grids, 0, sizeof( p_sys->grids ) );
+    p_sys->i_isa = GetIsa();
+    SetupComponents( p_sys, &p_filter->fmt_in.video );
+    msg_Dbg( p_filter, "%s interior kernels", ppsz_isa_names[p_sys->i_isa] );
+
+    char *psz_quality = var_CreateGetStringCommand( p_filter,
+                                                    FILTER_PREFIX "quality" );
+    p_sys->b_fast = psz_quality && !strcmp( psz_quality, "fast" );
+    free( psz_quality );
+    p_sys->f_tolerance = var_CreateGetFloatCommand( p_filter,
+                                                    FILTER_PREFIX "tolerance" );
+
+    static const char *const ppsz_edge_vars[] = {
+        FILTER_PREFIX "blend-left", FILTER_PREFIX "blend-right",
+        FILTER_PREFIX "blend-top", FILTER_PREFIX "blend-bottom",
+    };
+    p_sys->b_soft_edge = false;
+    for( int i = 0; i < 4; i++ )
+    {
+        p_sys->pf_edge[i] = VLC_CLIP( var_CreateGetFloatCommand( p_filter,
+                                          ppsz_edge_vars[i] ), 0.f, .5f );
+        if( p_sys->pf_edge[i] > 0.f )
+            p_sys->b_soft_edge = true;
+    }
+    p_sys->f_edge_gamma = VLC_CLIP( var_CreateGetFloatCommand( p_filter,
+                                        FILTER_PREFIX "blend-gamma" ),
+                                    1.f, 4.f );
+    p_sys->f_edge_black = VLC_CLIP( var_CreateGetFloatCommand( p_filter,
+                                        FILTER_PREFIX "blend-black" ),
+                                    0.f, .25f );
+    memset( p_sys->edges, 0, sizeof( p_sys->edges ) );
+
+    char *psz_interp = var_CreateGetStringCommand( p_filter,
+                                                   FILTER_PREFIX "interp" );
+    p_sys->i_interp = INTERP_BILINEAR;
+    for( size_t i = 0; psz_interp && i < ARRAY_SIZE( ppsz_interp_values ); i++ )
+        if( !strcmp( psz_interp, ppsz_interp_values[i] ) )
+            p_sys->i_interp = i;
+    free( psz_interp );
+    BuildKernel( &p_sys->kernel, p_sys->i_interp );
+    if( p_sys->b_fast && p_sys->i_interp != INTERP_BILINEAR )
+        msg_Dbg( p_filter, "fast quality only applies to bilinear" );
+    p_sys->i_cost_time = 0;
+    p_sys->i_cost_frames = 0;
+
+    int i_threads = var_CreateGetIntegerCommand( p_filter,
+                                                 FILTER_PREFIX "threads" );
+    if( i_threads <= 0 )
+        i_threads = vlc_GetCPUCount();
+    p_sys->p_stats = NULL;
+    StartWorkers( p_filter, VLC_CLIP( i_threads, 1, MAX_THREADS ) );
+    OpenStats( p_filter );
 
     p_filter->pf_video_filter = Filter;
     p_filter->pf_video_mouse = Mouse;
@@ -517,14 +6577,41 @@ static void Destroy( vlc_object_t *p_this )
     for( int i = 0; i < 8; i++ )
         var_DelCallback( p_filter, ppsz_corner_vars[i],
                          KeystoneCallback, p_sys );
+    if( p_sys->i_mesh_cols )
+        var_DelCallback( p_filter, FILTER_PREFIX "mesh-points",
+                         KeystoneCallback, p_sys );
     /* Note: parent variables are intentionally NOT destroyed so values
      * persist across filter recreation (playlist loop). */
+    if( p_sys->b_persist )
+        PersistCorners( p_filter );
 
+    StopWorkers( p_sys );
+    if( p_sys->psz_profile )
+        SaveProfile( p_filter );
+    CloseStats( p_sys );
+    vlc_mutex_destroy( &p_sys->corners_lock );
+
+    if( p_sys->p_vout )
+        vout_FlushSubpictureChannel( p_sys->p_vout, p_sys->i_spu_channel );
+
+    for( int i = 0; i < PICTURE_PLANE_MAX; i++ )
+    {
+        if( !p_sys->maps[i].b_mapped )
+        {
+            free( p_sys->maps[i].p_entries );
+            free( p_sys->maps[i].p_rows );
+        }
+        free( p_sys->grids[i].p_points );
+        free( p_sys->grids[i].p_exact );
+        free( p_sys->edges[i].pi_gains );
+    }
+    UnmapProfileFile( &p_sys->profile );
+    free( p_sys->psz_profile );
     free( p_sys );
 }
 
 /*****************************************************************************
- * Filter: apply keystone transform and draw corner handles
+ * Filter: apply keystone transform
  *****************************************************************************/
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
@@ -534,6 +6621,69 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     if( !p_pic )
         return NULL;
 
+    /* Instants of the stages, only read with the statistics */
+    filter_stats_t *p_stats = p_sys->p_stats;
+    mtime_t pi_marks[MARK_COUNT];
+    if( p_stats )
+        pi_marks[MARK_BEGIN] = mdate();
+
+    /* Y plane dimensions, of the output and of the source */
+    const int i_width  = p_filter->fmt_out.video.i_visible_width;
+    const int i_height = p_filter->fmt_out.video.i_visible_height;
+    const int i_src_width  = p_pic->p[Y_PLANE].i_visible_pitch
+                             / p_pic->p[Y_PLANE].i_pixel_pitch;
+    const int i_src_height = p_pic->p[Y_PLANE].i_visible_lines;
+
+    UpdateOverlay( p_filter );
+    if( p_stats )
+        pi_marks[MARK_OVERLAY] = mdate();
+
+    /* Same corners as the last picture, of the same size: the homography
+     * and the maps are up to date, without even reading the corners */
+    p_sys->b_cache_new = false;
+    if( !p_sys->b_cache_seq
+     || atomic_load( &p_sys->i_corners_seq ) != p_sys->i_cache_seq
+     || ( !p_sys->b_identity && ( p_sys->i_cache_width != i_width
+                               || p_sys->i_cache_height != i_height
+                               || p_sys->i_cache_src_width != i_src_width
+                               || p_sys->i_cache_src_height != i_src_height ) )
+     || ( p_sys->b_identity && ( i_width != i_src_width
+                              || i_height != i_src_height ) ) )
+    {
+        /* Load current parameter values (set by mouse or callbacks) */
+        float pf_corners[8], pf_mesh[2 * MESH_POINTS];
+        p_sys->i_cache_seq = LoadCorners( p_sys, pf_corners, pf_mesh );
+        p_sys->b_cache_seq = true;
+
+        /* Identity short-circuit, unless the edges are faded or the
+         * picture rescaled */
+        p_sys->b_identity = !p_sys->b_soft_edge && i_width == i_src_width
+                         && i_height == i_src_height;
+        for( int i = 0; i < 8; i++ )
+            if( pf_corners[i] != 0.f )
+                p_sys->b_identity = false;
+        for( int i = 0; i < 2 * p_sys->i_mesh_cols * p_sys->i_mesh_rows; i++ )
+            if( pf_mesh[i] != 0.f )
+                p_sys->b_identity = false;
+        if( !p_sys->b_identity )
+            UpdateRenderCache( p_sys, pf_corners, pf_mesh, i_width, i_height,
+                               i_src_width, i_src_height );
+    }
+    const bool b_warp = !p_sys->b_identity
+                     && ( p_sys->b_homography || i_width != i_src_width
+                                              || i_height != i_src_height );
+    if( p_stats )
+        pi_marks[MARK_HOMOGRAPHY] = mdate();
+
+    /* Nothing to warp, or degenerate corners at the input size: pass the
+     * picture through untouched */
+    if( !b_warp )
+    {
+        if( p_stats )
+            RecordStats( p_filter, pi_marks, false );
+        return p_pic;
+    }
+
     p_outpic = filter_NewPicture( p_filter );
     if( !p_outpic )
     {
@@ -542,96 +6692,31 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
         return NULL;
     }
 
-    /* Load current parameter values (atomics, set by mouse or callbacks) */
-    float f_tl_x = vlc_atomic_load_float( &p_sys->f_tl_x );
-    float f_tl_y = vlc_atomic_load_float( &p_sys->f_tl_y );
-    float f_tr_x = vlc_atomic_load_float( &p_sys->f_tr_x );
-    float f_tr_y = vlc_atomic_load_float( &p_sys->f_tr_y );
-    float f_bl_x = vlc_atomic_load_float( &p_sys->f_bl_x );
-    float f_bl_y = vlc_atomic_load_float( &p_sys->f_bl_y );
-    float f_br_x = vlc_atomic_load_float( &p_sys->f_br_x );
-    float f_br_y = vlc_atomic_load_float( &p_sys->f_br_y );
+    const mtime_t i_start = mdate();
+    RenderPicture( p_sys, p_pic, p_outpic );
+    const mtime_t i_end = mdate();
+    p_sys->i_cost_time += i_end - i_start;
 
-    /* Y plane dimensions */
-    const int i_width  = p_pic->p[Y_PLANE].i_visible_pitch
-                         / p_pic->p[Y_PLANE].i_pixel_pitch;
-    const int i_height = p_pic->p[Y_PLANE].i_visible_lines;
-
-    /* Identity short-circuit */
-    if( f_tl_x == 0.f && f_tl_y == 0.f && f_tr_x == 0.f && f_tr_y == 0.f
-     && f_bl_x == 0.f && f_bl_y == 0.f && f_br_x == 0.f && f_br_y == 0.f )
-    {
-        picture_Copy( p_outpic, p_pic );
-    }
-    else
+    /* Measured cost of the interpolation, to pick one per machine */
+    if( ++p_sys->i_cost_frames == COST_FRAMES )
     {
-        /* Destination corners (where the user places them) */
-        double dx0 = f_tl_x * i_width;
-        double dy0 = f_tl_y * i_height;
-        double dx1 = (double)( i_width - 1 ) + f_tr_x * i_width;
-        double dy1 = f_tr_y * i_height;
-        double dx2 = f_bl_x * i_width;
-        double dy2 = (double)( i_height - 1 ) + f_bl_y * i_height;
-        double dx3 = (double)( i_width - 1 ) + f_br_x * i_width;
-        double dy3 = (double)( i_height - 1 ) + f_br_y * i_height;
-
-        /* Source corners (original rectangle) */
-        double sx0 = 0.0,                     sy0 = 0.0;
-        double sx1 = (double)( i_width - 1 ), sy1 = 0.0;
-        double sx2 = 0.0,                     sy2 = (double)( i_height - 1 );
-        double sx3 = (double)( i_width - 1 ), sy3 = (double)( i_height - 1 );
-
-        double h[8];
-        if( !ComputeHomography( h,
-                sx0, sy0, dx0, dy0,
-                sx1, sy1, dx1, dy1,
-                sx2, sy2, dx2, dy2,
-                sx3, sy3, dx3, dy3 ) )
-        {
-            picture_Copy( p_outpic, p_pic );
-            goto draw_handles;
-        }
-
-        for( int i = 0; i < p_pic->i_planes; i++ )
-        {
-            RenderPlane( &p_pic->p[i], &p_outpic->p[i],
-                         i_width, i_height, h, i );
-        }
+        msg_Dbg( p_filter, "%s interpolation: %.2f ms per %dx%d picture",
+                 ppsz_interp_values[p_sys->i_interp],
+                 p_sys->i_cost_time / ( 1000. * COST_FRAMES ),
+                 i_width, i_height );
+        p_sys->i_cost_time = 0;
+        p_sys->i_cost_frames = 0;
     }
 
-draw_handles:
-    /* Draw handle for hovered or dragged corner only */
-    if( atomic_load( &p_sys->b_show_handles ) )
+    p_outpic = CopyInfoAndRelease( p_outpic, p_pic );
+    if( p_stats )
     {
-        int drag  = atomic_load( &p_sys->i_drag_corner );
-        int hover = atomic_load( &p_sys->i_hover_corner );
-
-        /* Pick which corner to show: drag takes priority over hover */
-        int show = ( drag >= 0 ) ? drag : hover;
-        if( show >= 0 && show < 4 )
-        {
-            int hx, hy;
-            GetCornerPixelPos( show, i_width, i_height,
-                               f_tl_x, f_tl_y, f_tr_x, f_tr_y,
-                               f_bl_x, f_bl_y, f_br_x, f_br_y,
-                               &hx, &hy );
-
-            /* Clamp to visible area */
-            if( hx < 0 ) hx = 0;
-            if( hx >= i_width ) hx = i_width - 1;
-            if( hy < 0 ) hy = 0;
-            if( hy >= i_height ) hy = i_height - 1;
-
-            if( drag >= 0 )
-                DrawHandle( p_outpic, hx, hy, HANDLE_SIZE,
-                            ACTIVE_Y, ACTIVE_U, ACTIVE_V );
-            else
-                DrawHandle( p_outpic, hx, hy, HANDLE_SIZE,
-                            HOVER_Y, HOVER_U, HOVER_V );
-        }
+        pi_marks[MARK_PICTURE] = i_start;
+        pi_marks[MARK_RENDER]  = i_end;
+        pi_marks[MARK_END]     = mdate();
+        RecordStats( p_filter, pi_marks, true );
     }
-
-    return CopyInfoAndRelease( p_outpic, p_pic );
+    return p_outpic;
 }
 
 /*****************************************************************************
@@ -645,38 +6730,29 @@ static int Mouse( filter_t *p_filter, vlc_mouse_t *p_mouse,
     const int i_width  = p_fmt->i_visible_width;
     const int i_height = p_fmt->i_visible_height;
 
-    /* Load current offsets */
-    float f_tl_x = vlc_atomic_load_float( &p_sys->f_tl_x );
-    float f_tl_y = vlc_atomic_load_float( &p_sys->f_tl_y );
-    float f_tr_x = vlc_atomic_load_float( &p_sys->f_tr_x );
-    float f_tr_y = vlc_atomic_load_float( &p_sys->f_tr_y );
-    float f_bl_x = vlc_atomic_load_float( &p_sys->f_bl_x );
-    float f_bl_y = vlc_atomic_load_float( &p_sys->f_bl_y );
-    float f_br_x = vlc_atomic_load_float( &p_sys->f_br_x );
-    float f_br_y = vlc_atomic_load_float( &p_sys->f_br_y );
-
     if( i_width <= 0 || i_height <= 0 )
     {
         *p_mouse = *p_new;
         return VLC_SUCCESS;
     }
 
-    /* Left button press: check if clicking on a corner handle */
+    /* Load current offsets, and place the handles */
+    float pf_corners[8], pf_mesh[2 * MESH_POINTS];
+    LoadCorners( p_sys, pf_corners, pf_mesh );
+    int pi_x[MAX_HANDLES], pi_y[MAX_HANDLES];
+    const int i_handles = GetHandles( p_sys, pf_corners, pf_mesh,
+                                      i_width, i_height, pi_x, pi_y );
+
+    /* Left button press: check if clicking on a handle */
     if( vlc_mouse_HasPressed( p_old, p_new, MOUSE_BUTTON_LEFT ) )
     {
         int best = -1;
         int best_dist = HANDLE_SIZE * HANDLE_SIZE * 4;
 
-        for( int c = 0; c < 4; c++ )
+        for( int c = 0; c < i_handles; c++ )
         {
-            int hx, hy;
-            GetCornerPixelPos( c, i_width, i_height,
-                               f_tl_x, f_tl_y, f_tr_x, f_tr_y,
-                               f_bl_x, f_bl_y, f_br_x, f_br_y,
-                               &hx, &hy );
-
-            int ddx = p_new->i_x - hx;
-            int ddy = p_new->i_y - hy;
+            int ddx = p_new->i_x - pi_x[c];
+            int ddy = p_new->i_y - pi_y[c];
             int dist = ddx * ddx + ddy * ddy;
 
             if( dist < best_dist )
@@ -689,11 +6765,12 @@ static int Mouse( filter_t *p_filter, vlc_mouse_t *p_mouse,
         if( best >= 0 )
         {
             atomic_store( &p_sys->i_drag_corner, best );
+            UpdateOverlay( p_filter );
             return VLC_EGENERIC;
         }
     }
 
-    /* Dragging: update corner offset */
+    /* Dragging: update corner or mesh point offset */
     int drag = atomic_load( &p_sys->i_drag_corner );
 
     if( vlc_mouse_IsLeftPressed( p_new ) && drag >= 0 )
@@ -704,18 +6781,15 @@ static int Mouse( filter_t *p_filter, vlc_mouse_t *p_mouse,
         float f_dx = (float)i_dx / i_width;
         float f_dy = (float)i_dy / i_height;
 
-        int i_x_idx = drag * 2;
-        int i_y_idx = drag * 2 + 1;
-
-        vlc_atomic_float *pf_all[] = {
-            &p_sys->f_tl_x, &p_sys->f_tl_y,
-            &p_sys->f_tr_x, &p_sys->f_tr_y,
-            &p_sys->f_bl_x, &p_sys->f_bl_y,
-            &p_sys->f_br_x, &p_sys->f_br_y,
-        };
+        vlc_atomic_float *pf_offsets = drag < 4 ? &p_sys->pf_corners[0]
+                                                : &p_sys->pf_mesh[0];
+        int i_x_idx = ( drag < 4 ? drag : drag - 4 ) * 2;
+        int i_y_idx = i_x_idx + 1;
 
-        float new_x = vlc_atomic_load_float( pf_all[i_x_idx] ) + f_dx;
-        float new_y = vlc_atomic_load_float( pf_all[i_y_idx] ) + f_dy;
+        /* From the current values, a callback may have moved them */
+        LockCorners( p_sys );
+        float new_x = vlc_atomic_load_float( &pf_offsets[i_x_idx] ) + f_dx;
+        float new_y = vlc_atomic_load_float( &pf_offsets[i_y_idx] ) + f_dy;
 
         /* Clamp to range */
         if( new_x < -1.f ) new_x = -1.f;
@@ -723,15 +6797,20 @@ static int Mouse( filter_t *p_filter, vlc_mouse_t *p_mouse,
         if( new_y < -1.f ) new_y = -1.f;
         if( new_y >  1.f ) new_y =  1.f;
 
-        vlc_atomic_store_float( pf_all[i_x_idx], new_x );
-        vlc_atomic_store_float( pf_all[i_y_idx], new_y );
+        vlc_atomic_store_float( &pf_offsets[i_x_idx], new_x );
+        vlc_atomic_store_float( &pf_offsets[i_y_idx], new_y );
+        UnlockCorners( p_sys );
 
-        /* Persist to parent for filter recreation */
-        var_SetFloat( p_filter->obj.parent,
-                      ppsz_corner_vars[i_x_idx], new_x );
-        var_SetFloat( p_filter->obj.parent,
-                      ppsz_corner_vars[i_y_idx], new_y );
+        /* Persist to parent for filter recreation, at a lower rate */
+        if( !p_sys->b_persist )
+        {
+            p_sys->b_persist = true;
+            p_sys->i_persist_time = mdate();
+        }
+        else if( mdate() - p_sys->i_persist_time >= PERSIST_PERIOD )
+            PersistCorners( p_filter );
 
+        UpdateOverlay( p_filter );
         return VLC_EGENERIC;
     }
 
@@ -739,24 +6818,21 @@ static int Mouse( filter_t *p_filter, vlc_mouse_t *p_mouse,
     if( vlc_mouse_HasReleased( p_old, p_new, MOUSE_BUTTON_LEFT ) && drag >= 0 )
     {
         atomic_store( &p_sys->i_drag_corner, -1 );
+        if( p_sys->b_persist )
+            PersistCorners( p_filter );
+        UpdateOverlay( p_filter );
         return VLC_EGENERIC;
     }
 
-    /* Hover detection: highlight corner closest to cursor */
+    /* Hover detection: highlight handle closest to cursor */
     {
         int best_hover = -1;
         int best_dist = HANDLE_SIZE * HANDLE_SIZE * 4;
 
-        for( int c = 0; c < 4; c++ )
+        for( int c = 0; c < i_handles; c++ )
         {
-            int hx, hy;
-            GetCornerPixelPos( c, i_width, i_height,
-                               f_tl_x, f_tl_y, f_tr_x, f_tr_y,
-                               f_bl_x, f_bl_y, f_br_x, f_br_y,
-                               &hx, &hy );
-
-            int ddx = p_new->i_x - hx;
-            int ddy = p_new->i_y - hy;
+            int ddx = p_new->i_x - pi_x[c];
+            int ddy = p_new->i_y - pi_y[c];
             int dist = ddx * ddx + ddy * ddy;
 
             if( dist < best_dist )
@@ -767,10 +6843,20 @@ static int Mouse( filter_t *p_filter, vlc_mouse_t *p_mouse,
         }
 
         atomic_store( &p_sys->i_hover_corner, best_hover );
+        UpdateOverlay( p_filter );
     }
 
-    /* No interaction: propagate mouse event */
+    /* No interaction: propagate mouse event, in source coordinates */
     *p_mouse = *p_new;
+    const video_format_t *p_src_fmt = &p_filter->fmt_in.video;
+    if( p_src_fmt->i_visible_width != (unsigned)i_width
+     || p_src_fmt->i_visible_height != (unsigned)i_height )
+    {
+        p_mouse->i_x = (int64_t)p_new->i_x * p_src_fmt->i_visible_width
+                     / i_width;
+        p_mouse->i_y = (int64_t)p_new->i_y * p_src_fmt->i_visible_height
+                     / i_height;
+    }
     return VLC_SUCCESS;
 }
 
@@ -781,25 +6867,36 @@ static int KeystoneCallback( vlc_object_t *p_this, char const *psz_var,
                              vlc_value_t oldval, vlc_value_t newval,
                              void *p_data )
 {
-    VLC_UNUSED( p_this ); VLC_UNUSED( oldval );
+    VLC_UNUSED( oldval );
     filter_sys_t *p_sys = (filter_sys_t *)p_data;
 
-    if( !strcmp( psz_var, FILTER_PREFIX "tl-x" ) )
-        vlc_atomic_store_float( &p_sys->f_tl_x, newval.f_float );
-    else if( !strcmp( psz_var, FILTER_PREFIX "tl-y" ) )
-        vlc_atomic_store_float( &p_sys->f_tl_y, newval.f_float );
-    else if( !strcmp( psz_var, FILTER_PREFIX "tr-x" ) )
-        vlc_atomic_store_float( &p_sys->f_tr_x, newval.f_float );
-    else if( !strcmp( psz_var, FILTER_PREFIX "tr-y" ) )
-        vlc_atomic_store_float( &p_sys->f_tr_y, newval.f_float );
-    else if( !strcmp( psz_var, FILTER_PREFIX "bl-x" ) )
-        vlc_atomic_store_float( &p_sys->f_bl_x, newval.f_float );
-    else if( !strcmp( psz_var, FILTER_PREFIX "bl-y" ) )
-        vlc_atomic_store_float( &p_sys->f_bl_y, newval.f_float );
-    else if( !strcmp( psz_var, FILTER_PREFIX "br-x" ) )
-        vlc_atomic_store_float( &p_sys->f_br_x, newval.f_float );
-    else if( !strcmp( psz_var, FILTER_PREFIX "br-y" ) )
-        vlc_atomic_store_float( &p_sys->f_br_y, newval.f_float );
+    if( !strcmp( psz_var, FILTER_PREFIX "mesh-points" ) )
+    {
+        /* An empty value flattens the mesh, an invalid one is ignored */
+        float pf_mesh[2 * MESH_POINTS];
+        if( !ParseMesh( pf_mesh, p_sys->i_mesh_cols, p_sys->i_mesh_rows,
+                        newval.psz_string )
+         && newval.psz_string && *newval.psz_string )
+        {
+            msg_Warn( p_this, "ignoring the mesh points, need %d offsets",
+                      2 * p_sys->i_mesh_cols * p_sys->i_mesh_rows );
+            return VLC_EGENERIC;
+        }
+
+        LockCorners( p_sys );
+        for( int i = 0; i < 2 * p_sys->i_mesh_cols * p_sys->i_mesh_rows; i++ )
+            vlc_atomic_store_float( &p_sys->pf_mesh[i], pf_mesh[i] );
+        UnlockCorners( p_sys );
+        return VLC_SUCCESS;
+    }
+
+    for( int i = 0; i < 8; i++ )
+        if( !strcmp( psz_var, ppsz_corner_vars[i] ) )
+        {
+            LockCorners( p_sys );
+            vlc_atomic_store_float( &p_sys->pf_corners[i], newval.f_float );
+            UnlockCorners( p_sys );
+        }
 
     return VLC_SUCCESS;
 }
@@ -0,0 +1,674 @@
+/*****************************************************************************
+ * keystone_bench.c: standalone benchmark of the keystone warp
+ *****************************************************************************
+ * Builds src/keystone.c against the VLC stand-in of vlcshim/, feeds it
+ * synthetic pictures and prints one CSV line per measurement on stdout:
+ *
+ *  - "homography": ComputeHomography(), in ns per call (ns_pixel column)
+ *  - "reference": RenderPlane() on one thread, the straightforward per
+ *    pixel evaluation every other path must match
+ *  - "exact", "fast", "nearest", "bicubic", "lanczos": the whole Filter()
+ *    path with the matching quality and interpolation options, the first
+ *    picture (first_ms) including the build of the warp maps
+ *
+ * The working set (source, destination and warp maps, in MB) and its ratio
+ * to the last level cache tell whether a run streams from memory; --cold
+ * evicts the caches before every timed picture.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *****************************************************************************/
+
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/keystone.c"
+#include "vlcshim.h"
+
+/*****************************************************************************
+ * Configurations
+ *****************************************************************************/
+static const struct
+{
+    const char *psz_name;
+    int i_width, i_height;
+} resolutions[] = {
+    { "720p",  1280,  720 },
+    { "1080p", 1920, 1080 },
+    { "1440p", 2560, 1440 },
+    { "4k",    3840, 2160 },
+    { "8k",    7680, 4320 },
+};
+
+static const struct
+{
+    const char *psz_name;
+    vlc_fourcc_t i_chroma;
+} chromas[] = {
+    { "i420",    VLC_CODEC_I420 },
+    { "yv12",    VLC_CODEC_YV12 },
+    { "i422",    VLC_CODEC_I422 },
+    { "i444",    VLC_CODEC_I444 },
+    { "yuva",    VLC_CODEC_YUVA },
+    { "i420-9",  VLC_CODEC_I420_9L },
+    { "i420-10", VLC_CODEC_I420_10L },
+    { "i444-10", VLC_CODEC_I444_10L },
+    { "nv12",    VLC_CODEC_NV12 },
+    { "nv21",    VLC_CODEC_NV21 },
+    { "yuyv",    VLC_CODEC_YUYV },
+    { "uyvy",    VLC_CODEC_UYVY },
+    { "rgb24",   VLC_CODEC_RGB24 },
+    { "rgb32",   VLC_CODEC_RGB32 },
+    { "rgba",    VLC_CODEC_RGBA },
+};
+
+/* Corner offsets, tl-x, tl-y, tr-x, tr-y, bl-x, bl-y, br-x, br-y, from the
+ * cheapest transform to the strongest perspective */
+static const struct
+{
+    const char *psz_name;
+    float pf_corners[8];
+} scenarios[] = {
+    /* Whole pixel shift at the usual sizes, chroma planes included */
+    { "shift",   { 0.0625f, 0.25f, 0.0625f, 0.25f,
+                   0.0625f, 0.25f, 0.0625f, 0.25f } },
+    /* Vertical keystone: horizontal top and bottom edges */
+    { "rows",    { 0.1f, 0.f, -0.1f, 0.f, 0.f, 0.f, 0.f, 0.f } },
+    /* Parallelogram, binary fractions so that the sides stay parallel */
+    { "affine",  { 0.0625f, 0.03125f, 0.0625f, -0.03125f,
+                   -0.0625f, 0.03125f, -0.0625f, -0.03125f } },
+    { "mild",    { 0.02f, 0.01f, -0.015f, 0.02f,
+                   0.01f, -0.02f, -0.02f, -0.01f } },
+    { "strong",  { 0.1f, 0.05f, -0.08f, 0.02f,
+                   0.03f, -0.04f, -0.1f, -0.06f } },
+    { "extreme", { 0.35f, 0.1f, -0.35f, 0.05f,
+                   -0.05f, 0.f, 0.1f, -0.05f } },
+    /* Projector rolled by a few tens of degrees: each output row crosses
+     * hundreds of source rows */
+    { "steep",   { 0.05f, 0.3f, -0.1f, -0.25f,
+                   0.1f, 0.2f, -0.05f, -0.3f } },
+};
+
+static const struct
+{
+    const char *psz_name;
+    const char *psz_quality;    /* NULL: not through Filter() */
+    const char *psz_interp;
+} variants[] = {
+    { "homography", NULL,    NULL },
+    { "reference",  NULL,    NULL },
+    { "exact",      "exact", "bilinear" },
+    { "fast",       "fast",  "bilinear" },
+    { "nearest",    "exact", "nearest" },
+    { "bicubic",    "exact", "bicubic" },
+    { "lanczos",    "exact", "lanczos" },
+};
+
+static const char *const ppsz_transforms[] = {
+    "translate", "rows", "affine", "perspective" };
+
+#define MAX_LIST 32
+
+typedef struct
+{
+    int  pi_res[MAX_LIST][2];
+    int  i_res;
+    int  pi_chromas[MAX_LIST];
+    int  i_chromas;
+    int  pi_scenarios[MAX_LIST];
+    int  i_scenarios;
+    int  pi_variants[MAX_LIST];
+    int  i_variants;
+    int  pi_threads[MAX_LIST];
+    int  i_threads;
+    int  i_frames;
+    bool b_cold;
+} bench_t;
+
+typedef struct
+{
+    double f_first_ms;      /* < 0: not measured */
+    double f_min_ms, f_median_ms;
+    double f_working_set;   /* Bytes */
+    const char *psz_transform;
+} result_t;
+
+static size_t i_llc_size;
+static uint8_t *p_flush;
+static size_t i_flush_size;
+
+/*****************************************************************************
+ * Helpers
+ *****************************************************************************/
+static double Now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int CompareDouble( const void *a, const void *b )
+{
+    const double x = *(const double *)a, y = *(const double *)b;
+    return ( x > y ) - ( x < y );
+}
+
+static double Median( double *p_values, int i_count )
+{
+    qsort( p_values, i_count, sizeof( *p_values ), CompareDouble );
+    return i_count % 2 ? p_values[i_count / 2]
+                       : ( p_values[i_count / 2 - 1]
+                         + p_values[i_count / 2] ) / 2.;
+}
+
+/* Evict the source, destination and maps from the caches */
+static void FlushCaches( void )
+{
+    for( size_t i = 0; i < i_flush_size; i += 64 )
+        p_flush[i]++;
+}
+
+static size_t GetLLCSize( void )
+{
+    long i_size = -1;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    i_size = sysconf( _SC_LEVEL3_CACHE_SIZE );
+    if( i_size <= 0 )
+        i_size = sysconf( _SC_LEVEL2_CACHE_SIZE );
+#endif
+    return i_size > 0 ? (size_t)i_size : 0;
+}
+
+static size_t GetPictureSize( const picture_t *p_pic )
+{
+    size_t i_size = 0;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        i_size += (size_t)p_pic->p[i].i_visible_pitch
+                * p_pic->p[i].i_visible_lines;
+    return i_size;
+}
+
+static size_t GetCacheSize( const filter_sys_t *p_sys )
+{
+    size_t i_size = 0;
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        const warp_map_t *p_map = &p_sys->maps[i];
+        const warp_grid_t *p_grid = &p_sys->grids[i];
+
+        if( p_sys->pi_mode[i] == RENDER_MAP )
+            i_size += p_map->i_entries * sizeof( warp_entry_t )
+                    + p_map->i_rows * sizeof( warp_row_t );
+        else if( p_sys->pi_mode[i] == RENDER_FAST )
+            i_size += p_grid->i_points * 2 * sizeof( int32_t )
+                    + p_grid->i_tiles;
+    }
+    return i_size;
+}
+
+static int ResolveThreads( int i_threads )
+{
+    return i_threads > 0 ? i_threads
+                         : (int)__MIN( vlc_GetCPUCount(), MAX_THREADS );
+}
+
+static void InitFormat( video_format_t *p_fmt, vlc_fourcc_t i_chroma,
+                        int i_width, int i_height )
+{
+    video_format_Init( p_fmt, i_chroma );
+    p_fmt->i_width  = p_fmt->i_visible_width  = i_width;
+    p_fmt->i_height = p_fmt->i_visible_height = i_height;
+    p_fmt->i_sar_num = p_fmt->i_sar_den = 1;
+    video_format_FixRgb( p_fmt );
+}
+
+/* Detailed content, so that no path can take a shortcut on flat areas */
+static void FillPicture( picture_t *p_pic )
+{
+    uint32_t i_seed = 0x12345678;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x < p->i_pitch; x++ )
+            {
+                i_seed = i_seed * 1664525 + 1013904223;
+                p->p_pixels[y * p->i_pitch + x] =
+                    ( ( x + y ) & 0xff ) ^ ( i_seed >> 28 );
+            }
+    }
+}
+
+static void SetCorners( const float pf_corners[8] )
+{
+    for( int i = 0; i < 8; i++ )
+    {
+        char psz[32];
+        snprintf( psz, sizeof( psz ), "%.9g", pf_corners[i] );
+        shim_SetOption( ppsz_corner_vars[i], psz );
+    }
+}
+
+/*****************************************************************************
+ * Measurements
+ *****************************************************************************/
+static double BenchHomography( const float pf_corners[8],
+                               int i_width, int i_height )
+{
+    /* Same system as UpdateRenderCache(), solved until 10 ms went by */
+    const double dx0 = pf_corners[0] * i_width;
+    const double dy0 = pf_corners[1] * i_height;
+    const double dx1 = ( i_width - 1 ) + pf_corners[2] * i_width;
+    const double dy1 = pf_corners[3] * i_height;
+    const double dx2 = pf_corners[4] * i_width;
+    const double dy2 = ( i_height - 1 ) + pf_corners[5] * i_height;
+    const double dx3 = ( i_width - 1 ) + pf_corners[6] * i_width;
+    const double dy3 = ( i_height - 1 ) + pf_corners[7] * i_height;
+    volatile double f_sink = 0.;
+    double f_best = 1e9;
+
+    for( int r = 0; r < 5; r++ )
+    {
+        int i_calls = 0;
+        const double f_start = Now();
+        double f_elapsed;
+        do
+        {
+            double h[8];
+            for( int k = 0; k < 1000; k++ )
+            {
+                ComputeHomography( h, 0., 0., dx0, dy0,
+                                   i_width - 1., 0., dx1, dy1,
+                                   0., i_height - 1., dx2, dy2,
+                                   i_width - 1., i_height - 1., dx3, dy3 );
+                f_sink += h[k & 7];
+            }
+            i_calls += 1000;
+            f_elapsed = Now() - f_start;
+        } while( f_elapsed < 0.01 );
+        f_best = __MIN( f_best, f_elapsed / i_calls );
+    }
+    (void)f_sink;
+    return f_best * 1e9;
+}
+
+static int BenchPicture( const bench_t *p_bench, int v, vlc_fourcc_t i_chroma,
+                         int i_width, int i_height, const float pf_corners[8],
+                         int i_threads, result_t *p_result )
+{
+    video_format_t fmt;
+    InitFormat( &fmt, i_chroma, i_width, i_height );
+
+    const bool b_reference = variants[v].psz_quality == NULL;
+    char psz_threads[16];
+    snprintf( psz_threads, sizeof( psz_threads ), "%d",
+              b_reference ? 1 : i_threads );
+    shim_ClearOptions();
+    SetCorners( pf_corners );
+    shim_SetOption( FILTER_PREFIX "threads", psz_threads );
+    shim_SetOption( FILTER_PREFIX "show-handles", "0" );
+    shim_SetOption( FILTER_PREFIX "quality", variants[v].psz_quality );
+    shim_SetOption( FILTER_PREFIX "interp", variants[v].psz_interp );
+
+    filter_t *p_filter = shim_NewFilter( Create, &fmt );
+    if( !p_filter )
+        return VLC_EGENERIC;
+    filter_sys_t *p_sys = p_filter->p_sys;
+
+    picture_t *p_src = picture_NewFromFormat( &fmt );
+    picture_t *p_dst = b_reference ? picture_NewFromFormat( &fmt ) : NULL;
+    double *pf_times = malloc( p_bench->i_frames * sizeof( *pf_times ) );
+    if( !p_src || ( b_reference && !p_dst ) || !pf_times )
+    {
+        if( p_src )
+            picture_Release( p_src );
+        if( p_dst )
+            picture_Release( p_dst );
+        free( pf_times );
+        shim_DeleteFilter( p_filter, Destroy );
+        return VLC_ENOMEM;
+    }
+    FillPicture( p_src );
+
+    size_t i_cache = 0;
+    p_result->f_first_ms = -1.;
+    if( b_reference )
+    {
+        UpdateRenderCache( p_sys, pf_corners, NULL, i_width, i_height,
+                           i_width, i_height );
+        for( int f = 0; f < p_bench->i_frames; f++ )
+        {
+            if( p_bench->b_cold )
+                FlushCaches();
+            const double f_start = Now();
+            for( int i = 0; i < p_sys->i_components; i++ )
+            {
+                const warp_component_t *p_comp = &p_sys->components[i];
+                plane_t *p_plane = &p_dst->p[p_comp->i_plane];
+                RenderPlane( &p_src->p[p_comp->i_plane], p_plane,
+                             i_width, i_height, p_sys->h, p_comp,
+                             0, p_plane->i_visible_lines );
+            }
+            pf_times[f] = ( Now() - f_start ) * 1e3;
+        }
+    }
+    else
+    {
+        /* The first picture builds the maps or grids */
+        double f_start = Now();
+        picture_t *p_out = Filter( p_filter, picture_Hold( p_src ) );
+        p_result->f_first_ms = ( Now() - f_start ) * 1e3;
+        if( p_out )
+            picture_Release( p_out );
+
+        for( int f = 0; f < p_bench->i_frames; f++ )
+        {
+            if( p_bench->b_cold )
+                FlushCaches();
+            f_start = Now();
+            p_out = Filter( p_filter, picture_Hold( p_src ) );
+            pf_times[f] = ( Now() - f_start ) * 1e3;
+            if( p_out )
+                picture_Release( p_out );
+        }
+        i_cache = GetCacheSize( p_sys );
+    }
+
+    p_result->f_min_ms = pf_times[0];
+    for( int f = 1; f < p_bench->i_frames; f++ )
+        p_result->f_min_ms = __MIN( p_result->f_min_ms, pf_times[f] );
+    p_result->f_median_ms = Median( pf_times, p_bench->i_frames );
+    p_result->f_working_set = 2. * GetPictureSize( p_src ) + i_cache;
+    p_result->psz_transform = p_sys->b_homography
+                            ? ppsz_transforms[p_sys->i_transform] : "none";
+
+    free( pf_times );
+    if( p_dst )
+        picture_Release( p_dst );
+    picture_Release( p_src );
+    shim_DeleteFilter( p_filter, Destroy );
+    return VLC_SUCCESS;
+}
+
+/*****************************************************************************
+ * Command line
+ *****************************************************************************/
+static void Usage( const char *psz_program )
+{
+    fprintf( stderr,
+"Usage: %s [options] > results.csv\n"
+"  -r, --res LIST        resolutions: 720p, 1080p, 1440p, 4k, 8k or WxH\n"
+"                        (default 720p,1080p,4k,8k)\n"
+"  -c, --chroma LIST     i420, yv12, i422, i444, yuva, i420-9, i420-10,\n"
+"                        i444-10, nv12, nv21, yuyv, uyvy, rgb24, rgb32, rgba\n"
+"                        (default i420,nv12,yuyv,rgb32)\n"
+"  -s, --scenario LIST   shift, rows, affine, mild, strong, extreme,\n"
+"                        steep\n"
+"                        (default all)\n"
+"  -v, --variant LIST    homography, reference, exact, fast, nearest,\n"
+"                        bicubic, lanczos (default all)\n"
+"  -t, --threads LIST    rendering threads of the filter, 0 = one per CPU\n"
+"                        (default 1,0)\n"
+"  -n, --frames N        timed pictures per measurement (default 20)\n"
+"      --cold            evict the caches before every timed picture\n"
+"  -V, --verbose         print the filter messages\n"
+"  -h, --help            this help\n", psz_program );
+}
+
+/* Splits a comma separated list, pf_parse returning false on bad items */
+static bool ParseList( char *psz_list, bool (*pf_parse)( const char *, void * ),
+                       void *p_data )
+{
+    for( char *psz_save, *psz = strtok_r( psz_list, ",", &psz_save ); psz;
+         psz = strtok_r( NULL, ",", &psz_save ) )
+        if( !pf_parse( psz, p_data ) )
+        {
+            fprintf( stderr, "unknown or too many values: %s\n", psz );
+            return false;
+        }
+    return true;
+}
+
+#define LOOKUP( table, list, count ) do { \
+    if( p_bench->count == MAX_LIST ) \
+        return false; \
+    for( size_t i = 0; i < ARRAY_SIZE( table ); i++ ) \
+        if( !strcmp( psz, table[i].psz_name ) ) \
+        { \
+            p_bench->list[p_bench->count++] = i; \
+            return true; \
+        } \
+    return false; \
+} while( 0 )
+
+static bool ParseChroma( const char *psz, void *p_data )
+{
+    bench_t *p_bench = p_data;
+    LOOKUP( chromas, pi_chromas, i_chromas );
+}
+
+static bool ParseScenario( const char *psz, void *p_data )
+{
+    bench_t *p_bench = p_data;
+    LOOKUP( scenarios, pi_scenarios, i_scenarios );
+}
+
+static bool ParseVariant( const char *psz, void *p_data )
+{
+    bench_t *p_bench = p_data;
+    LOOKUP( variants, pi_variants, i_variants );
+}
+
+static bool ParseResolution( const char *psz, void *p_data )
+{
+    bench_t *p_bench = p_data;
+    int i_width, i_height;
+
+    if( p_bench->i_res == MAX_LIST )
+        return false;
+    for( size_t i = 0; i < ARRAY_SIZE( resolutions ); i++ )
+        if( !strcmp( psz, resolutions[i].psz_name ) )
+        {
+            p_bench->pi_res[p_bench->i_res][0] = resolutions[i].i_width;
+            p_bench->pi_res[p_bench->i_res++][1] = resolutions[i].i_height;
+            return true;
+        }
+    if( sscanf( psz, "%dx%d", &i_width, &i_height ) != 2
+     || i_width < 2 || i_height < 2 || i_width > 16384 || i_height > 16384 )
+        return false;
+    p_bench->pi_res[p_bench->i_res][0] = i_width;
+    p_bench->pi_res[p_bench->i_res++][1] = i_height;
+    return true;
+}
+
+static bool ParseThreads( const char *psz, void *p_data )
+{
+    bench_t *p_bench = p_data;
+    char *psz_end;
+    long i_threads = strtol( psz, &psz_end, 10 );
+
+    if( p_bench->i_threads == MAX_LIST || *psz_end
+     || i_threads < 0 || i_threads > MAX_THREADS )
+        return false;
+    p_bench->pi_threads[p_bench->i_threads++] = i_threads;
+    return true;
+}
+
+int main( int argc, char **argv )
+{
+    static const struct option long_options[] = {
+        { "res",      required_argument, NULL, 'r' },
+        { "chroma",   required_argument, NULL, 'c' },
+        { "scenario", required_argument, NULL, 's' },
+        { "variant",  required_argument, NULL, 'v' },
+        { "threads",  required_argument, NULL, 't' },
+        { "frames",   required_argument, NULL, 'n' },
+        { "cold",     no_argument,       NULL, 'C' },
+        { "verbose",  no_argument,       NULL, 'V' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    bench_t bench = { .i_frames = 20 };
+    bool b_ok = true;
+    int c;
+
+    while( ( c = getopt_long( argc, argv, "r:c:s:v:t:n:Vh",
+                              long_options, NULL ) ) != -1 )
+    {
+        switch( c )
+        {
+            case 'r': b_ok &= ParseList( optarg, ParseResolution, &bench ); break;
+            case 'c': b_ok &= ParseList( optarg, ParseChroma, &bench );     break;
+            case 's': b_ok &= ParseList( optarg, ParseScenario, &bench );   break;
+            case 'v': b_ok &= ParseList( optarg, ParseVariant, &bench );    break;
+            case 't': b_ok &= ParseList( optarg, ParseThreads, &bench );    break;
+            case 'n':
+                bench.i_frames = atoi( optarg );
+                b_ok &= bench.i_frames > 0;
+                break;
+            case 'C': bench.b_cold = true;     break;
+            case 'V': shim_SetVerbose( true ); break;
+            case 'h':
+                Usage( argv[0] );
+                return 0;
+            default:
+                b_ok = false;
+                break;
+        }
+    }
+    if( !b_ok || optind < argc )
+    {
+        Usage( argv[0] );
+        return 1;
+    }
+
+    /* Defaults */
+    if( !bench.i_res )
+    {
+        char psz[] = "720p,1080p,4k,8k";
+        ParseList( psz, ParseResolution, &bench );
+    }
+    if( !bench.i_chromas )
+    {
+        char psz[] = "i420,nv12,yuyv,rgb32";
+        ParseList( psz, ParseChroma, &bench );
+    }
+    for( size_t i = 0; !bench.i_scenarios && i < ARRAY_SIZE( scenarios ); i++ )
+        bench.pi_scenarios[i] = i;
+    if( !bench.i_scenarios )
+        bench.i_scenarios = ARRAY_SIZE( scenarios );
+    for( size_t i = 0; !bench.i_variants && i < ARRAY_SIZE( variants ); i++ )
+        bench.pi_variants[i] = i;
+    if( !bench.i_variants )
+        bench.i_variants = ARRAY_SIZE( variants );
+    if( !bench.i_threads )
+    {
+        bench.pi_threads[bench.i_threads++] = 1;
+        bench.pi_threads[bench.i_threads++] = 0;
+    }
+
+    vlc_module_defaults();
+    i_llc_size = GetLLCSize();
+    if( bench.b_cold )
+    {
+        i_flush_size = i_llc_size ? 2 * i_llc_size : 64 << 20;
+        p_flush = calloc( 1, i_flush_size );
+        if( !p_flush )
+            return 1;
+    }
+
+    printf( "variant,chroma,width,height,scenario,transform,threads,frames,"
+            "first_ms,min_ms,median_ms,mpix_s,ns_pixel,bytes_pixel,"
+            "working_set_mb,llc_ratio,cold\n" );
+
+    for( int r = 0; r < bench.i_res; r++ )
+    {
+        const int i_width = bench.pi_res[r][0], i_height = bench.pi_res[r][1];
+        const double f_pixels = (double)i_width * i_height;
+
+        for( int s = 0; s < bench.i_scenarios; s++ )
+        {
+            const int i_scenario = bench.pi_scenarios[s];
+            const float *pf_corners = scenarios[i_scenario].pf_corners;
+
+            for( int k = 0; k < bench.i_variants; k++ )
+            {
+                const int v = bench.pi_variants[k];
+                if( strcmp( variants[v].psz_name, "homography" ) )
+                    continue;
+                fprintf( stderr, "%dx%d %s %s\n", i_width, i_height,
+                         scenarios[i_scenario].psz_name, variants[v].psz_name );
+                printf( "homography,,%d,%d,%s,,1,,,,,,%.1f,,,,\n",
+                        i_width, i_height, scenarios[i_scenario].psz_name,
+                        BenchHomography( pf_corners, i_width, i_height ) );
+            }
+
+            for( int ch = 0; ch < bench.i_chromas; ch++ )
+            for( int k = 0; k < bench.i_variants; k++ )
+            for( int t = 0; t < bench.i_threads; t++ )
+            {
+                const int i_chroma = bench.pi_chromas[ch];
+                const int v = bench.pi_variants[k];
+                int i_threads = bench.pi_threads[t];
+                if( !strcmp( variants[v].psz_name, "homography" ) )
+                    break;
+                if( !variants[v].psz_quality )
+                {
+                    /* Single threaded: run once */
+                    if( t > 0 )
+                        break;
+                    i_threads = 1;
+                }
+                else
+                {
+                    /* Skip the counts that resolve to an earlier one */
+                    bool b_done = false;
+                    i_threads = ResolveThreads( i_threads );
+                    for( int u = 0; u < t; u++ )
+                        b_done |= ResolveThreads( bench.pi_threads[u] )
+                               == i_threads;
+                    if( b_done )
+                        continue;
+                }
+
+                fprintf( stderr, "%dx%d %s %s %s, %d thread(s)\n",
+                         i_width, i_height, scenarios[i_scenario].psz_name,
+                         chromas[i_chroma].psz_name, variants[v].psz_name,
+                         i_threads );
+
+                result_t res;
+                if( BenchPicture( &bench, v, chromas[i_chroma].i_chroma,
+                                  i_width, i_height, pf_corners, i_threads,
+                                  &res ) )
+                {
+                    fprintf( stderr, "  failed\n" );
+                    continue;
+                }
+
+                printf( "%s,%s,%d,%d,%s,%s,%d,%d,",
+                        variants[v].psz_name, chromas[i_chroma].psz_name,
+                        i_width, i_height, scenarios[i_scenario].psz_name,
+                        res.psz_transform, i_threads, bench.i_frames );
+                if( res.f_first_ms >= 0. )
+                    printf( "%.3f", res.f_first_ms );
+                printf( ",%.3f,%.3f,%.1f,%.3f,%.2f,%.1f,",
+                        res.f_min_ms, res.f_median_ms,
+                        f_pixels / ( res.f_median_ms * 1e3 ),
+                        res.f_median_ms * 1e6 / f_pixels,
+                        res.f_working_set / f_pixels,
+                        res.f_working_set / ( 1 << 20 ) );
+                if( i_llc_size )
+                    printf( "%.2f", res.f_working_set / i_llc_size );
+                printf( ",%d\n", bench.b_cold );
+                fflush( stdout );
+            }
+        }
+    }
+
+    free( p_flush );
+    shim_ClearOptions();
+    return 0;
+}
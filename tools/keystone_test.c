@@ -0,0 +1,1037 @@
+/*****************************************************************************
+ * keystone_test.c: differential tests of the keystone renderers
+ *****************************************************************************
+ * Builds src/keystone.c against the VLC stand-in of vlcshim/ and renders
+ * random and adversarial cases with every variant: the maps (with and
+ * without the SIMD interiors), the row and translation renderers, the
+ * kernel maps, the mesh maps, the fast mode, and the whole Filter() path
+ * with several threads, and with soft edges. The maps run with the
+ * interior kernels of every instruction set that the CPU supports. Each
+ * is compared with the plain per pixel renderer of its interpolation,
+ * RenderPlane() for bilinear and RenderPlaneKernel() for the others:
+ *
+ *  - exact variants must match it bit for bit, any difference fails
+ *  - the row renderer steps its positions in fixed point rather than in
+ *    doubles, and may round a weight the other way: it, and Filter() that
+ *    uses it, may differ by one weight step, 1/256 of the sample range
+ *  - so may the whole pixel copies of RenderPlaneTranslate(), where the
+ *    stepped doubles of the reference land a hair short of a pixel
+ *  - the maps of a mesh without offsets invert the bilinear patches of its
+ *    cells rather than step the homography: affine transforms only, where
+ *    the patches are the parallelograms of the homography, and one weight
+ *    step on each axis
+ *  - the soft edges of Filter(), faded in the rows just rendered, are
+ *    compared with the whole reference faded afterwards
+ *  - approximate variants (fast) report their largest and mean error, and
+ *    fail if a position stepped through their grid strays further from
+ *    the transform than their tolerance
+ *
+ * The adversarial cases cover homographies whose denominator nearly
+ * vanishes or changes sign in the picture, corners far outside of it,
+ * and sources of one or two pixels. Exits with 1 if a variant differed
+ * by more than its tolerance.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *****************************************************************************/
+
+#include <ctype.h>
+#include <getopt.h>
+
+#include "../src/keystone.c"
+#include "vlcshim.h"
+
+/*****************************************************************************
+ * Cases
+ *****************************************************************************/
+static const vlc_fourcc_t pi_chromas[] = {
+    VLC_CODEC_I420, VLC_CODEC_YV12, VLC_CODEC_I422, VLC_CODEC_I444,
+    VLC_CODEC_I410, VLC_CODEC_I411, VLC_CODEC_YUVA,
+    VLC_CODEC_I420_9L, VLC_CODEC_I420_10L, VLC_CODEC_I420_10B,
+    VLC_CODEC_I444_10L, VLC_CODEC_NV12, VLC_CODEC_NV21,
+    VLC_CODEC_YUYV, VLC_CODEC_UYVY, VLC_CODEC_YVYU, VLC_CODEC_VYUY,
+    VLC_CODEC_RGB24, VLC_CODEC_RGB32, VLC_CODEC_RGBA,
+};
+
+enum
+{
+    CASE_RANDOM,    /* Mild to strong perspective */
+    CASE_OUTSIDE,   /* Corners anywhere in the option range */
+    CASE_SHIFT,     /* Whole pixel translation */
+    CASE_ROWS,      /* Horizontal top and bottom edges */
+    CASE_AFFINE,    /* Parallelogram */
+    CASE_COLLAPSE,  /* Two corners almost on top of each other */
+    CASE_COLLINEAR, /* Three corners almost aligned */
+    CASE_CROSSED,   /* Self-intersecting quad: den changes sign */
+    CASE_TINY,      /* 1 or 2 pixel wide or high source */
+    CASE_COUNT
+};
+
+static const char *const ppsz_cases[CASE_COUNT] = {
+    "random", "outside", "shift", "rows", "affine",
+    "collapse", "collinear", "crossed", "tiny",
+};
+
+typedef struct
+{
+    int          i_kind;
+    vlc_fourcc_t i_chroma;
+    int          i_width, i_height;
+    float        pf_corners[8];
+} test_case_t;
+
+/*****************************************************************************
+ * Variants
+ *****************************************************************************/
+enum
+{
+    VARIANT_MAP,            /* BuildWarpMap() + RenderPlaneMap(), with the
+                             * interior kernels of each ISA_* */
+    VARIANT_MAP_LAST = VARIANT_MAP + ISA_COUNT - 1,
+    VARIANT_ROWS,           /* RenderPlaneRows(), rows transforms only */
+    VARIANT_TRANSLATE,      /* RenderPlaneTranslate(), whole pixel shifts */
+    VARIANT_MESH,           /* BuildMeshMap() of a flat mesh, affine only */
+    VARIANT_NEAREST,        /* Kernel map of each interpolation */
+    VARIANT_BICUBIC,
+    VARIANT_LANCZOS,
+    VARIANT_TILES,          /* RenderPlaneMapTiles() of a warp map */
+    VARIANT_TILES_BICUBIC,  /* and of a kernel map */
+    VARIANT_FAST,           /* BuildWarpGrid() + RenderPlaneFast() */
+    VARIANT_FILTER,         /* Filter(), 1 thread */
+    VARIANT_FILTER_MT,      /* Filter(), 3 threads */
+    VARIANT_FILTER_BICUBIC,
+    VARIANT_FILTER_LANCZOS,
+    VARIANT_FILTER_FAST,
+    VARIANT_FILTER_EDGES,   /* Filter() with soft edges */
+    VARIANT_FILTER_SCALED,  /* Filter() to another output size */
+    VARIANT_COUNT
+};
+
+static const struct
+{
+    const char *psz_name;
+    int  i_tolerance;       /* Weight steps allowed, -1 for any error
+                             * (the positions of fast are checked) */
+    int  i_interp;          /* Reference interpolation */
+    const char *psz_quality; /* Filter() variants only */
+    int  i_threads;
+    bool b_edges;           /* Soft edges, applied to the reference too */
+    bool b_scaled;          /* Output size of GetScaledSize() */
+} variants[VARIANT_COUNT] = {
+    [VARIANT_MAP ... VARIANT_MAP_LAST] = { NULL, 0, INTERP_BILINEAR, NULL, 0 },
+    [VARIANT_MAP_LAST + 1] =
+    { "rows",            1, INTERP_BILINEAR, NULL, 0 },
+    { "translate",       1, INTERP_BILINEAR, NULL, 0 },
+    { "mesh",            2, INTERP_BILINEAR, NULL, 0 },
+    { "nearest",         0, INTERP_NEAREST,  NULL, 0 },
+    { "bicubic",         0, INTERP_BICUBIC,  NULL, 0 },
+    { "lanczos",         0, INTERP_LANCZOS,  NULL, 0 },
+    { "tiles",           0, INTERP_BILINEAR, NULL, 0 },
+    { "tiles-bicubic",   0, INTERP_BICUBIC,  NULL, 0 },
+    { "fast",           -1, INTERP_BILINEAR, NULL, 0 },
+    { "filter",          1, INTERP_BILINEAR, "exact", 1 },
+    { "filter-mt",       1, INTERP_BILINEAR, "exact", 3 },
+    { "filter-bicubic",  0, INTERP_BICUBIC,  "exact", 3 },
+    { "filter-lanczos",  0, INTERP_LANCZOS,  "exact", 3 },
+    { "filter-fast",    -1, INTERP_BILINEAR, "fast",  3 },
+    { "filter-edges",    1, INTERP_BILINEAR, "exact", 3, true },
+    { "filter-scaled",   1, INTERP_BILINEAR, "exact", 3, false, true },
+};
+
+typedef struct
+{
+    int      i_cases;           /* Compared */
+    int      i_failed;          /* With at least one differing sample */
+    int      i_beyond;          /* Differing by more than the tolerance */
+    uint64_t i_samples;
+    uint64_t i_differ;
+    unsigned i_max;
+    double   f_sum;
+} stats_t;
+
+/* Name of a variant, the maps being named after their instruction set */
+static const char *GetVariantName( int v )
+{
+    static char psz_names[ISA_COUNT][16];
+
+    if( variants[v].psz_name )
+        return variants[v].psz_name;
+
+    char *psz = psz_names[v - VARIANT_MAP];
+    snprintf( psz, sizeof( psz_names[0] ), "map-%s",
+              ppsz_isa_names[v - VARIANT_MAP] );
+    for( char *p = psz; *p; p++ )
+        *p = tolower( (unsigned char)*p );
+    return psz;
+}
+
+static uint64_t i_state;
+static bool b_verbose;
+static int i_isa;           /* Of the CPU */
+static int i_reported;
+
+/*****************************************************************************
+ * Random numbers (xorshift64*), reproducible from the seed
+ *****************************************************************************/
+static uint32_t Random( void )
+{
+    i_state ^= i_state >> 12;
+    i_state ^= i_state << 25;
+    i_state ^= i_state >> 27;
+    return ( i_state * UINT64_C(2685821657736338717) ) >> 32;
+}
+
+static int RandomInt( int i_min, int i_max )
+{
+    return i_min + Random() % (unsigned)( i_max - i_min + 1 );
+}
+
+static float RandomFloat( float f_range )
+{
+    return ( Random() / 4294967296.f * 2.f - 1.f ) * f_range;
+}
+
+/* Multiple of 1/64: sums of corners stay exact */
+static float RandomStep( void )
+{
+    return RandomInt( -8, 8 ) / 64.f;
+}
+
+/*****************************************************************************
+ * Case generation
+ *****************************************************************************/
+static void SetCorner( float *pf_corners, int i_corner, int i_width,
+                       int i_height, double x, double y )
+{
+    /* Offsets of a corner placed at (x, y), as in UpdateRenderCache() */
+    const double f_base_x = ( i_corner & 1 ) ? i_width - 1 : 0;
+    const double f_base_y = ( i_corner & 2 ) ? i_height - 1 : 0;
+    pf_corners[2 * i_corner]     = VLC_CLIP( ( x - f_base_x ) / i_width,
+                                             -1., 1. );
+    pf_corners[2 * i_corner + 1] = VLC_CLIP( ( y - f_base_y ) / i_height,
+                                             -1., 1. );
+}
+
+static void GetCorner( const float *pf_corners, int i_corner, int i_width,
+                       int i_height, double *px, double *py )
+{
+    *px = ( ( i_corner & 1 ) ? i_width - 1 : 0 )
+        + (double)pf_corners[2 * i_corner] * i_width;
+    *py = ( ( i_corner & 2 ) ? i_height - 1 : 0 )
+        + (double)pf_corners[2 * i_corner + 1] * i_height;
+}
+
+static void NewCase( test_case_t *p_case, int i_kind )
+{
+    float *c = p_case->pf_corners;
+
+    p_case->i_kind = i_kind;
+    p_case->i_chroma = pi_chromas[Random() % ARRAY_SIZE( pi_chromas )];
+    if( i_kind == CASE_TINY )
+    {
+        p_case->i_width  = RandomInt( 1, Random() % 2 ? 2 : 40 );
+        p_case->i_height = p_case->i_width > 2 ? RandomInt( 1, 2 )
+                                               : RandomInt( 1, 40 );
+    }
+    else if( Random() % 8 == 0 )
+    {
+        p_case->i_width  = RandomInt( 3, 16 );
+        p_case->i_height = RandomInt( 3, 16 );
+    }
+    else
+    {
+        p_case->i_width  = RandomInt( 16, 160 );
+        p_case->i_height = RandomInt( 16, 120 );
+    }
+    const int w = p_case->i_width, h = p_case->i_height;
+
+    for( int i = 0; i < 8; i++ )
+        c[i] = RandomFloat( 0.25f );
+
+    switch( i_kind )
+    {
+        case CASE_RANDOM:
+            if( Random() % 2 )
+                for( int i = 0; i < 8; i++ )
+                    c[i] = RandomFloat( 0.6f );
+            break;
+        case CASE_OUTSIDE:
+            for( int i = 0; i < 8; i++ )
+                c[i] = RandomFloat( 1.f );
+            break;
+        case CASE_SHIFT:
+        {
+            /* Whole luma pixels, even ones for the subsampled planes */
+            int i_dx = RandomInt( -w, w ) & ~3;
+            const int i_dy = RandomInt( -h, h ) & ~3;
+            if( !i_dx && !i_dy )
+                i_dx = 4;
+            for( int i = 0; i < 4; i++ )
+            {
+                c[2 * i]     = (float)i_dx / w;
+                c[2 * i + 1] = (float)i_dy / h;
+            }
+            break;
+        }
+        case CASE_ROWS:
+            c[3] = c[1];
+            c[7] = c[5];
+            break;
+        case CASE_AFFINE:
+            for( int i = 0; i < 6; i++ )
+                c[i] = RandomStep();
+            c[6] = c[2] + c[4] - c[0];
+            c[7] = c[3] + c[5] - c[1];
+            break;
+        case CASE_COLLAPSE:
+        {
+            /* One corner within a fraction of a pixel of another */
+            const int a = Random() % 4, b = ( a + 1 + Random() % 3 ) % 4;
+            double x, y;
+            GetCorner( c, b, w, h, &x, &y );
+            SetCorner( c, a, w, h, x + RandomFloat( 0.01f ),
+                       y + RandomFloat( 0.01f ) );
+            break;
+        }
+        case CASE_COLLINEAR:
+        {
+            /* One corner next to the line through two others */
+            const int a = Random() % 4;
+            const int b = ( a + 1 ) % 4, d = ( a + 2 ) % 4;
+            double xb, yb, xd, yd;
+            GetCorner( c, b, w, h, &xb, &yb );
+            GetCorner( c, d, w, h, &xd, &yd );
+            const double t = 0.5 + RandomFloat( 1.5f );
+            SetCorner( c, a, w, h, xb + t * ( xd - xb ) + RandomFloat( 0.05f ),
+                       yb + t * ( yd - yb ) + RandomFloat( 0.05f ) );
+            break;
+        }
+        case CASE_CROSSED:
+            /* Left and right corners of one edge swapped */
+            if( Random() % 2 )
+            {
+                c[0] = 1.f - RandomFloat( 0.1f ) * RandomFloat( 1.f );
+                c[2] = -1.f + RandomFloat( 0.1f ) * RandomFloat( 1.f );
+            }
+            else
+            {
+                c[5] = -1.f + RandomFloat( 0.1f ) * RandomFloat( 1.f );
+                c[1] = 1.f - RandomFloat( 0.1f ) * RandomFloat( 1.f );
+            }
+            for( int i = 0; i < 8; i++ )
+                c[i] = VLC_CLIP( c[i], -1.f, 1.f );
+            break;
+        case CASE_TINY:
+            for( int i = 0; i < 8; i++ )
+                c[i] = RandomFloat( 1.f );
+            break;
+    }
+}
+
+/*****************************************************************************
+ * Pictures
+ *****************************************************************************/
+static void InitFormat( video_format_t *p_fmt, const test_case_t *p_case )
+{
+    video_format_Init( p_fmt, p_case->i_chroma );
+    p_fmt->i_width  = p_fmt->i_visible_width  = p_case->i_width;
+    p_fmt->i_height = p_fmt->i_visible_height = p_case->i_height;
+    p_fmt->i_sar_num = p_fmt->i_sar_den = 1;
+    video_format_FixRgb( p_fmt );
+}
+
+/* Noise of the significant bits of the samples, margins included, so that
+ * reads outside of the source show up */
+static void FillRandom( const filter_sys_t *p_sys, picture_t *p_pic )
+{
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        const warp_component_t *p_comp = &p_sys->components[i];
+        plane_t *p = &p_pic->p[p_comp->i_plane];
+        const unsigned i_mask = ( 1u << p_comp->i_bits ) - 1;
+
+        for( int y = 0; y < p->i_lines; y++ )
+            for( int x = 0; x + p_comp->i_pixel_size <= p->i_pitch;
+                 x += p_comp->i_pixel_size )
+                for( int c = 0; c < p_comp->i_channels; c++ )
+                    PutSample( &p->p_pixels[y * p->i_pitch + x
+                                            + p_comp->pi_offset[c]],
+                               Random() & i_mask, p_comp );
+    }
+}
+
+static void FillPattern( picture_t *p_pic, uint8_t i_value )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        memset( p_pic->p[i].p_pixels, i_value,
+                (size_t)p_pic->p[i].i_pitch * p_pic->p[i].i_lines );
+}
+
+static void SetOptions( const test_case_t *p_case, const char *psz_quality,
+                        const char *psz_interp, int i_threads )
+{
+    char psz[32];
+
+    shim_ClearOptions();
+    for( int i = 0; i < 8; i++ )
+    {
+        snprintf( psz, sizeof( psz ), "%.9g", p_case->pf_corners[i] );
+        shim_SetOption( ppsz_corner_vars[i], psz );
+    }
+    snprintf( psz, sizeof( psz ), "%d", i_threads );
+    shim_SetOption( FILTER_PREFIX "threads", psz );
+    shim_SetOption( FILTER_PREFIX "show-handles", "0" );
+    shim_SetOption( FILTER_PREFIX "quality", psz_quality );
+    shim_SetOption( FILTER_PREFIX "interp", psz_interp );
+}
+
+/* Uneven soft edges on all sides, with a black level */
+static void SetSoftEdges( void )
+{
+    shim_SetOption( FILTER_PREFIX "blend-left", "0.2" );
+    shim_SetOption( FILTER_PREFIX "blend-right", "0.1" );
+    shim_SetOption( FILTER_PREFIX "blend-top", "0.15" );
+    shim_SetOption( FILTER_PREFIX "blend-bottom", "0.3" );
+    shim_SetOption( FILTER_PREFIX "blend-black", "0.03" );
+}
+
+/* Wider and shorter output, in whole chroma samples */
+static void GetScaledSize( const test_case_t *p_case, int *pi_width,
+                           int *pi_height )
+{
+    *pi_width  = __MAX( 2, ( p_case->i_width * 3 / 2 ) & ~1 );
+    *pi_height = __MAX( 2, ( p_case->i_height * 2 / 3 ) & ~1 );
+}
+
+/*****************************************************************************
+ * Renderers
+ *****************************************************************************/
+/* Random bands, to cover the band edges of the threaded paths */
+static int NextBand( int i_y, int i_lines )
+{
+    const int i_end = i_y + RandomInt( 1, 24 );
+    return __MIN( i_end, i_lines );
+}
+
+static void RenderReference( const filter_sys_t *p_sys, int i_interp,
+                             const picture_t *p_src, picture_t *p_dst )
+{
+    warp_kernel_t kernel;
+    if( i_interp != INTERP_BILINEAR )
+        BuildKernel( &kernel, i_interp );
+
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        const warp_component_t *p_comp = &p_sys->components[i];
+        const plane_t *p_in = &p_src->p[p_comp->i_plane];
+        plane_t *p_out = &p_dst->p[p_comp->i_plane];
+
+        if( i_interp == INTERP_BILINEAR )
+            RenderPlane( p_in, p_out, p_sys->i_cache_width,
+                         p_sys->i_cache_height, p_sys->h, p_comp,
+                         0, p_out->i_visible_lines );
+        else
+            RenderPlaneKernel( p_in, p_out, p_sys->i_cache_width,
+                               p_sys->i_cache_height, p_sys->h, p_comp,
+                               &kernel, 0, p_out->i_visible_lines );
+    }
+}
+
+/* Renders the picture with one of the direct variants, returns false if it
+ * does not apply to the transform */
+static bool RenderVariant( const filter_sys_t *p_sys, int v,
+                           const picture_t *p_src, picture_t *p_dst )
+{
+    const int i_width = p_sys->i_cache_width;
+    const int i_height = p_sys->i_cache_height;
+    warp_kernel_t kernel;
+    warp_map_t map;
+    warp_grid_t grid;
+
+    if( v <= VARIANT_MAP_LAST && v - VARIANT_MAP > i_isa )
+        return false;
+    if( v == VARIANT_ROWS && p_sys->i_transform > TRANSFORM_ROWS )
+        return false;
+    if( v == VARIANT_TRANSLATE )
+    {
+        if( p_sys->i_transform != TRANSFORM_TRANSLATE )
+            return false;
+        for( int i = 0; i < p_sys->i_components; i++ )
+        {
+            int i_dx, i_dy;
+            if( !IsDense( &p_sys->components[i] )
+             || !GetPlaneShift( p_sys->h, i_width, i_height,
+                                &p_dst->p[p_sys->components[i].i_plane],
+                                &p_sys->components[i], &i_dx, &i_dy ) )
+                return false;
+        }
+    }
+    if( v == VARIANT_MESH && ( !p_sys->b_homography
+                            || p_sys->h[6] != 0. || p_sys->h[7] != 0. ) )
+        return false;
+    if( variants[v].i_interp != INTERP_BILINEAR )
+        BuildKernel( &kernel, variants[v].i_interp );
+
+    /* 4x4 points, each cell covering a few pixels of the small cases */
+    static const float pf_flat[2 * 16];
+    double pf_points[2 * 16];
+    if( v == VARIANT_MESH
+     && !GetMeshPoints( pf_points, 4, 4, p_sys->pf_cache_corners, pf_flat,
+                        i_width, i_height ) )
+        return false;
+
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        warp_component_t comp = p_sys->components[i];
+        const plane_t *p_in = &p_src->p[comp.i_plane];
+        plane_t *p_out = &p_dst->p[comp.i_plane];
+        const int i_lines = p_out->i_visible_lines;
+
+        memset( &map, 0, sizeof( map ) );
+        memset( &grid, 0, sizeof( grid ) );
+        if( v <= VARIANT_MAP_LAST )
+            comp.pf_blend_interior = GetBlendInterior( &comp,
+                                                       v - VARIANT_MAP );
+
+        switch( v )
+        {
+            case VARIANT_MAP ... VARIANT_MAP_LAST:
+            case VARIANT_NEAREST:
+            case VARIANT_BICUBIC:
+            case VARIANT_LANCZOS:
+            case VARIANT_TILES:
+            case VARIANT_TILES_BICUBIC:
+                if( !PrepareWarpMap( &map, p_in, p_out, &comp ) )
+                    abort();
+                for( int y = 0, y_end; y < i_lines; y = y_end )
+                {
+                    y_end = NextBand( y, i_lines );
+                    /* Nearest picks among the bilinear taps, as RunJob() */
+                    if( variants[v].i_interp > INTERP_BILINEAR )
+                        BuildKernelMap( &map, i_width, i_height, p_sys->h,
+                                        &kernel, y, y_end );
+                    else
+                        BuildWarpMap( &map, i_width, i_height, p_sys->h,
+                                      y, y_end );
+                    if( v == VARIANT_TILES || v == VARIANT_TILES_BICUBIC )
+                        RenderPlaneMapTiles( &map, p_in, p_out, &comp,
+                                             variants[v].i_interp, &kernel,
+                                             y, y_end );
+                    else
+                        RenderMapRect( &map, p_in, p_out, &comp,
+                                       variants[v].i_interp, &kernel,
+                                       0, map.i_dst_width, y, y_end );
+                }
+                free( map.p_entries );
+                free( map.p_rows );
+                break;
+
+            case VARIANT_MESH:
+                if( !PrepareWarpMap( &map, p_in, p_out, &comp ) )
+                    abort();
+                for( int y = 0, y_end; y < i_lines; y = y_end )
+                {
+                    y_end = NextBand( y, i_lines );
+                    BuildMeshMap( &map, i_width, i_height, i_width, i_height,
+                                  pf_points, 4, 4, NULL, y, y_end );
+                    RenderPlaneMap( &map, p_in, p_out, &comp,
+                                    0, map.i_dst_width, y, y_end );
+                }
+                free( map.p_entries );
+                free( map.p_rows );
+                break;
+
+            case VARIANT_ROWS:
+            {
+                uint32_t *p_columns = malloc( ( p_in->i_visible_pitch
+                                                / comp.i_pixel_size + 2 )
+                                              * comp.i_channels
+                                              * sizeof( *p_columns ) );
+                if( !p_columns )
+                    abort();
+                for( int y = 0, y_end; y < i_lines; y = y_end )
+                {
+                    y_end = NextBand( y, i_lines );
+                    RenderPlaneRows( p_in, p_out, i_width, i_height,
+                                     p_sys->h, &comp, p_columns, y, y_end );
+                }
+                free( p_columns );
+                break;
+            }
+
+            case VARIANT_TRANSLATE:
+            {
+                int i_dx, i_dy;
+                GetPlaneShift( p_sys->h, i_width, i_height, p_out, &comp,
+                               &i_dx, &i_dy );
+                for( int y = 0, y_end; y < i_lines; y = y_end )
+                {
+                    y_end = NextBand( y, i_lines );
+                    RenderPlaneTranslate( p_in, p_out, i_dx, i_dy, &comp,
+                                          y, y_end );
+                }
+                break;
+            }
+
+            case VARIANT_FAST:
+                /* As Filter(): per pixel where no grid is small enough */
+                if( !BuildWarpGrid( &grid, p_in, p_out, i_width, i_height,
+                                    p_sys->h, 0.25, &comp ) )
+                {
+                    RenderPlane( p_in, p_out, i_width, i_height, p_sys->h,
+                                 &comp, 0, i_lines );
+                    break;
+                }
+                for( int y = 0, y_end; y < i_lines; y = y_end )
+                {
+                    y_end = NextBand( y, i_lines );
+                    RenderPlaneFast( &grid, p_in, p_out, i_width, i_height,
+                                     p_sys->h, &comp, y, y_end );
+                }
+                free( grid.p_points );
+                free( grid.p_exact );
+                break;
+        }
+    }
+    return true;
+}
+
+/*****************************************************************************
+ * Comparison
+ *****************************************************************************/
+static void PrintCase( const test_case_t *p_case )
+{
+    fprintf( stderr, "  %s %4.4s %dx%d corners", ppsz_cases[p_case->i_kind],
+             (const char *)&p_case->i_chroma, p_case->i_width,
+             p_case->i_height );
+    for( int i = 0; i < 8; i++ )
+        fprintf( stderr, " %.9g", p_case->pf_corners[i] );
+    fputc( '\n', stderr );
+}
+
+/* Compares the samples of the components, not the bytes that no component
+ * owns (RGB padding), and accumulates the errors */
+static void Compare( const filter_sys_t *p_sys, const test_case_t *p_case,
+                     int v, const picture_t *p_ref, const picture_t *p_pic,
+                     stats_t *p_stats )
+{
+    const int i_tolerance = variants[v].i_tolerance;
+    unsigned i_max = 0;
+    uint64_t i_differ = 0, i_samples = 0, i_beyond = 0;
+    double f_sum = 0.;
+    int i_first[4] = { -1 };
+
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        const warp_component_t *p_comp = &p_sys->components[i];
+        const plane_t *p_a = &p_ref->p[p_comp->i_plane];
+        const plane_t *p_b = &p_pic->p[p_comp->i_plane];
+        const int i_width = p_a->i_visible_pitch / p_comp->i_pixel_size;
+        /* A weight step moves the result by up to 1/256 of the range */
+        const unsigned i_allowed = __MAX( i_tolerance, 0 )
+                                 << __MAX( (int)p_comp->i_bits - 8, 0 );
+
+        for( int y = 0; y < p_a->i_visible_lines; y++ )
+            for( int x = 0; x < i_width; x++ )
+                for( int c = 0; c < p_comp->i_channels; c++ )
+                {
+                    const int i_offset = y * p_a->i_pitch
+                                       + x * p_comp->i_pixel_size
+                                       + p_comp->pi_offset[c];
+                    const unsigned a = GetSample( &p_a->p_pixels[i_offset],
+                                                  p_comp );
+                    const unsigned b = GetSample( &p_b->p_pixels[i_offset],
+                                                  p_comp );
+                    const unsigned d = a > b ? a - b : b - a;
+
+                    i_samples++;
+                    if( !d )
+                        continue;
+                    if( i_first[0] < 0 )
+                    {
+                        i_first[0] = i; i_first[1] = x; i_first[2] = y;
+                        i_first[3] = ( a << 16 ) | b;
+                    }
+                    i_differ++;
+                    if( i_tolerance >= 0 && d > i_allowed )
+                        i_beyond++;
+                    f_sum += d;
+                    i_max = __MAX( i_max, d );
+                }
+    }
+
+    p_stats->i_cases++;
+    p_stats->i_samples += i_samples;
+    p_stats->i_differ += i_differ;
+    p_stats->f_sum += f_sum;
+    p_stats->i_max = __MAX( p_stats->i_max, i_max );
+    if( !i_differ )
+        return;
+    p_stats->i_failed++;
+
+    if( !i_beyond )
+        return;
+    p_stats->i_beyond++;
+    if( b_verbose || i_reported < 10 )
+    {
+        i_reported++;
+        fprintf( stderr, "%s: %"PRIu64" samples differ, up to %u, first in "
+                 "component %d at (%d, %d): %u instead of %u\n",
+                 GetVariantName( v ), i_differ, i_max, i_first[0],
+                 i_first[1], i_first[2], i_first[3] & 0xffff,
+                 (unsigned)i_first[3] >> 16 );
+        PrintCase( p_case );
+    }
+}
+
+/* Compares the 16.16 positions that RenderPlaneFast() steps through the
+ * interpolated tiles of a grid with those of the transform: where either
+ * is inside the source, they must stay within the tolerance of the grid,
+ * plus the fixed point rounding */
+static void CheckGrid( const test_case_t *p_case, int v, int i_component,
+                       const warp_grid_t *p_grid, const double h[8],
+                       int i_y_width, int i_y_height, double f_tolerance,
+                       stats_t *p_stats )
+{
+    const int i_dst_width  = p_grid->i_dst_width;
+    const int i_src_width  = p_grid->i_src_width;
+    const int i_src_height = p_grid->i_src_height;
+    const int i_tile = p_grid->i_tile;
+    const double f_scale_x = (double)i_y_width / i_dst_width;
+    const double f_scale_y = (double)i_y_height / p_grid->i_dst_height;
+    double f_max = 0.;
+    int i_x = -1, i_y = -1;
+
+    for( int y = 0; y < p_grid->i_dst_height; y++ )
+    {
+        const int ty = y / i_tile, v_row = y - ty * i_tile;
+        const double dy = y * f_scale_y;
+        int i_begin, i_end;
+        GetRowSpan( h[1] * dy + h[2], h[4] * dy + h[5], h[7] * dy + 1.0,
+                    h[0] * f_scale_x, h[3] * f_scale_x, h[6] * f_scale_x,
+                    1. / f_scale_x, 1. / f_scale_y,
+                    i_src_width, i_src_height, i_dst_width, 1,
+                    &i_begin, &i_end );
+
+        for( int tx = i_begin / i_tile; tx * i_tile < i_end; tx++ )
+        {
+            if( p_grid->p_exact[ty * p_grid->i_cols + tx] )
+                continue;
+
+            const int x0 = __MAX( tx * i_tile, i_begin );
+            const int x1 = __MIN( ( tx + 1 ) * i_tile, i_end );
+            int32_t sx, sy, step_x, step_y;
+            GetTileStep( p_grid, tx, ty, v_row, x0, &sx, &sy,
+                         &step_x, &step_y );
+
+            for( int x = x0; x < x1; x++ )
+            {
+                const double fx = (int32_t)( sx + (int64_t)step_x
+                                                  * ( x - x0 ) ) / 65536.;
+                const double fy = (int32_t)( sy + (int64_t)step_y
+                                                  * ( x - x0 ) ) / 65536.;
+                double ex, ey;
+                MapPoint( h, f_scale_x, f_scale_y, x, y, &ex, &ey );
+
+                /* Outside of the source, as BlendFixed() tells it */
+                if( ( fx < -1. || fx >= i_src_width
+                   || fy < -1. || fy >= i_src_height )
+                 && ( ex < -1. || ex >= i_src_width
+                   || ey < -1. || ey >= i_src_height ) )
+                    continue;
+
+                const double f_err = __MAX( fabs( fx - ex ),
+                                            fabs( fy - ey ) );
+                if( !( f_err <= f_max ) )
+                {
+                    f_max = f_err;
+                    i_x = x;
+                    i_y = y;
+                }
+            }
+        }
+    }
+
+    if( f_max <= f_tolerance + 1. / 65536 )
+        return;
+    p_stats->i_beyond++;
+    if( b_verbose || i_reported < 10 )
+    {
+        i_reported++;
+        fprintf( stderr, "%s: stepped %g pixels away from the transform in "
+                 "component %d at (%d, %d), tolerance %g\n",
+                 GetVariantName( v ), f_max, i_component, i_x, i_y,
+                 f_tolerance );
+        PrintCase( p_case );
+    }
+}
+
+/* CheckGrid() of the grids that VARIANT_FAST builds */
+static void CheckFastGrids( const filter_sys_t *p_sys,
+                            const test_case_t *p_case, int v,
+                            const picture_t *p_src, const picture_t *p_dst,
+                            stats_t *p_stats )
+{
+    for( int i = 0; i < p_sys->i_components; i++ )
+    {
+        const warp_component_t *p_comp = &p_sys->components[i];
+        warp_grid_t grid;
+
+        memset( &grid, 0, sizeof( grid ) );
+        if( !BuildWarpGrid( &grid, &p_src->p[p_comp->i_plane],
+                            &p_dst->p[p_comp->i_plane],
+                            p_sys->i_cache_width, p_sys->i_cache_height,
+                            p_sys->h, 0.25, p_comp ) )
+            abort();
+        CheckGrid( p_case, v, i, &grid, p_sys->h, p_sys->i_cache_width,
+                   p_sys->i_cache_height, 0.25, p_stats );
+        free( grid.p_points );
+        free( grid.p_exact );
+    }
+}
+
+/*****************************************************************************
+ * Test of one case
+ *****************************************************************************/
+static void RunCase( const test_case_t *p_case, stats_t *p_stats,
+                     int *pi_passthrough, int *pi_skipped )
+{
+    video_format_t fmt;
+    InitFormat( &fmt, p_case );
+
+    SetOptions( p_case, "exact", "bilinear", 1 );
+    filter_t *p_filter = shim_NewFilter( Create, &fmt );
+    if( !p_filter )
+    {
+        ( *pi_skipped )++;
+        return;
+    }
+    filter_sys_t *p_sys = p_filter->p_sys;
+    UpdateRenderCache( p_sys, p_case->pf_corners, NULL,
+                       p_case->i_width, p_case->i_height,
+                       p_case->i_width, p_case->i_height );
+
+    picture_t *p_src = picture_NewFromFormat( &fmt );
+    picture_t *p_ref = picture_NewFromFormat( &fmt );
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( !p_src || !p_ref || !p_pic )
+        abort();
+    FillRandom( p_sys, p_src );
+
+    if( !p_sys->b_homography )
+    {
+        /* Degenerate: the picture must go through untouched */
+        picture_t *p_out = Filter( p_filter, picture_Hold( p_src ) );
+        if( p_out != p_src )
+        {
+            fprintf( stderr, "degenerate case was not passed through\n" );
+            PrintCase( p_case );
+            p_stats[VARIANT_FILTER].i_failed++;
+        }
+        if( p_out )
+            picture_Release( p_out );
+        ( *pi_passthrough )++;
+        goto end;
+    }
+
+    int i_ref_interp = -1;
+    for( int v = 0; v < VARIANT_COUNT; v++ )
+    {
+        /* Unwritten samples differ from the reference fill */
+        if( variants[v].i_interp != i_ref_interp )
+        {
+            FillPattern( p_ref, 0xA5 );
+            RenderReference( p_sys, variants[v].i_interp, p_src, p_ref );
+            i_ref_interp = variants[v].i_interp;
+        }
+
+        if( !variants[v].psz_quality )
+        {
+            FillPattern( p_pic, 0x5A );
+            if( RenderVariant( p_sys, v, p_src, p_pic ) )
+                Compare( p_sys, p_case, v, p_ref, p_pic, &p_stats[v] );
+            if( v == VARIANT_FAST )
+                CheckFastGrids( p_sys, p_case, v, p_src, p_pic, &p_stats[v] );
+            continue;
+        }
+
+        SetOptions( p_case, variants[v].psz_quality,
+                    ppsz_interp_values[variants[v].i_interp],
+                    variants[v].i_threads );
+        if( variants[v].b_edges )
+            SetSoftEdges();
+        if( variants[v].b_scaled )
+        {
+            char psz_size[32];
+            int i_out_width, i_out_height;
+            GetScaledSize( p_case, &i_out_width, &i_out_height );
+            snprintf( psz_size, sizeof( psz_size ), "%dx%d", i_out_width,
+                      i_out_height );
+            shim_SetOption( FILTER_PREFIX "output-size", psz_size );
+        }
+        filter_t *p_variant = shim_NewFilter( Create, &fmt );
+        if( !p_variant )
+            abort();
+        picture_t *p_out = Filter( p_variant, picture_Hold( p_src ) );
+        picture_t *p_expected = p_ref;
+        if( p_out && p_out != p_src && variants[v].b_scaled )
+        {
+            /* With the homography of the variant, to its size */
+            p_expected = picture_NewFromFormat( &p_variant->fmt_out.video );
+            if( !p_expected )
+                abort();
+            FillPattern( p_expected, 0xA5 );
+            RenderReference( p_variant->p_sys, variants[v].i_interp, p_src,
+                             p_expected );
+        }
+        if( p_out && p_out != p_src && variants[v].b_edges )
+        {
+            /* With the gains of the variant, over whole planes */
+            const filter_sys_t *p_edges = p_variant->p_sys;
+            for( int i = 0; i < p_sys->i_components; i++ )
+            {
+                plane_t *p_plane = &p_ref->p[p_sys->components[i].i_plane];
+                ApplySoftEdge( &p_edges->edges[i], &p_sys->components[i],
+                               p_plane, 0, p_plane->i_visible_lines );
+            }
+            i_ref_interp = -1;
+        }
+        if( p_out && p_out != p_src )
+        {
+            const filter_sys_t *p_fast = p_variant->p_sys;
+            for( int i = 0; i < p_sys->i_components; i++ )
+                if( p_fast->pi_mode[i] == RENDER_FAST )
+                    CheckGrid( p_case, v, i, &p_fast->grids[i], p_fast->h,
+                               p_fast->i_cache_width, p_fast->i_cache_height,
+                               p_fast->f_tolerance, &p_stats[v] );
+            Compare( p_sys, p_case, v, p_expected, p_out, &p_stats[v] );
+            picture_Release( p_out );
+
+            /* Same corners: the next picture comes from the maps */
+            p_out = p_fast->b_fast ? Filter( p_variant, picture_Hold( p_src ) )
+                                   : NULL;
+            for( int i = 0; p_out && i < p_sys->i_components; i++ )
+                if( p_fast->pi_mode[i] == RENDER_FAST )
+                {
+                    fprintf( stderr, "%s: grid of unchanged corners\n",
+                             GetVariantName( v ) );
+                    PrintCase( p_case );
+                    p_stats[v].i_failed++;
+                    break;
+                }
+            if( p_out )
+                picture_Release( p_out );
+        }
+        else
+        {
+            fprintf( stderr, "%s: no picture\n", GetVariantName( v ) );
+            PrintCase( p_case );
+            p_stats[v].i_failed++;
+            if( p_out )
+                picture_Release( p_out );
+        }
+        if( p_expected != p_ref )
+            picture_Release( p_expected );
+        shim_DeleteFilter( p_variant, Destroy );
+    }
+
+end:
+    picture_Release( p_pic );
+    picture_Release( p_ref );
+    picture_Release( p_src );
+    shim_DeleteFilter( p_filter, Destroy );
+}
+
+/*****************************************************************************
+ * Main
+ *****************************************************************************/
+static void Usage( const char *psz_program )
+{
+    fprintf( stderr,
+"Usage: %s [options]\n"
+"  -n, --cases N     cases per kind (default 100)\n"
+"  -s, --seed N      random seed (default 1)\n"
+"  -v, --verbose     report every failing case\n"
+"  -h, --help        this help\n", psz_program );
+}
+
+int main( int argc, char **argv )
+{
+    static const struct option long_options[] = {
+        { "cases",   required_argument, NULL, 'n' },
+        { "seed",    required_argument, NULL, 's' },
+        { "verbose", no_argument,       NULL, 'v' },
+        { "help",    no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    int i_cases = 100;
+    uint64_t i_seed = 1;
+    int c;
+
+    while( ( c = getopt_long( argc, argv, "n:s:vh", long_options,
+                              NULL ) ) != -1 )
+    {
+        switch( c )
+        {
+            case 'n': i_cases = atoi( optarg );            break;
+            case 's': i_seed = strtoull( optarg, NULL, 0 ); break;
+            case 'v': b_verbose = true;                    break;
+            case 'h':
+                Usage( argv[0] );
+                return 0;
+            default:
+                Usage( argv[0] );
+                return 1;
+        }
+    }
+    if( i_cases <= 0 || optind < argc )
+    {
+        Usage( argv[0] );
+        return 1;
+    }
+
+    vlc_module_defaults();
+    i_isa = GetIsa();
+    i_state = i_seed * UINT64_C(0x9E3779B97F4A7C15) | 1;
+
+    stats_t stats[VARIANT_COUNT] = { { 0 } };
+    int i_passthrough = 0, i_skipped = 0;
+    for( int k = 0; k < CASE_COUNT; k++ )
+    {
+        for( int i = 0; i < i_cases; i++ )
+        {
+            test_case_t test;
+            NewCase( &test, k );
+            RunCase( &test, stats, &i_passthrough, &i_skipped );
+        }
+        fprintf( stderr, "%s: %d cases\n", ppsz_cases[k], i_cases );
+    }
+
+    bool b_ok = true;
+    printf( "%-16s %6s %6s %12s %12s %5s %9s  %s\n", "variant", "cases",
+            "differ", "samples", "differing", "max", "mean", "result" );
+    for( int v = 0; v < VARIANT_COUNT; v++ )
+    {
+        const stats_t *p = &stats[v];
+        const int i_tolerance = variants[v].i_tolerance;
+        const bool b_pass = !p->i_beyond;
+        const char *psz_result = !b_pass ? "FAILED"
+                               : !p->i_cases ? "unsupported"
+                               : i_tolerance < 0 ? "approximate"
+                               : p->i_failed ? "rounding" : "exact";
+
+        printf( "%-16s %6d %6d %12"PRIu64" %12"PRIu64" %5u %9.5f  %s\n",
+                GetVariantName( v ), p->i_cases, p->i_failed, p->i_samples,
+                p->i_differ, p->i_max,
+                p->i_samples ? p->f_sum / p->i_samples : 0.,
+                psz_result );
+        b_ok &= b_pass;
+    }
+    printf( "%d degenerate cases passed through, %d formats rejected\n",
+            i_passthrough, i_skipped );
+
+    shim_ClearOptions();
+    return b_ok ? 0 : 1;
+}
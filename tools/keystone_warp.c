@@ -0,0 +1,803 @@
+/*****************************************************************************
+ * keystone_warp.c: headless batch warp of Y4M and raw video files
+ *****************************************************************************
+ * Builds src/keystone.c against the VLC stand-in of vlcshim/ and runs the
+ * pictures of a file or of the standard input through Filter(), so that
+ * the output is bit for bit the one of the plugin with the same options:
+ *
+ *   keystone_warp -k 0.05,0,-0.05,0,0,0,0,0 -i in.y4m -o out.y4m
+ *   ffmpeg -i show.mov -f yuv4mpegpipe - | keystone_warp -p wall.ksp > w.y4m
+ *   keystone_warp -s 3840x2160 -c nv12 -i in.nv12 -f raw -o out.nv12
+ *
+ * Regular input files are mapped, pipes read in large blocks, and the
+ * output is written in large blocks. Pictures are warped in parallel, one
+ * filter instance per job, and written in their input order.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *****************************************************************************/
+
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "../src/keystone.c"
+#include "vlcshim.h"
+
+#define IO_BUFFER   ( 8 << 20 )   /* Block size of the reads and writes */
+#define MAX_JOBS    64            /* Pictures warped at the same time */
+#define Y4M_LINE    256           /* Longest Y4M stream or frame header */
+
+/*****************************************************************************
+ * Formats
+ *****************************************************************************/
+static const struct
+{
+    const char *psz_name;
+    vlc_fourcc_t i_chroma;
+    const char *psz_y4m;        /* Y4M C tag written, NULL: raw only */
+} chromas[] = {
+    { "i420",    VLC_CODEC_I420,     "420jpeg" },
+    { "yv12",    VLC_CODEC_YV12,     NULL },
+    { "i422",    VLC_CODEC_I422,     "422" },
+    { "i444",    VLC_CODEC_I444,     "444" },
+    { "yuva",    VLC_CODEC_YUVA,     "444alpha" },
+    { "i420-9",  VLC_CODEC_I420_9L,  "420p9" },
+    { "i420-10", VLC_CODEC_I420_10L, "420p10" },
+    { "i444-10", VLC_CODEC_I444_10L, "444p10" },
+    { "nv12",    VLC_CODEC_NV12,     NULL },
+    { "nv21",    VLC_CODEC_NV21,     NULL },
+    { "yuyv",    VLC_CODEC_YUYV,     NULL },
+    { "uyvy",    VLC_CODEC_UYVY,     NULL },
+    { "rgb24",   VLC_CODEC_RGB24,    NULL },
+    { "rgb32",   VLC_CODEC_RGB32,    NULL },
+    { "rgba",    VLC_CODEC_RGBA,     NULL },
+};
+
+/* Y4M C tags read, besides the ones written */
+static const struct
+{
+    const char *psz_y4m;
+    vlc_fourcc_t i_chroma;
+} y4m_aliases[] = {
+    { "420",      VLC_CODEC_I420 },
+    { "420mpeg2", VLC_CODEC_I420 },
+    { "420paldv", VLC_CODEC_I420 },
+};
+
+typedef struct
+{
+    vlc_fourcc_t i_chroma;
+    int  i_width, i_height;
+    unsigned i_sar_num, i_sar_den;
+    char psz_rate[32];          /* F tag, as read */
+    char i_interlace;           /* I tag */
+} stream_t;
+
+/*****************************************************************************
+ * Input: mapped when it is a regular file, read in large blocks otherwise
+ *****************************************************************************/
+typedef struct
+{
+    FILE          *p_file;      /* NULL when mapped */
+    const uint8_t *p_map;
+    size_t         i_size, i_pos;
+    size_t         i_dropped;   /* Mapped pages released up to there */
+} input_t;
+
+static bool OpenInput( input_t *p_in, const char *psz_path )
+{
+    memset( p_in, 0, sizeof( *p_in ) );
+
+    const int fd = strcmp( psz_path, "-" ) ? vlc_open( psz_path, O_RDONLY )
+                                           : dup( STDIN_FILENO );
+    struct stat st;
+    if( fd == -1 || fstat( fd, &st ) )
+    {
+        perror( psz_path );
+        if( fd != -1 )
+            vlc_close( fd );
+        return false;
+    }
+
+    if( S_ISREG( st.st_mode ) && st.st_size > 0 )
+    {
+        void *p_map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( p_map != MAP_FAILED )
+        {
+            posix_madvise( p_map, st.st_size, POSIX_MADV_SEQUENTIAL );
+            p_in->p_map = p_map;
+            p_in->i_size = st.st_size;
+            vlc_close( fd );
+            return true;
+        }
+    }
+
+    p_in->p_file = fdopen( fd, "rb" );
+    if( !p_in->p_file )
+    {
+        perror( psz_path );
+        vlc_close( fd );
+        return false;
+    }
+    setvbuf( p_in->p_file, NULL, _IOFBF, IO_BUFFER );
+    return true;
+}
+
+static void CloseInput( input_t *p_in )
+{
+    if( p_in->p_file )
+        fclose( p_in->p_file );
+    else if( p_in->p_map )
+        munmap( (void *)p_in->p_map, p_in->i_size );
+}
+
+/* Returns the number of bytes read, short at the end of the input */
+static size_t ReadInput( input_t *p_in, void *p_buf, size_t i_size )
+{
+    if( p_in->p_file )
+        return fread( p_buf, 1, i_size, p_in->p_file );
+
+    i_size = __MIN( i_size, p_in->i_size - p_in->i_pos );
+    memcpy( p_buf, &p_in->p_map[p_in->i_pos], i_size );
+    p_in->i_pos += i_size;
+
+    /* Read once: drop the pages behind, not to grow the resident set */
+    if( p_in->i_pos - p_in->i_dropped >= IO_BUFFER )
+    {
+        const size_t i_end = p_in->i_pos & ~(size_t)( IO_BUFFER - 1 );
+        posix_madvise( (void *)&p_in->p_map[p_in->i_dropped],
+                       i_end - p_in->i_dropped, POSIX_MADV_DONTNEED );
+        p_in->i_dropped = i_end;
+    }
+    return i_size;
+}
+
+/* Reads a header line without its '\n': false at the end of the input,
+ * or when the line does not fit */
+static bool ReadLine( input_t *p_in, char *psz_line, size_t i_max )
+{
+    size_t i_len = 0;
+
+    for( ;; )
+    {
+        int c;
+        if( p_in->p_file )
+            c = getc( p_in->p_file );
+        else
+            c = p_in->i_pos < p_in->i_size ? p_in->p_map[p_in->i_pos++]
+                                           : EOF;
+        if( c == EOF || c == '\n' )
+        {
+            psz_line[i_len] = '\0';
+            return c == '\n';
+        }
+        if( i_len + 1 == i_max )
+            return false;
+        psz_line[i_len++] = c;
+    }
+}
+
+/*****************************************************************************
+ * Y4M headers
+ *****************************************************************************/
+static bool ParseY4MHeader( char *psz_line, stream_t *p_stream )
+{
+    char *psz_save;
+    char *psz = strtok_r( psz_line, " ", &psz_save );
+
+    if( !psz || strcmp( psz, "YUV4MPEG2" ) )
+    {
+        fprintf( stderr, "not a Y4M stream (use -s for raw input)\n" );
+        return false;
+    }
+
+    p_stream->i_chroma = VLC_CODEC_I420;
+    while( ( psz = strtok_r( NULL, " ", &psz_save ) ) )
+    {
+        const char *psz_value = &psz[1];
+        switch( psz[0] )
+        {
+            case 'W': p_stream->i_width  = atoi( psz_value ); break;
+            case 'H': p_stream->i_height = atoi( psz_value ); break;
+            case 'F':
+                snprintf( p_stream->psz_rate, sizeof( p_stream->psz_rate ),
+                          "%s", psz_value );
+                break;
+            case 'I':
+                if( *psz_value )
+                    p_stream->i_interlace = *psz_value;
+                break;
+            case 'A':
+                if( sscanf( psz_value, "%u:%u", &p_stream->i_sar_num,
+                            &p_stream->i_sar_den ) != 2 )
+                    p_stream->i_sar_num = p_stream->i_sar_den = 0;
+                break;
+            case 'C':
+            {
+                vlc_fourcc_t i_chroma = 0;
+                for( size_t i = 0; i < ARRAY_SIZE( chromas ); i++ )
+                    if( chromas[i].psz_y4m
+                     && !strcmp( psz_value, chromas[i].psz_y4m ) )
+                        i_chroma = chromas[i].i_chroma;
+                for( size_t i = 0; i < ARRAY_SIZE( y4m_aliases ); i++ )
+                    if( !strcmp( psz_value, y4m_aliases[i].psz_y4m ) )
+                        i_chroma = y4m_aliases[i].i_chroma;
+                if( !i_chroma )
+                {
+                    fprintf( stderr, "unsupported Y4M chroma: %s\n",
+                             psz_value );
+                    return false;
+                }
+                p_stream->i_chroma = i_chroma;
+                break;
+            }
+            default:    /* X and future tags */
+                break;
+        }
+    }
+    return true;
+}
+
+static const char *GetY4MChroma( vlc_fourcc_t i_chroma )
+{
+    for( size_t i = 0; i < ARRAY_SIZE( chromas ); i++ )
+        if( chromas[i].i_chroma == i_chroma )
+            return chromas[i].psz_y4m;
+    return NULL;
+}
+
+/*****************************************************************************
+ * Pictures: visible lines only, plane after plane, as in Y4M and raw files
+ *****************************************************************************/
+static size_t GetFrameSize( const picture_t *p_pic )
+{
+    size_t i_size = 0;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        i_size += (size_t)p_pic->p[i].i_visible_pitch
+                * p_pic->p[i].i_visible_lines;
+    return i_size;
+}
+
+/* Returns 1 for a picture, 0 at the end of the input, and -1 (reported)
+ * on a bad frame header or a truncated picture */
+static int ReadPicture( input_t *p_in, picture_t *p_pic, bool b_y4m )
+{
+    if( b_y4m )
+    {
+        char psz_line[Y4M_LINE];
+        if( !ReadLine( p_in, psz_line, sizeof( psz_line ) ) )
+        {
+            if( !*psz_line )
+                return 0;
+            fprintf( stderr, "bad frame header\n" );
+            return -1;
+        }
+        if( strncmp( psz_line, "FRAME", 5 ) )
+        {
+            fprintf( stderr, "bad frame header: %.16s\n", psz_line );
+            return -1;
+        }
+    }
+
+    size_t i_read = 0;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_visible_lines; y++ )
+        {
+            const size_t i_line = ReadInput( p_in,
+                                             &p->p_pixels[y * p->i_pitch],
+                                             p->i_visible_pitch );
+            i_read += i_line;
+            if( i_line < (size_t)p->i_visible_pitch )
+            {
+                if( !i_read && !b_y4m )
+                    return 0;
+                fprintf( stderr, "truncated picture: %zu of %zu bytes\n",
+                         i_read, GetFrameSize( p_pic ) );
+                return -1;
+            }
+        }
+    }
+    return 1;
+}
+
+static bool WritePicture( FILE *p_file, const picture_t *p_pic, bool b_y4m )
+{
+    if( b_y4m && fputs( "FRAME\n", p_file ) == EOF )
+        return false;
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p = &p_pic->p[i];
+        for( int y = 0; y < p->i_visible_lines; y++ )
+            if( fwrite( &p->p_pixels[y * p->i_pitch], p->i_visible_pitch, 1,
+                        p_file ) != 1 )
+                return false;
+    }
+    return true;
+}
+
+/*****************************************************************************
+ * Pipeline: the main thread reads the pictures in order into a ring of
+ * slots, the jobs warp them, and the writer thread writes them in order
+ *****************************************************************************/
+enum
+{
+    SLOT_FREE,
+    SLOT_READ,      /* Waiting for a job */
+    SLOT_WARPING,
+    SLOT_WARPED,    /* Waiting for the writer */
+};
+
+typedef struct
+{
+    int        i_state;
+    picture_t *p_in;            /* Allocated once, read again and again */
+    picture_t *p_out;
+} slot_t;
+
+typedef struct warper_t warper_t;
+
+typedef struct
+{
+    warper_t  *p_warper;
+    filter_t  *p_filter;
+    pthread_t  thread;
+} job_t;
+
+struct warper_t
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  wait;
+    slot_t  *p_slots;
+    int      i_slots;
+    int64_t  i_read;        /* Pictures read, */
+    int64_t  i_next;        /* handed to the jobs, */
+    int64_t  i_written;     /* and written */
+    bool     b_eof;         /* No picture after i_read */
+    bool     b_error;       /* Stop everything */
+
+    job_t    jobs[MAX_JOBS];
+    int      i_jobs;
+
+    FILE    *p_out;
+    bool     b_y4m_out;
+    picture_t *p_layout;    /* Of the output pictures */
+};
+
+static void *Job( void *p_data )
+{
+    job_t *p_job = p_data;
+    warper_t *p_warper = p_job->p_warper;
+
+    pthread_mutex_lock( &p_warper->lock );
+    for( ;; )
+    {
+        while( p_warper->i_next == p_warper->i_read && !p_warper->b_eof
+            && !p_warper->b_error )
+            pthread_cond_wait( &p_warper->wait, &p_warper->lock );
+        if( p_warper->i_next == p_warper->i_read || p_warper->b_error )
+            break;
+
+        slot_t *p_slot = &p_warper->p_slots[p_warper->i_next++
+                                            % p_warper->i_slots];
+        p_slot->i_state = SLOT_WARPING;
+        pthread_mutex_unlock( &p_warper->lock );
+
+        /* The slot keeps its input picture: Filter() releases one */
+        picture_t *p_out = Filter( p_job->p_filter,
+                                   picture_Hold( p_slot->p_in ) );
+
+        pthread_mutex_lock( &p_warper->lock );
+        p_slot->p_out = p_out;
+        p_slot->i_state = SLOT_WARPED;
+        pthread_cond_broadcast( &p_warper->wait );
+    }
+    pthread_mutex_unlock( &p_warper->lock );
+    return NULL;
+}
+
+static void *Writer( void *p_data )
+{
+    warper_t *p_warper = p_data;
+
+    pthread_mutex_lock( &p_warper->lock );
+    for( ;; )
+    {
+        slot_t *p_slot = &p_warper->p_slots[p_warper->i_written
+                                            % p_warper->i_slots];
+        while( !p_warper->b_error
+            && !( p_warper->i_written < p_warper->i_read
+               && p_slot->i_state == SLOT_WARPED )
+            && !( p_warper->b_eof
+               && p_warper->i_written == p_warper->i_read ) )
+            pthread_cond_wait( &p_warper->wait, &p_warper->lock );
+        if( p_warper->b_error || p_warper->i_written == p_warper->i_read )
+            break;
+        pthread_mutex_unlock( &p_warper->lock );
+
+        bool b_ok = false;
+        if( !p_slot->p_out )
+            fprintf( stderr, "picture %"PRId64" could not be warped\n",
+                     p_warper->i_written );
+        else if( !WritePicture( p_warper->p_out, p_slot->p_out,
+                                p_warper->b_y4m_out ) )
+            perror( "write" );
+        else
+            b_ok = true;
+        if( p_slot->p_out )
+            picture_Release( p_slot->p_out );
+
+        pthread_mutex_lock( &p_warper->lock );
+        p_slot->p_out = NULL;
+        p_slot->i_state = SLOT_FREE;
+        p_warper->i_written++;
+        p_warper->b_error |= !b_ok;
+        pthread_cond_broadcast( &p_warper->wait );
+    }
+    pthread_mutex_unlock( &p_warper->lock );
+    return NULL;
+}
+
+/* Reads the pictures into the free slots until the end of the input:
+ * returns false if it ended on a bad picture */
+static bool Read( warper_t *p_warper, input_t *p_in, bool b_y4m )
+{
+    int i_status;
+
+    for( ;; )
+    {
+        pthread_mutex_lock( &p_warper->lock );
+        slot_t *p_slot = &p_warper->p_slots[p_warper->i_read
+                                            % p_warper->i_slots];
+        while( p_slot->i_state != SLOT_FREE && !p_warper->b_error )
+            pthread_cond_wait( &p_warper->wait, &p_warper->lock );
+        const bool b_error = p_warper->b_error;
+        pthread_mutex_unlock( &p_warper->lock );
+        if( b_error )
+        {
+            i_status = 0;
+            break;
+        }
+
+        i_status = ReadPicture( p_in, p_slot->p_in, b_y4m );
+        if( i_status <= 0 )
+            break;
+
+        pthread_mutex_lock( &p_warper->lock );
+        p_slot->i_state = SLOT_READ;
+        p_warper->i_read++;
+        pthread_cond_broadcast( &p_warper->wait );
+        pthread_mutex_unlock( &p_warper->lock );
+    }
+
+    pthread_mutex_lock( &p_warper->lock );
+    p_warper->b_eof = true;
+    pthread_cond_broadcast( &p_warper->wait );
+    pthread_mutex_unlock( &p_warper->lock );
+    return i_status == 0;
+}
+
+/*****************************************************************************
+ * Command line
+ *****************************************************************************/
+static void Usage( const char *psz_program )
+{
+    fprintf( stderr,
+"Usage: %s [options] -k CORNERS | -p PROFILE\n"
+"  -i, --input FILE      Y4M, or raw with -s, '-' for the standard input\n"
+"                        (default)\n"
+"  -o, --output FILE     '-' for the standard output (default)\n"
+"  -s, --size WxH        raw input of this size\n"
+"  -c, --chroma NAME     of the raw input: i420 (default), yv12, i422,\n"
+"                        i444, yuva, i420-9, i420-10, i444-10, nv12, nv21,\n"
+"                        yuyv, uyvy, rgb24, rgb32, rgba\n"
+"  -r, --rate N:D        frame rate of the Y4M output of a raw input\n"
+"                        (default 25:1)\n"
+"  -f, --format FORMAT   output as y4m or raw (default: as the input)\n"
+"  -k, --corners LIST    tl-x,tl-y,tr-x,tr-y,bl-x,bl-y,br-x,br-y offsets,\n"
+"                        in fractions of the picture size\n"
+"  -p, --profile FILE    calibration profile saved by the plugin; its warp\n"
+"                        maps are stored into it after the first run\n"
+"  -O, --option NAME=VALUE\n"
+"                        any other filter option, e.g. interp=bicubic,\n"
+"                        output-size=1280x720, blend-left=0.1\n"
+"  -j, --jobs N          pictures warped at the same time, each with its\n"
+"                        own warp maps (default: one per CPU)\n"
+"  -t, --threads N       rendering threads per picture (default 1)\n"
+"  -V, --verbose         print the filter messages\n"
+"  -h, --help            this help\n", psz_program );
+}
+
+static bool SetCorners( char *psz_list )
+{
+    int i = 0;
+    for( char *psz_save, *psz = strtok_r( psz_list, ",", &psz_save ); psz;
+         psz = strtok_r( NULL, ",", &psz_save ) )
+    {
+        char *psz_end;
+        strtof( psz, &psz_end );
+        if( i == 8 || psz_end == psz || *psz_end )
+            return false;
+        shim_SetOption( ppsz_corner_vars[i++], psz );
+    }
+    return i == 8;
+}
+
+static bool SetFilterOption( const char *psz_arg )
+{
+    const char *psz_value = strchr( psz_arg, '=' );
+    if( !psz_value || psz_value == psz_arg )
+        return false;
+
+    char psz_name[64];
+    const int i_len = psz_value - psz_arg;
+    const bool b_prefixed = !strncmp( psz_arg, FILTER_PREFIX,
+                                      strlen( FILTER_PREFIX ) );
+    if( snprintf( psz_name, sizeof( psz_name ), "%s%.*s",
+                  b_prefixed ? "" : FILTER_PREFIX, i_len, psz_arg )
+        >= (int)sizeof( psz_name ) )
+        return false;
+    shim_SetOption( psz_name, psz_value + 1 );
+    return true;
+}
+
+static double Now( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main( int argc, char **argv )
+{
+    static const struct option long_options[] = {
+        { "input",    required_argument, NULL, 'i' },
+        { "output",   required_argument, NULL, 'o' },
+        { "size",     required_argument, NULL, 's' },
+        { "chroma",   required_argument, NULL, 'c' },
+        { "rate",     required_argument, NULL, 'r' },
+        { "format",   required_argument, NULL, 'f' },
+        { "corners",  required_argument, NULL, 'k' },
+        { "profile",  required_argument, NULL, 'p' },
+        { "option",   required_argument, NULL, 'O' },
+        { "jobs",     required_argument, NULL, 'j' },
+        { "threads",  required_argument, NULL, 't' },
+        { "verbose",  no_argument,       NULL, 'V' },
+        { "help",     no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 },
+    };
+    const char *psz_input = "-", *psz_output = "-";
+    const char *psz_format = NULL, *psz_profile = NULL;
+    const char *psz_threads = "1";
+    stream_t stream = { .i_chroma = VLC_CODEC_I420, .psz_rate = "25:1",
+                        .i_interlace = 'p', .i_sar_num = 1, .i_sar_den = 1 };
+    bool b_raw = false, b_corners = false, b_ok = true;
+    int i_jobs = __MIN( vlc_GetCPUCount(), MAX_JOBS );
+    int c;
+
+    vlc_module_defaults();
+    while( ( c = getopt_long( argc, argv, "i:o:s:c:r:f:k:p:O:j:t:Vh",
+                              long_options, NULL ) ) != -1 )
+    {
+        switch( c )
+        {
+            case 'i': psz_input = optarg;   break;
+            case 'o': psz_output = optarg;  break;
+            case 'f': psz_format = optarg;  break;
+            case 'p': psz_profile = optarg; break;
+            case 't': psz_threads = optarg; break;
+            case 's':
+                b_raw = true;
+                b_ok &= sscanf( optarg, "%dx%d", &stream.i_width,
+                                &stream.i_height ) == 2;
+                break;
+            case 'c':
+            {
+                bool b_found = false;
+                for( size_t i = 0; i < ARRAY_SIZE( chromas ); i++ )
+                    if( !strcmp( optarg, chromas[i].psz_name ) )
+                    {
+                        stream.i_chroma = chromas[i].i_chroma;
+                        b_found = true;
+                    }
+                b_ok &= b_found;
+                break;
+            }
+            case 'r':
+                snprintf( stream.psz_rate, sizeof( stream.psz_rate ), "%s",
+                          optarg );
+                break;
+            case 'k':
+                b_corners = true;
+                b_ok &= SetCorners( optarg );
+                break;
+            case 'O': b_ok &= SetFilterOption( optarg ); break;
+            case 'j':
+                i_jobs = atoi( optarg );
+                b_ok &= i_jobs > 0 && i_jobs <= MAX_JOBS;
+                break;
+            case 'V': shim_SetVerbose( true ); break;
+            case 'h':
+                Usage( argv[0] );
+                return 0;
+            default:
+                b_ok = false;
+                break;
+        }
+    }
+    if( !b_ok || optind < argc || b_corners == !!psz_profile
+     || ( psz_format && strcmp( psz_format, "y4m" )
+                     && strcmp( psz_format, "raw" ) ) )
+    {
+        Usage( argv[0] );
+        return 1;
+    }
+
+    /* The filter would create a missing profile, with default corners */
+    if( psz_profile && access( psz_profile, R_OK ) )
+    {
+        perror( psz_profile );
+        return 1;
+    }
+
+    input_t in;
+    if( !OpenInput( &in, psz_input ) )
+        return 1;
+
+    int i_ret = 1;
+    if( !b_raw )
+    {
+        char psz_line[Y4M_LINE];
+        if( !ReadLine( &in, psz_line, sizeof( psz_line ) ) )
+        {
+            fprintf( stderr, "no Y4M stream header (use -s for raw input)\n" );
+            goto end_input;
+        }
+        if( !ParseY4MHeader( psz_line, &stream ) )
+            goto end_input;
+    }
+    if( stream.i_width < 1 || stream.i_height < 1
+     || stream.i_width > OUTPUT_MAX || stream.i_height > OUTPUT_MAX )
+    {
+        fprintf( stderr, "bad picture size: %dx%d\n",
+                 stream.i_width, stream.i_height );
+        goto end_input;
+    }
+
+    const bool b_y4m_out = psz_format ? !strcmp( psz_format, "y4m" )
+                                      : !b_raw;
+    const char *psz_y4m_chroma = GetY4MChroma( stream.i_chroma );
+    if( b_y4m_out && !psz_y4m_chroma )
+    {
+        fprintf( stderr, "this chroma can only be written raw (-f raw)\n" );
+        goto end_input;
+    }
+
+    video_format_t fmt;
+    video_format_Init( &fmt, stream.i_chroma );
+    fmt.i_width  = fmt.i_visible_width  = stream.i_width;
+    fmt.i_height = fmt.i_visible_height = stream.i_height;
+    fmt.i_sar_num = stream.i_sar_num ? stream.i_sar_num : 1;
+    fmt.i_sar_den = stream.i_sar_den ? stream.i_sar_den : 1;
+    video_format_FixRgb( &fmt );
+
+    /* One filter per job, each loading and mapping the profile itself:
+     * only the page cache of its maps is shared. Without them every job
+     * builds a full set, and only the first instance stores it */
+    warper_t warper = { .i_jobs = i_jobs, .b_y4m_out = b_y4m_out };
+    shim_SetOption( FILTER_PREFIX "threads", psz_threads );
+    if( psz_profile )
+        shim_SetOption( FILTER_PREFIX "profile", psz_profile );
+    for( int j = 0; j < i_jobs; j++ )
+    {
+        if( j == 1 )
+            shim_SetOption( FILTER_PREFIX "profile-maps", "0" );
+        warper.jobs[j].p_warper = &warper;
+        warper.jobs[j].p_filter = shim_NewFilter( Create, &fmt );
+        if( !warper.jobs[j].p_filter )
+        {
+            fprintf( stderr, "cannot create the filter\n" );
+            warper.i_jobs = j;
+            goto end_filters;
+        }
+    }
+    const video_format_t *p_fmt_out = &warper.jobs[0].p_filter->fmt_out.video;
+
+    warper.i_slots = 2 * i_jobs;
+    warper.p_slots = calloc( warper.i_slots, sizeof( *warper.p_slots ) );
+    warper.p_layout = picture_NewFromFormat( p_fmt_out );
+    if( !warper.p_slots || !warper.p_layout )
+        goto end_filters;
+    for( int s = 0; s < warper.i_slots; s++ )
+        if( !( warper.p_slots[s].p_in = picture_NewFromFormat( &fmt ) ) )
+            goto end_slots;
+
+    warper.p_out = strcmp( psz_output, "-" ) ? vlc_fopen( psz_output, "wb" )
+                                             : stdout;
+    if( !warper.p_out )
+    {
+        perror( psz_output );
+        goto end_slots;
+    }
+    setvbuf( warper.p_out, NULL, _IOFBF, IO_BUFFER );
+    if( b_y4m_out )
+    {
+        unsigned i_sar_num = p_fmt_out->i_sar_num;
+        unsigned i_sar_den = p_fmt_out->i_sar_den;
+        if( !stream.i_sar_num )     /* Unknown, and still so */
+            i_sar_num = i_sar_den = 0;
+        fprintf( warper.p_out, "YUV4MPEG2 W%u H%u F%s I%c A%u:%u C%s\n",
+                 p_fmt_out->i_visible_width, p_fmt_out->i_visible_height,
+                 stream.psz_rate, stream.i_interlace, i_sar_num, i_sar_den,
+                 psz_y4m_chroma );
+    }
+
+    /* Warp */
+    pthread_mutex_init( &warper.lock, NULL );
+    pthread_cond_init( &warper.wait, NULL );
+    const double f_start = Now();
+    pthread_t writer;
+    int i_jobs_started = 0;
+    bool b_input_ok = false;
+    bool b_writer = !pthread_create( &writer, NULL, Writer, &warper );
+    for( ; b_writer && i_jobs_started < warper.i_jobs; i_jobs_started++ )
+        if( pthread_create( &warper.jobs[i_jobs_started].thread, NULL, Job,
+                            &warper.jobs[i_jobs_started] ) )
+            break;
+    if( b_writer && i_jobs_started )
+        b_input_ok = Read( &warper, &in, !b_raw );
+    else
+    {
+        pthread_mutex_lock( &warper.lock );
+        warper.b_error = true;
+        pthread_cond_broadcast( &warper.wait );
+        pthread_mutex_unlock( &warper.lock );
+    }
+    for( int j = 0; j < i_jobs_started; j++ )
+        pthread_join( warper.jobs[j].thread, NULL );
+    if( b_writer )
+        pthread_join( writer, NULL );
+    const double f_elapsed = Now() - f_start;
+    pthread_cond_destroy( &warper.wait );
+    pthread_mutex_destroy( &warper.lock );
+
+    if( fflush( warper.p_out ) )
+    {
+        perror( psz_output );
+        warper.b_error = true;
+    }
+    if( warper.p_out != stdout )
+        fclose( warper.p_out );
+
+    const double f_bytes = (double)warper.i_written
+                         * ( GetFrameSize( warper.p_slots[0].p_in )
+                           + GetFrameSize( warper.p_layout ) );
+    fprintf( stderr, "%"PRId64" pictures in %.2f s: %.1f fps, %.0f MB/s\n",
+             warper.i_written, f_elapsed, warper.i_written / f_elapsed,
+             f_bytes / f_elapsed / 1e6 );
+    if( b_input_ok && !warper.b_error )
+        i_ret = 0;
+
+end_slots:
+    for( int s = 0; s < warper.i_slots; s++ )
+    {
+        if( warper.p_slots[s].p_in )
+            picture_Release( warper.p_slots[s].p_in );
+        if( warper.p_slots[s].p_out )
+            picture_Release( warper.p_slots[s].p_out );
+    }
+    if( warper.p_layout )
+        picture_Release( warper.p_layout );
+    free( warper.p_slots );
+end_filters:
+    /* The first one last: the profile it saves is the final one */
+    for( int j = warper.i_jobs - 1; j >= 0; j-- )
+        shim_DeleteFilter( warper.jobs[j].p_filter, Destroy );
+end_input:
+    CloseInput( &in );
+    return i_ret;
+}
@@ -0,0 +1,28 @@
+/*****************************************************************************
+ * vlc_atomic.h: stand-in for the VLC atomic floats
+ *****************************************************************************/
+
+#ifndef VLCSHIM_ATOMIC_H
+#define VLCSHIM_ATOMIC_H 1
+
+typedef atomic_uint_least32_t vlc_atomic_float;
+
+static inline void vlc_atomic_init_float( vlc_atomic_float *var, float f )
+{
+    union { float f; uint32_t i; } u = { .f = f };
+    atomic_init( var, u.i );
+}
+
+static inline float vlc_atomic_load_float( vlc_atomic_float *atom )
+{
+    union { float f; uint32_t i; } u = { .i = atomic_load( atom ) };
+    return u.f;
+}
+
+static inline void vlc_atomic_store_float( vlc_atomic_float *atom, float f )
+{
+    union { float f; uint32_t i; } u = { .f = f };
+    atomic_store( atom, u.i );
+}
+
+#endif
@@ -0,0 +1,27 @@
+/*****************************************************************************
+ * vlc_charset.h: stand-in for the VLC locale independent conversions
+ *****************************************************************************/
+
+#ifndef VLCSHIM_CHARSET_H
+#define VLCSHIM_CHARSET_H 1
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* The tools never change the locale from "C" */
+static inline float us_strtof( const char *psz, char **ppsz_end )
+{
+    return strtof( psz, ppsz_end );
+}
+
+static inline int us_asprintf( char **ppsz, const char *psz_format, ... )
+{
+    va_list ap;
+    va_start( ap, psz_format );
+    int i_ret = vasprintf( ppsz, psz_format, ap );
+    va_end( ap );
+    return i_ret;
+}
+
+#endif
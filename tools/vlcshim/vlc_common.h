@@ -0,0 +1,170 @@
+/*****************************************************************************
+ * vlc_common.h: stand-in for the VLC core API used by the keystone filter
+ *****************************************************************************
+ * The tools build src/keystone.c outside of VLC against these headers and
+ * vlcshim.c. Only what the filter uses is declared, with the VLC 3 names
+ * and semantics; the configuration variables read their values from the
+ * table set by shim_SetOption().
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *****************************************************************************/
+
+#ifndef VLCSHIM_COMMON_H
+#define VLCSHIM_COMMON_H 1
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*****************************************************************************
+ * Basic types and macros
+ *****************************************************************************/
+typedef uint32_t vlc_fourcc_t;
+typedef int64_t  mtime_t;
+
+#define VLC_SUCCESS     0
+#define VLC_EGENERIC  (-1)
+#define VLC_ENOMEM    (-2)
+
+#define VLC_UNUSED(x) (void)(x)
+#define N_(str) str
+#define _(str) str
+
+#define __MIN(a, b) ( ((a) < (b)) ? (a) : (b) )
+#define __MAX(a, b) ( ((a) > (b)) ? (a) : (b) )
+#define VLC_CLIP(v, min, max) __MIN(__MAX((v), (min)), (max))
+#define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
+
+#define VLC_FOURCC(a, b, c, d) \
+    ( (uint32_t)(a) | ((uint32_t)(b) << 8) \
+    | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24) )
+
+#define CLOCK_FREQ INT64_C(1000000)
+#define VLC_TS_0   INT64_C(1)
+
+bool vlc_ureduce( unsigned *, unsigned *, uint64_t, uint64_t, uint64_t );
+
+static inline uint16_t GetWLE( const void *p )
+{
+    const uint8_t *q = p;
+    return q[0] | ( q[1] << 8 );
+}
+
+static inline uint16_t GetWBE( const void *p )
+{
+    const uint8_t *q = p;
+    return q[1] | ( q[0] << 8 );
+}
+
+static inline void SetWLE( void *p, uint16_t i_value )
+{
+    uint8_t *q = p;
+    q[0] = i_value;
+    q[1] = i_value >> 8;
+}
+
+static inline void SetWBE( void *p, uint16_t i_value )
+{
+    uint8_t *q = p;
+    q[1] = i_value;
+    q[0] = i_value >> 8;
+}
+
+/*****************************************************************************
+ * Objects, variables and messages
+ *****************************************************************************/
+typedef struct vlc_object_t vlc_object_t;
+
+struct vlc_common_members
+{
+    const char   *object_type;
+    vlc_object_t *parent;
+};
+
+struct vlc_object_t
+{
+    struct vlc_common_members obj;
+};
+
+#define VLC_COMMON_MEMBERS struct vlc_common_members obj;
+#define VLC_OBJECT(x) ((vlc_object_t *)(x))
+
+typedef union
+{
+    int64_t i_int;
+    bool    b_bool;
+    float   f_float;
+    char   *psz_string;
+} vlc_value_t;
+
+typedef int (*vlc_callback_t)( vlc_object_t *, char const *,
+                               vlc_value_t, vlc_value_t, void * );
+
+#define VLC_VAR_BOOL    0x0020
+#define VLC_VAR_INTEGER 0x0030
+#define VLC_VAR_STRING  0x0040
+#define VLC_VAR_FLOAT   0x0050
+
+int     var_Create( void *, const char *, int );
+void    var_Destroy( void *, const char * );
+int     var_AddCallback( void *, const char *, vlc_callback_t, void * );
+void    var_DelCallback( void *, const char *, vlc_callback_t, void * );
+float   var_GetFloat( void *, const char * );
+int     var_SetFloat( void *, const char *, float );
+int64_t var_GetInteger( void *, const char * );
+int     var_SetInteger( void *, const char *, int64_t );
+char   *var_GetString( void *, const char * );
+int     var_SetString( void *, const char *, const char * );
+bool    var_CreateGetBoolCommand( void *, const char * );
+int64_t var_CreateGetIntegerCommand( void *, const char * );
+float   var_CreateGetFloatCommand( void *, const char * );
+char   *var_CreateGetStringCommand( void *, const char * );
+
+typedef struct config_chain_t config_chain_t;
+#define config_ChainParse( obj, prefix, options, cfg ) \
+    ( (void)(obj), (void)(prefix), (void)(options), (void)(cfg) )
+
+void msg_Generic( void *, const char *, ... )
+    __attribute__(( format( printf, 2, 3 ) ));
+#define msg_Err( obj, ... )  msg_Generic( obj, __VA_ARGS__ )
+#define msg_Warn( obj, ... ) msg_Generic( obj, __VA_ARGS__ )
+#define msg_Info( obj, ... ) msg_Generic( obj, __VA_ARGS__ )
+#define msg_Dbg( obj, ... )  msg_Generic( obj, __VA_ARGS__ )
+
+/*****************************************************************************
+ * Threads and time
+ *****************************************************************************/
+typedef pthread_mutex_t vlc_mutex_t;
+typedef pthread_cond_t  vlc_cond_t;
+typedef pthread_t       vlc_thread_t;
+
+#define VLC_THREAD_PRIORITY_VIDEO 0
+
+#define vlc_mutex_init( m )      pthread_mutex_init( m, NULL )
+#define vlc_mutex_destroy( m )   pthread_mutex_destroy( m )
+#define vlc_mutex_lock( m )      pthread_mutex_lock( m )
+#define vlc_mutex_unlock( m )    pthread_mutex_unlock( m )
+#define vlc_cond_init( c )       pthread_cond_init( c, NULL )
+#define vlc_cond_destroy( c )    pthread_cond_destroy( c )
+#define vlc_cond_signal( c )     pthread_cond_signal( c )
+#define vlc_cond_broadcast( c )  pthread_cond_broadcast( c )
+#define vlc_cond_wait( c, m )    pthread_cond_wait( c, m )
+#define vlc_join( t, r )         pthread_join( t, r )
+
+int      vlc_clone( vlc_thread_t *, void *(*)( void * ), void *, int );
+unsigned vlc_GetCPUCount( void );
+mtime_t  mdate( void );
+
+#include "vlc_fourcc.h"
+#include "vlc_es.h"
+
+#endif
@@ -0,0 +1,14 @@
+/*****************************************************************************
+ * vlc_cpu.h: stand-in for the VLC CPU capabilities
+ *****************************************************************************/
+
+#ifndef VLCSHIM_CPU_H
+#define VLCSHIM_CPU_H 1
+
+#if defined(__i386__) || defined(__x86_64__)
+# define vlc_CPU_SSE2()   __builtin_cpu_supports( "sse2" )
+# define vlc_CPU_SSE4_1() __builtin_cpu_supports( "sse4.1" )
+# define vlc_CPU_AVX2()   __builtin_cpu_supports( "avx2" )
+#endif
+
+#endif
@@ -0,0 +1,38 @@
+/*****************************************************************************
+ * vlc_es.h: stand-in for the VLC video formats
+ *****************************************************************************/
+
+#ifndef VLCSHIM_ES_H
+#define VLCSHIM_ES_H 1
+
+typedef struct
+{
+    int     i_entries;
+    uint8_t palette[256][4];
+} video_palette_t;
+
+typedef struct
+{
+    vlc_fourcc_t i_chroma;
+    unsigned i_width, i_height;
+    unsigned i_x_offset, i_y_offset;
+    unsigned i_visible_width, i_visible_height;
+    unsigned i_sar_num, i_sar_den;
+    video_palette_t *p_palette;
+
+    /* Packed RGB */
+    uint32_t i_rmask, i_gmask, i_bmask;
+    int i_rrshift, i_lrshift;
+    int i_rgshift, i_lgshift;
+    int i_rbshift, i_lbshift;
+} video_format_t;
+
+typedef struct
+{
+    video_format_t video;
+} es_format_t;
+
+void video_format_Init( video_format_t *, vlc_fourcc_t );
+void video_format_FixRgb( video_format_t * );
+
+#endif
@@ -0,0 +1,31 @@
+/*****************************************************************************
+ * vlc_filter.h: stand-in for the VLC video filters
+ *****************************************************************************/
+
+#ifndef VLCSHIM_FILTER_H
+#define VLCSHIM_FILTER_H 1
+
+#include <vlc_picture.h>
+#include <vlc_mouse.h>
+
+typedef struct filter_sys_t filter_sys_t;
+typedef struct filter_t filter_t;
+
+struct filter_t
+{
+    VLC_COMMON_MEMBERS
+
+    es_format_t fmt_in;
+    es_format_t fmt_out;
+    const config_chain_t *p_cfg;
+
+    picture_t *(*pf_video_filter)( filter_t *, picture_t * );
+    int (*pf_video_mouse)( filter_t *, vlc_mouse_t *,
+                           const vlc_mouse_t *, const vlc_mouse_t * );
+
+    filter_sys_t *p_sys;
+};
+
+picture_t *filter_NewPicture( filter_t * );
+
+#endif
@@ -0,0 +1,56 @@
+/*****************************************************************************
+ * vlc_fourcc.h: stand-in for the VLC chroma codes used by the keystone filter
+ *****************************************************************************/
+
+#ifndef VLCSHIM_FOURCC_H
+#define VLCSHIM_FOURCC_H 1
+
+#define VLC_CODEC_I410      VLC_FOURCC('I','4','1','0')
+#define VLC_CODEC_I411      VLC_FOURCC('I','4','1','1')
+#define VLC_CODEC_I420      VLC_FOURCC('I','4','2','0')
+#define VLC_CODEC_YV12      VLC_FOURCC('Y','V','1','2')
+#define VLC_CODEC_J420      VLC_FOURCC('J','4','2','0')
+#define VLC_CODEC_I422      VLC_FOURCC('I','4','2','2')
+#define VLC_CODEC_J422      VLC_FOURCC('J','4','2','2')
+#define VLC_CODEC_I444      VLC_FOURCC('I','4','4','4')
+#define VLC_CODEC_J444      VLC_FOURCC('J','4','4','4')
+#define VLC_CODEC_YUVA      VLC_FOURCC('Y','U','V','A')
+#define VLC_CODEC_YUVP      VLC_FOURCC('Y','U','V','P')
+#define VLC_CODEC_I420_9L   VLC_FOURCC('I','0','9','L')
+#define VLC_CODEC_I420_9B   VLC_FOURCC('I','0','9','B')
+#define VLC_CODEC_I420_10L  VLC_FOURCC('I','0','A','L')
+#define VLC_CODEC_I420_10B  VLC_FOURCC('I','0','A','B')
+#define VLC_CODEC_I444_9L   VLC_FOURCC('I','4','9','L')
+#define VLC_CODEC_I444_9B   VLC_FOURCC('I','4','9','B')
+#define VLC_CODEC_I444_10L  VLC_FOURCC('I','4','A','L')
+#define VLC_CODEC_I444_10B  VLC_FOURCC('I','4','A','B')
+#define VLC_CODEC_NV12      VLC_FOURCC('N','V','1','2')
+#define VLC_CODEC_NV21      VLC_FOURCC('N','V','2','1')
+#define VLC_CODEC_YUYV      VLC_FOURCC('Y','U','Y','2')
+#define VLC_CODEC_YVYU      VLC_FOURCC('Y','V','Y','U')
+#define VLC_CODEC_UYVY      VLC_FOURCC('U','Y','V','Y')
+#define VLC_CODEC_VYUY      VLC_FOURCC('V','Y','U','Y')
+#define VLC_CODEC_RGB24     VLC_FOURCC('R','V','2','4')
+#define VLC_CODEC_RGB32     VLC_FOURCC('R','V','3','2')
+#define VLC_CODEC_RGBA      VLC_FOURCC('R','G','B','A')
+
+typedef struct
+{
+    unsigned num, den;
+} vlc_rational_t;
+
+typedef struct
+{
+    unsigned plane_count;
+    struct
+    {
+        vlc_rational_t w;
+        vlc_rational_t h;
+    } p[4];
+    unsigned pixel_size;    /* Bytes per pixel of a plane */
+    unsigned pixel_bits;    /* Significant bits per sample */
+} vlc_chroma_description_t;
+
+const vlc_chroma_description_t *vlc_fourcc_GetChromaDescription( vlc_fourcc_t );
+
+#endif
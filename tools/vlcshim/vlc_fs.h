@@ -0,0 +1,38 @@
+/*****************************************************************************
+ * vlc_fs.h: stand-in for the VLC file system helpers
+ *****************************************************************************/
+
+#ifndef VLCSHIM_FS_H
+#define VLCSHIM_FS_H 1
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+/* Paths are already in the locale encoding */
+static inline FILE *vlc_fopen( const char *psz_path, const char *psz_mode )
+{
+    return fopen( psz_path, psz_mode );
+}
+
+static inline int vlc_open( const char *psz_path, int i_flags )
+{
+    return open( psz_path, i_flags | O_CLOEXEC );
+}
+
+static inline int vlc_close( int fd )
+{
+    return close( fd );
+}
+
+static inline int vlc_rename( const char *psz_old, const char *psz_new )
+{
+    return rename( psz_old, psz_new );
+}
+
+static inline int vlc_unlink( const char *psz_path )
+{
+    return unlink( psz_path );
+}
+
+#endif
@@ -0,0 +1,55 @@
+/*****************************************************************************
+ * vlc_mouse.h: stand-in for the VLC mouse state
+ *****************************************************************************/
+
+#ifndef VLCSHIM_MOUSE_H
+#define VLCSHIM_MOUSE_H 1
+
+enum
+{
+    MOUSE_BUTTON_LEFT = 0,
+};
+
+typedef struct vlc_mouse_t
+{
+    int  i_x, i_y;
+    int  i_pressed;
+    bool b_double_click;
+} vlc_mouse_t;
+
+static inline bool vlc_mouse_IsPressed( const vlc_mouse_t *p_mouse,
+                                        int i_button )
+{
+    return p_mouse->i_pressed & ( 1 << i_button );
+}
+
+static inline bool vlc_mouse_IsLeftPressed( const vlc_mouse_t *p_mouse )
+{
+    return vlc_mouse_IsPressed( p_mouse, MOUSE_BUTTON_LEFT );
+}
+
+static inline bool vlc_mouse_HasPressed( const vlc_mouse_t *p_old,
+                                         const vlc_mouse_t *p_new,
+                                         int i_button )
+{
+    return !vlc_mouse_IsPressed( p_old, i_button )
+         && vlc_mouse_IsPressed( p_new, i_button );
+}
+
+static inline bool vlc_mouse_HasReleased( const vlc_mouse_t *p_old,
+                                          const vlc_mouse_t *p_new,
+                                          int i_button )
+{
+    return vlc_mouse_IsPressed( p_old, i_button )
+        && !vlc_mouse_IsPressed( p_new, i_button );
+}
+
+static inline void vlc_mouse_GetMotion( int *pi_x, int *pi_y,
+                                        const vlc_mouse_t *p_old,
+                                        const vlc_mouse_t *p_new )
+{
+    *pi_x = p_new->i_x - p_old->i_x;
+    *pi_y = p_new->i_y - p_old->i_y;
+}
+
+#endif
@@ -0,0 +1,43 @@
+/*****************************************************************************
+ * vlc_picture.h: stand-in for the VLC pictures
+ *****************************************************************************/
+
+#ifndef VLCSHIM_PICTURE_H
+#define VLCSHIM_PICTURE_H 1
+
+#define PICTURE_PLANE_MAX 5
+
+typedef struct plane_t
+{
+    uint8_t *p_pixels;
+    int i_lines;            /* Lines, margin included */
+    int i_pitch;            /* Bytes per line, margin included */
+    int i_pixel_pitch;      /* Bytes per pixel */
+    int i_visible_lines;
+    int i_visible_pitch;
+} plane_t;
+
+typedef struct picture_t
+{
+    video_format_t format;
+    plane_t p[PICTURE_PLANE_MAX];
+    int     i_planes;
+    mtime_t date;
+    atomic_uint i_refs;
+    bool    b_pooled;       /* Recycled by filter_NewPicture() once released */
+} picture_t;
+
+enum
+{
+    Y_PLANE = 0,
+    U_PLANE = 1,
+    V_PLANE = 2,
+    A_PLANE = 3,
+};
+
+picture_t *picture_NewFromFormat( const video_format_t * );
+picture_t *picture_Hold( picture_t * );
+void       picture_Release( picture_t * );
+void       picture_CopyProperties( picture_t *, const picture_t * );
+
+#endif
@@ -0,0 +1,49 @@
+/*****************************************************************************
+ * vlc_plugin.h: stand-in for the VLC module descriptor
+ *****************************************************************************
+ * The option values come from shim_SetOption(), and default to the ones
+ * declared by the descriptor.
+ *****************************************************************************/
+
+#ifndef VLCSHIM_PLUGIN_H
+#define VLCSHIM_PLUGIN_H 1
+
+#define CAT_VIDEO               4
+#define SUBCAT_VIDEO_VFILTER    402
+
+/* Defaults of the options, read by the var_CreateGet*Command() stand-ins */
+void shim_DefaultBool( const char *, bool );
+void shim_DefaultInteger( const char *, int64_t );
+void shim_DefaultFloat( const char *, double );
+void shim_DefaultString( const char *, const char * );
+
+/* The descriptor becomes a function registering the option defaults, that
+ * the tools call once before opening a filter */
+#define vlc_module_begin() \
+    static void __attribute__(( unused )) vlc_module_defaults( void ) {
+#define vlc_module_end() }
+
+#define set_description( text )             (void)(text);
+#define set_shortname( text )               (void)(text);
+#define set_category( cat )                 (void)(cat);
+#define set_subcategory( cat )              (void)(cat);
+#define set_capability( cap, score )        (void)(cap); (void)(score);
+#define set_callbacks( open, close )        (void)(open); (void)(close);
+#define add_shortcut( ... )                 ;
+#define add_bool( name, v, text, longtext, advc ) \
+    shim_DefaultBool( name, v ); (void)(text); (void)(longtext);
+#define add_string( name, v, text, longtext, advc ) \
+    shim_DefaultString( name, v ); (void)(text); (void)(longtext);
+#define add_integer_with_range( name, v, min, max, text, longtext, advc ) \
+    shim_DefaultInteger( name, v ); (void)(text); (void)(longtext);
+#define add_float_with_range( name, v, min, max, text, longtext, advc ) \
+    shim_DefaultFloat( name, v ); (void)(text); (void)(longtext);
+#define add_loadfile( name, v, text, longtext, advc ) \
+    shim_DefaultString( name, v ); (void)(text); (void)(longtext);
+#define add_savefile( name, v, text, longtext, advc ) \
+    shim_DefaultString( name, v ); (void)(text); (void)(longtext);
+#define change_string_list( values, texts ) (void)(values); (void)(texts);
+#define change_safe()                       ;
+#define change_private()                    ;
+
+#endif
@@ -0,0 +1,42 @@
+/*****************************************************************************
+ * vlc_subpicture.h: stand-in for the VLC subpictures
+ *****************************************************************************
+ * The tools never run under a video output: the filter draws no overlay,
+ * and these are only declared for it to build.
+ *****************************************************************************/
+
+#ifndef VLCSHIM_SUBPICTURE_H
+#define VLCSHIM_SUBPICTURE_H 1
+
+#include <vlc_picture.h>
+
+#define SUBPICTURE_ALIGN_LEFT   0x1
+#define SUBPICTURE_ALIGN_RIGHT  0x2
+#define SUBPICTURE_ALIGN_TOP    0x4
+#define SUBPICTURE_ALIGN_BOTTOM 0x8
+
+typedef struct subpicture_region_t
+{
+    video_format_t fmt;
+    picture_t *p_picture;
+    int i_x, i_y;
+    int i_align;
+} subpicture_region_t;
+
+typedef struct subpicture_t
+{
+    int i_channel;
+    subpicture_region_t *p_region;
+    mtime_t i_start, i_stop;
+    bool b_ephemer, b_subtitle, b_absolute;
+    int i_original_picture_width, i_original_picture_height;
+} subpicture_t;
+
+typedef struct subpicture_updater_t subpicture_updater_t;
+
+subpicture_t *subpicture_New( const subpicture_updater_t * );
+void subpicture_Delete( subpicture_t * );
+subpicture_region_t *subpicture_region_New( const video_format_t * );
+void subpicture_region_Delete( subpicture_region_t * );
+
+#endif
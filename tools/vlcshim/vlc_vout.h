@@ -0,0 +1,19 @@
+/*****************************************************************************
+ * vlc_vout.h: stand-in for the VLC video output
+ *****************************************************************************/
+
+#ifndef VLCSHIM_VOUT_H
+#define VLCSHIM_VOUT_H 1
+
+#include <vlc_subpicture.h>
+
+typedef struct vout_thread_t
+{
+    VLC_COMMON_MEMBERS
+} vout_thread_t;
+
+int  vout_RegisterSubpictureChannel( vout_thread_t * );
+void vout_PutSubpicture( vout_thread_t *, subpicture_t * );
+void vout_FlushSubpictureChannel( vout_thread_t *, int );
+
+#endif
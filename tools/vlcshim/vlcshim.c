@@ -0,0 +1,700 @@
+/*****************************************************************************
+ * vlcshim.c: stand-in for the VLC core functions used by the keystone filter
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *****************************************************************************/
+
+#include <limits.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <vlc_common.h>
+#include <vlc_picture.h>
+#include <vlc_filter.h>
+#include <vlc_vout.h>
+#include "vlcshim.h"
+
+/*****************************************************************************
+ * Options and variables
+ *****************************************************************************/
+#define MAX_OPTIONS 64
+
+typedef struct
+{
+    char *psz_name;
+    char *psz_value;
+} shim_option_t;
+
+static shim_option_t options[MAX_OPTIONS], defaults[MAX_OPTIONS];
+static int i_options, i_defaults;
+
+typedef struct shim_var_t
+{
+    void *p_obj;
+    char *psz_name;
+    vlc_value_t val;
+    bool b_string;              /* val owns a copy of its string */
+    vlc_callback_t pf_callback;
+    void *p_data;
+    struct shim_var_t *p_next;
+} shim_var_t;
+
+static shim_var_t *p_vars;
+static pthread_mutex_t vars_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool b_verbose;
+
+static void SetOption( shim_option_t *p_table, int *pi_count,
+                       const char *psz_name, const char *psz_value )
+{
+    int i;
+    for( i = 0; i < *pi_count; i++ )
+        if( !strcmp( p_table[i].psz_name, psz_name ) )
+            break;
+
+    if( i == *pi_count )
+    {
+        if( !psz_value || *pi_count == MAX_OPTIONS )
+            return;
+        p_table[i].psz_name = strdup( psz_name );
+        p_table[i].psz_value = NULL;
+        ( *pi_count )++;
+    }
+    free( p_table[i].psz_value );
+    p_table[i].psz_value = psz_value ? strdup( psz_value ) : NULL;
+}
+
+void shim_SetOption( const char *psz_name, const char *psz_value )
+{
+    SetOption( options, &i_options, psz_name, psz_value );
+}
+
+void shim_ClearOptions( void )
+{
+    for( int i = 0; i < i_options; i++ )
+    {
+        free( options[i].psz_name );
+        free( options[i].psz_value );
+    }
+    i_options = 0;
+}
+
+void shim_DefaultBool( const char *psz_name, bool b )
+{
+    SetOption( defaults, &i_defaults, psz_name, b ? "1" : "0" );
+}
+
+void shim_DefaultInteger( const char *psz_name, int64_t i )
+{
+    char psz[32];
+    snprintf( psz, sizeof( psz ), "%"PRId64, i );
+    SetOption( defaults, &i_defaults, psz_name, psz );
+}
+
+void shim_DefaultFloat( const char *psz_name, double f )
+{
+    char psz[32];
+    snprintf( psz, sizeof( psz ), "%.9g", f );
+    SetOption( defaults, &i_defaults, psz_name, psz );
+}
+
+void shim_DefaultString( const char *psz_name, const char *psz_value )
+{
+    SetOption( defaults, &i_defaults, psz_name, psz_value ? psz_value : "" );
+}
+
+/* Value set by the tool, else the default of the descriptor */
+static const char *GetOption( const char *psz_name )
+{
+    for( int i = 0; i < i_options; i++ )
+        if( !strcmp( options[i].psz_name, psz_name ) && options[i].psz_value )
+            return options[i].psz_value;
+    for( int i = 0; i < i_defaults; i++ )
+        if( !strcmp( defaults[i].psz_name, psz_name ) )
+            return defaults[i].psz_value;
+    return NULL;
+}
+
+void shim_SetVerbose( bool b )
+{
+    b_verbose = b;
+}
+
+/* Variable of an object, created on first use (vars_lock held) */
+static shim_var_t *GetVar( void *p_obj, const char *psz_name )
+{
+    for( shim_var_t *p_var = p_vars; p_var; p_var = p_var->p_next )
+        if( p_var->p_obj == p_obj && !strcmp( p_var->psz_name, psz_name ) )
+            return p_var;
+
+    shim_var_t *p_var = calloc( 1, sizeof( *p_var ) );
+    if( !p_var )
+        abort();
+    p_var->p_obj = p_obj;
+    p_var->psz_name = strdup( psz_name );
+    p_var->p_next = p_vars;
+    p_vars = p_var;
+    return p_var;
+}
+
+static void DeleteVars( void *p_obj )
+{
+    pthread_mutex_lock( &vars_lock );
+    for( shim_var_t **pp = &p_vars; *pp; )
+    {
+        shim_var_t *p_var = *pp;
+        if( p_var->p_obj != p_obj )
+        {
+            pp = &p_var->p_next;
+            continue;
+        }
+        *pp = p_var->p_next;
+        if( p_var->b_string )
+            free( p_var->val.psz_string );
+        free( p_var->psz_name );
+        free( p_var );
+    }
+    pthread_mutex_unlock( &vars_lock );
+}
+
+int var_Create( void *p_obj, const char *psz_name, int i_type )
+{
+    VLC_UNUSED( i_type );
+    pthread_mutex_lock( &vars_lock );
+    GetVar( p_obj, psz_name );
+    pthread_mutex_unlock( &vars_lock );
+    return VLC_SUCCESS;
+}
+
+void var_Destroy( void *p_obj, const char *psz_name )
+{
+    VLC_UNUSED( p_obj );
+    VLC_UNUSED( psz_name );
+}
+
+int var_AddCallback( void *p_obj, const char *psz_name,
+                     vlc_callback_t pf_callback, void *p_data )
+{
+    pthread_mutex_lock( &vars_lock );
+    shim_var_t *p_var = GetVar( p_obj, psz_name );
+    p_var->pf_callback = pf_callback;
+    p_var->p_data = p_data;
+    pthread_mutex_unlock( &vars_lock );
+    return VLC_SUCCESS;
+}
+
+void var_DelCallback( void *p_obj, const char *psz_name,
+                      vlc_callback_t pf_callback, void *p_data )
+{
+    VLC_UNUSED( pf_callback );
+    VLC_UNUSED( p_data );
+    pthread_mutex_lock( &vars_lock );
+    GetVar( p_obj, psz_name )->pf_callback = NULL;
+    pthread_mutex_unlock( &vars_lock );
+}
+
+float var_GetFloat( void *p_obj, const char *psz_name )
+{
+    pthread_mutex_lock( &vars_lock );
+    float f = GetVar( p_obj, psz_name )->val.f_float;
+    pthread_mutex_unlock( &vars_lock );
+    return f;
+}
+
+int64_t var_GetInteger( void *p_obj, const char *psz_name )
+{
+    pthread_mutex_lock( &vars_lock );
+    int64_t i = GetVar( p_obj, psz_name )->val.i_int;
+    pthread_mutex_unlock( &vars_lock );
+    return i;
+}
+
+char *var_GetString( void *p_obj, const char *psz_name )
+{
+    pthread_mutex_lock( &vars_lock );
+    const shim_var_t *p_var = GetVar( p_obj, psz_name );
+    char *psz = strdup( p_var->b_string ? p_var->val.psz_string : "" );
+    pthread_mutex_unlock( &vars_lock );
+    return psz;
+}
+
+/* Callbacks run outside of the lock, with the values they are given */
+static int SetVar( void *p_obj, const char *psz_name, vlc_value_t val,
+                   bool b_string )
+{
+    pthread_mutex_lock( &vars_lock );
+    shim_var_t *p_var = GetVar( p_obj, psz_name );
+    vlc_value_t old = p_var->val;
+    const bool b_old_string = p_var->b_string;
+    vlc_callback_t pf_callback = p_var->pf_callback;
+    void *p_data = p_var->p_data;
+    p_var->val = val;
+    p_var->b_string = b_string;
+    if( b_string )
+        val.psz_string = strdup( val.psz_string );
+    pthread_mutex_unlock( &vars_lock );
+
+    if( pf_callback )
+        pf_callback( VLC_OBJECT( p_obj ), psz_name, old, val, p_data );
+    if( b_string )
+        free( val.psz_string );
+    if( b_old_string )
+        free( old.psz_string );
+    return VLC_SUCCESS;
+}
+
+int var_SetFloat( void *p_obj, const char *psz_name, float f )
+{
+    return SetVar( p_obj, psz_name, (vlc_value_t){ .f_float = f }, false );
+}
+
+int var_SetInteger( void *p_obj, const char *psz_name, int64_t i )
+{
+    return SetVar( p_obj, psz_name, (vlc_value_t){ .i_int = i }, false );
+}
+
+int var_SetString( void *p_obj, const char *psz_name, const char *psz )
+{
+    char *psz_copy = strdup( psz ? psz : "" );
+    if( !psz_copy )
+        abort();
+    return SetVar( p_obj, psz_name,
+                   (vlc_value_t){ .psz_string = psz_copy }, true );
+}
+
+bool var_CreateGetBoolCommand( void *p_obj, const char *psz_name )
+{
+    const char *psz = GetOption( psz_name );
+    bool b = psz && strcmp( psz, "0" ) && strcmp( psz, "false" );
+    var_Create( p_obj, psz_name, VLC_VAR_BOOL );
+    return b;
+}
+
+int64_t var_CreateGetIntegerCommand( void *p_obj, const char *psz_name )
+{
+    const char *psz = GetOption( psz_name );
+    var_Create( p_obj, psz_name, VLC_VAR_INTEGER );
+    return psz ? strtoll( psz, NULL, 0 ) : 0;
+}
+
+float var_CreateGetFloatCommand( void *p_obj, const char *psz_name )
+{
+    const char *psz = GetOption( psz_name );
+    var_Create( p_obj, psz_name, VLC_VAR_FLOAT );
+    return psz ? strtof( psz, NULL ) : 0.f;
+}
+
+char *var_CreateGetStringCommand( void *p_obj, const char *psz_name )
+{
+    const char *psz = GetOption( psz_name );
+    var_Create( p_obj, psz_name, VLC_VAR_STRING );
+    return strdup( psz ? psz : "" );
+}
+
+void msg_Generic( void *p_obj, const char *psz_format, ... )
+{
+    VLC_UNUSED( p_obj );
+    if( !b_verbose )
+        return;
+
+    va_list ap;
+    va_start( ap, psz_format );
+    fputs( "keystone: ", stderr );
+    vfprintf( stderr, psz_format, ap );
+    fputc( '\n', stderr );
+    va_end( ap );
+}
+
+/*****************************************************************************
+ * Threads and time
+ *****************************************************************************/
+int vlc_clone( vlc_thread_t *p_thread, void *(*pf_entry)( void * ),
+               void *p_data, int i_priority )
+{
+    VLC_UNUSED( i_priority );
+    return pthread_create( p_thread, NULL, pf_entry, p_data );
+}
+
+unsigned vlc_GetCPUCount( void )
+{
+    long i_count = sysconf( _SC_NPROCESSORS_ONLN );
+    return i_count > 0 ? i_count : 1;
+}
+
+mtime_t mdate( void )
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * CLOCK_FREQ + ts.tv_nsec / 1000;
+}
+
+bool vlc_ureduce( unsigned *pi_dst_nom, unsigned *pi_dst_den,
+                  uint64_t i_nom, uint64_t i_den, uint64_t i_max )
+{
+    bool b_exact = true;
+    uint64_t a = i_nom, b = i_den;
+
+    while( b )
+    {
+        const uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+    if( a )
+    {
+        i_nom /= a;
+        i_den /= a;
+    }
+
+    /* Coarser ratio within the limit, instead of the best approximation */
+    if( !i_max || i_max > UINT_MAX )
+        i_max = UINT_MAX;
+    while( i_nom > i_max || i_den > i_max )
+    {
+        i_nom = ( i_nom + 1 ) / 2;
+        i_den = ( i_den + 1 ) / 2;
+        b_exact = false;
+    }
+    *pi_dst_nom = i_nom;
+    *pi_dst_den = i_den;
+    return b_exact;
+}
+
+/*****************************************************************************
+ * Formats and pictures
+ *****************************************************************************/
+#define PLANAR( count, w_den, h_den, size, bits ) \
+    { .plane_count = count, \
+      .p = { { { 1, 1 }, { 1, 1 } }, { { 1, w_den }, { 1, h_den } }, \
+             { { 1, w_den }, { 1, h_den } }, { { 1, 1 }, { 1, 1 } } }, \
+      .pixel_size = size, .pixel_bits = bits }
+#define SEMIPLANAR( w_den, h_den ) \
+    { .plane_count = 2, \
+      .p = { { { 1, 1 }, { 1, 1 } }, { { 2, w_den }, { 1, h_den } } }, \
+      .pixel_size = 1, .pixel_bits = 8 }
+#define PACKED( size, bits ) \
+    { .plane_count = 1, .p = { { { 1, 1 }, { 1, 1 } } }, \
+      .pixel_size = size, .pixel_bits = bits }
+
+static const struct
+{
+    vlc_fourcc_t i_chroma;
+    vlc_chroma_description_t dsc;
+} chromas[] = {
+    { VLC_CODEC_I410,     PLANAR( 3, 4, 4, 1, 8 ) },
+    { VLC_CODEC_I411,     PLANAR( 3, 4, 1, 1, 8 ) },
+    { VLC_CODEC_I420,     PLANAR( 3, 2, 2, 1, 8 ) },
+    { VLC_CODEC_YV12,     PLANAR( 3, 2, 2, 1, 8 ) },
+    { VLC_CODEC_J420,     PLANAR( 3, 2, 2, 1, 8 ) },
+    { VLC_CODEC_I422,     PLANAR( 3, 2, 1, 1, 8 ) },
+    { VLC_CODEC_J422,     PLANAR( 3, 2, 1, 1, 8 ) },
+    { VLC_CODEC_I444,     PLANAR( 3, 1, 1, 1, 8 ) },
+    { VLC_CODEC_J444,     PLANAR( 3, 1, 1, 1, 8 ) },
+    { VLC_CODEC_YUVA,     PLANAR( 4, 1, 1, 1, 8 ) },
+    { VLC_CODEC_YUVP,     PLANAR( 1, 1, 1, 1, 8 ) },
+    { VLC_CODEC_I420_9L,  PLANAR( 3, 2, 2, 2, 9 ) },
+    { VLC_CODEC_I420_9B,  PLANAR( 3, 2, 2, 2, 9 ) },
+    { VLC_CODEC_I420_10L, PLANAR( 3, 2, 2, 2, 10 ) },
+    { VLC_CODEC_I420_10B, PLANAR( 3, 2, 2, 2, 10 ) },
+    { VLC_CODEC_I444_9L,  PLANAR( 3, 1, 1, 2, 9 ) },
+    { VLC_CODEC_I444_9B,  PLANAR( 3, 1, 1, 2, 9 ) },
+    { VLC_CODEC_I444_10L, PLANAR( 3, 1, 1, 2, 10 ) },
+    { VLC_CODEC_I444_10B, PLANAR( 3, 1, 1, 2, 10 ) },
+    { VLC_CODEC_NV12,     SEMIPLANAR( 2, 2 ) },
+    { VLC_CODEC_NV21,     SEMIPLANAR( 2, 2 ) },
+    { VLC_CODEC_YUYV,     PACKED( 2, 16 ) },
+    { VLC_CODEC_YVYU,     PACKED( 2, 16 ) },
+    { VLC_CODEC_UYVY,     PACKED( 2, 16 ) },
+    { VLC_CODEC_VYUY,     PACKED( 2, 16 ) },
+    { VLC_CODEC_RGB24,    PACKED( 3, 24 ) },
+    { VLC_CODEC_RGB32,    PACKED( 4, 32 ) },
+    { VLC_CODEC_RGBA,     PACKED( 4, 32 ) },
+};
+
+const vlc_chroma_description_t *
+vlc_fourcc_GetChromaDescription( vlc_fourcc_t i_chroma )
+{
+    for( size_t i = 0; i < ARRAY_SIZE( chromas ); i++ )
+        if( chromas[i].i_chroma == i_chroma )
+            return &chromas[i].dsc;
+    return NULL;
+}
+
+void video_format_Init( video_format_t *p_fmt, vlc_fourcc_t i_chroma )
+{
+    memset( p_fmt, 0, sizeof( *p_fmt ) );
+    p_fmt->i_chroma = i_chroma;
+}
+
+static void MaskToShift( int *pi_left, int *pi_right, uint32_t i_mask )
+{
+    int i_low = 0, i_high = 0;
+
+    if( !i_mask )
+    {
+        *pi_left = *pi_right = 0;
+        return;
+    }
+    while( !( i_mask & 1 ) )
+    {
+        i_mask >>= 1;
+        i_low++;
+    }
+    while( i_mask & 1 )
+    {
+        i_mask >>= 1;
+        i_high++;
+    }
+    *pi_left = i_low;
+    *pi_right = 8 - i_high;
+}
+
+void video_format_FixRgb( video_format_t *p_fmt )
+{
+    /* Default masks of the VLC RGB chromas */
+    if( !p_fmt->i_rmask || !p_fmt->i_gmask || !p_fmt->i_bmask )
+    {
+        if( p_fmt->i_chroma == VLC_CODEC_RGB24
+         || p_fmt->i_chroma == VLC_CODEC_RGB32 )
+        {
+            p_fmt->i_rmask = 0xff0000;
+            p_fmt->i_gmask = 0x00ff00;
+            p_fmt->i_bmask = 0x0000ff;
+        }
+    }
+    MaskToShift( &p_fmt->i_lrshift, &p_fmt->i_rrshift, p_fmt->i_rmask );
+    MaskToShift( &p_fmt->i_lgshift, &p_fmt->i_rgshift, p_fmt->i_gmask );
+    MaskToShift( &p_fmt->i_lbshift, &p_fmt->i_rbshift, p_fmt->i_bmask );
+}
+
+static unsigned Scale( unsigned i_size, const vlc_rational_t *p_ratio )
+{
+    return ( i_size * p_ratio->num + p_ratio->den - 1 ) / p_ratio->den;
+}
+
+/* Released output pictures, reused like the pools of the video outputs so
+ * that the tools do not time page faults */
+#define POOL_SIZE 8
+
+static picture_t *pool[POOL_SIZE];
+static int i_pool;
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void DeletePicture( picture_t *p_pic )
+{
+    for( int i = 0; i < p_pic->i_planes; i++ )
+        free( p_pic->p[i].p_pixels );
+    free( p_pic );
+}
+
+picture_t *picture_NewFromFormat( const video_format_t *p_fmt )
+{
+    const vlc_chroma_description_t *p_dsc =
+        vlc_fourcc_GetChromaDescription( p_fmt->i_chroma );
+    if( !p_dsc )
+        return NULL;
+
+    picture_t *p_pic = calloc( 1, sizeof( *p_pic ) );
+    if( !p_pic )
+        return NULL;
+    p_pic->format = *p_fmt;
+    p_pic->format.p_palette = NULL;
+    p_pic->i_planes = p_dsc->plane_count;
+    atomic_init( &p_pic->i_refs, 1 );
+
+    /* Lines padded to 64 bytes, plus a margin line, like the VLC pools */
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p = &p_pic->p[i];
+        const unsigned i_width = Scale( p_fmt->i_width, &p_dsc->p[i].w );
+
+        p->i_pixel_pitch   = p_dsc->pixel_size;
+        p->i_pitch         = ( i_width * p_dsc->pixel_size + 63 ) / 64 * 64;
+        p->i_lines         = Scale( p_fmt->i_height, &p_dsc->p[i].h ) + 1;
+        p->i_visible_pitch = Scale( p_fmt->i_visible_width, &p_dsc->p[i].w )
+                           * p_dsc->pixel_size;
+        p->i_visible_lines = Scale( p_fmt->i_visible_height, &p_dsc->p[i].h );
+        p->p_pixels = aligned_alloc( 64, (size_t)p->i_pitch * p->i_lines );
+        if( !p->p_pixels )
+        {
+            p_pic->i_planes = i;
+            DeletePicture( p_pic );
+            return NULL;
+        }
+        memset( p->p_pixels, 0, (size_t)p->i_pitch * p->i_lines );
+    }
+    return p_pic;
+}
+
+picture_t *picture_Hold( picture_t *p_pic )
+{
+    atomic_fetch_add( &p_pic->i_refs, 1 );
+    return p_pic;
+}
+
+void picture_Release( picture_t *p_pic )
+{
+    if( atomic_fetch_sub( &p_pic->i_refs, 1 ) != 1 )
+        return;
+
+    if( p_pic->b_pooled )
+    {
+        pthread_mutex_lock( &pool_lock );
+        if( i_pool < POOL_SIZE )
+        {
+            pool[i_pool++] = p_pic;
+            p_pic = NULL;
+        }
+        pthread_mutex_unlock( &pool_lock );
+    }
+    if( p_pic )
+        DeletePicture( p_pic );
+}
+
+static void ClearPool( void )
+{
+    pthread_mutex_lock( &pool_lock );
+    while( i_pool > 0 )
+        DeletePicture( pool[--i_pool] );
+    pthread_mutex_unlock( &pool_lock );
+}
+
+void picture_CopyProperties( picture_t *p_dst, const picture_t *p_src )
+{
+    p_dst->date = p_src->date;
+}
+
+picture_t *filter_NewPicture( filter_t *p_filter )
+{
+    const video_format_t *p_fmt = &p_filter->fmt_out.video;
+    picture_t *p_pic = NULL;
+
+    pthread_mutex_lock( &pool_lock );
+    for( int i = 0; i < i_pool; i++ )
+        if( pool[i]->format.i_chroma == p_fmt->i_chroma
+         && pool[i]->format.i_width == p_fmt->i_width
+         && pool[i]->format.i_height == p_fmt->i_height
+         && pool[i]->format.i_visible_width == p_fmt->i_visible_width
+         && pool[i]->format.i_visible_height == p_fmt->i_visible_height )
+        {
+            p_pic = pool[i];
+            pool[i] = pool[--i_pool];
+            break;
+        }
+    pthread_mutex_unlock( &pool_lock );
+
+    if( p_pic )
+        atomic_init( &p_pic->i_refs, 1 );
+    else
+    {
+        p_pic = picture_NewFromFormat( p_fmt );
+        if( p_pic )
+            p_pic->b_pooled = true;
+    }
+    return p_pic;
+}
+
+/*****************************************************************************
+ * Subpictures: never shown, there is no video output
+ *****************************************************************************/
+subpicture_t *subpicture_New( const subpicture_updater_t *p_updater )
+{
+    VLC_UNUSED( p_updater );
+    return calloc( 1, sizeof( subpicture_t ) );
+}
+
+void subpicture_Delete( subpicture_t *p_spu )
+{
+    subpicture_region_Delete( p_spu->p_region );
+    free( p_spu );
+}
+
+subpicture_region_t *subpicture_region_New( const video_format_t *p_fmt )
+{
+    subpicture_region_t *p_region = calloc( 1, sizeof( *p_region ) );
+    if( !p_region )
+        return NULL;
+    p_region->fmt = *p_fmt;
+    p_region->fmt.p_palette = NULL;
+    p_region->p_picture = picture_NewFromFormat( p_fmt );
+    if( !p_region->p_picture )
+    {
+        free( p_region );
+        return NULL;
+    }
+    return p_region;
+}
+
+void subpicture_region_Delete( subpicture_region_t *p_region )
+{
+    if( !p_region )
+        return;
+    picture_Release( p_region->p_picture );
+    free( p_region );
+}
+
+int vout_RegisterSubpictureChannel( vout_thread_t *p_vout )
+{
+    VLC_UNUSED( p_vout );
+    return 1;
+}
+
+void vout_PutSubpicture( vout_thread_t *p_vout, subpicture_t *p_spu )
+{
+    VLC_UNUSED( p_vout );
+    subpicture_Delete( p_spu );
+}
+
+void vout_FlushSubpictureChannel( vout_thread_t *p_vout, int i_channel )
+{
+    VLC_UNUSED( p_vout );
+    VLC_UNUSED( i_channel );
+}
+
+/*****************************************************************************
+ * Filters
+ *****************************************************************************/
+filter_t *shim_NewFilter( int (*pf_open)( vlc_object_t * ),
+                          const video_format_t *p_fmt )
+{
+    vlc_object_t *p_parent = calloc( 1, sizeof( *p_parent ) );
+    filter_t *p_filter = calloc( 1, sizeof( *p_filter ) );
+    if( !p_parent || !p_filter )
+    {
+        free( p_parent );
+        free( p_filter );
+        return NULL;
+    }
+
+    p_parent->obj.object_type = "tool";
+    p_filter->obj.object_type = "video filter";
+    p_filter->obj.parent = p_parent;
+    p_filter->fmt_in.video = *p_fmt;
+    p_filter->fmt_out.video = *p_fmt;
+
+    if( pf_open( VLC_OBJECT( p_filter ) ) != VLC_SUCCESS )
+    {
+        DeleteVars( p_filter );
+        DeleteVars( p_parent );
+        free( p_filter );
+        free( p_parent );
+        return NULL;
+    }
+    return p_filter;
+}
+
+void shim_DeleteFilter( filter_t *p_filter,
+                        void (*pf_close)( vlc_object_t * ) )
+{
+    vlc_object_t *p_parent = p_filter->obj.parent;
+
+    pf_close( VLC_OBJECT( p_filter ) );
+    ClearPool();
+    DeleteVars( p_filter );
+    DeleteVars( p_parent );
+    free( p_filter );
+    free( p_parent );
+}
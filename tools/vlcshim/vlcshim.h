@@ -0,0 +1,30 @@
+/*****************************************************************************
+ * vlcshim.h: control of the VLC stand-in, for the tools
+ *****************************************************************************
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *****************************************************************************/
+
+#ifndef VLCSHIM_H
+#define VLCSHIM_H 1
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+
+/* Command line value of a module option, by its full name
+ * ("keystone-threads"); NULL restores the default */
+void shim_SetOption( const char *psz_name, const char *psz_value );
+void shim_ClearOptions( void );
+
+/* Print the module messages on stderr */
+void shim_SetVerbose( bool b_verbose );
+
+/* Create a filter of the given format and open it with pf_open, as VLC
+ * would under a plain object (no video output). Returns NULL on error. */
+filter_t *shim_NewFilter( int (*pf_open)( vlc_object_t * ),
+                          const video_format_t *p_fmt );
+void shim_DeleteFilter( filter_t *, void (*pf_close)( vlc_object_t * ) );
+
+#endif